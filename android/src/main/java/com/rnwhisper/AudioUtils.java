@@ -15,7 +15,7 @@ import java.nio.ShortBuffer;
 public class AudioUtils {
   private static final String NAME = "RNWhisperAudioUtils";
 
-  public static float[] decodeWaveFile(InputStream inputStream) throws IOException {
+  public static short[] decodeWaveFile(InputStream inputStream) throws IOException {
     ByteArrayOutputStream baos = new ByteArrayOutputStream();
     byte[] buffer = new byte[1024];
     int bytesRead;
@@ -28,12 +28,6 @@ public class AudioUtils {
     ShortBuffer shortBuffer = byteBuffer.asShortBuffer();
     short[] shortArray = new short[shortBuffer.limit()];
     shortBuffer.get(shortArray);
-    float[] floatArray = new float[shortArray.length];
-    for (int i = 0; i < shortArray.length; i++) {
-      floatArray[i] = ((float) shortArray[i]) / 32767.0f;
-      floatArray[i] = Math.max(floatArray[i], -1f);
-      floatArray[i] = Math.min(floatArray[i], 1f);
-    }
-    return floatArray;
+    return shortArray;
   }
 }
\ No newline at end of file
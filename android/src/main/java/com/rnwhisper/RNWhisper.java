@@ -82,12 +82,13 @@ public class RNWhisper implements LifecycleEventListener {
           int resId = getResourceIdentifier(modelFilePath);
           if (resId > 0) {
             context = WhisperContext.initContextWithInputStream(
-              new PushbackInputStream(reactContext.getResources().openRawResource(resId))
+              new PushbackInputStream(reactContext.getResources().openRawResource(resId)),
+              options
             );
           } else if (isBundleAsset) {
-            context = WhisperContext.initContextWithAsset(reactContext.getAssets(), modelFilePath);
+            context = WhisperContext.initContextWithAsset(reactContext.getAssets(), modelFilePath, options);
           } else {
-            context = WhisperContext.initContext(modelFilePath);
+            context = WhisperContext.initContext(modelFilePath, options);
           }
           if (context == 0) {
             throw new Exception("Failed to initialize context");
@@ -23,6 +23,9 @@ import java.io.File;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.PushbackInputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
 
 public class WhisperContext {
   public static final String NAME = "RNWhisperContext";
@@ -49,6 +52,8 @@ public class WhisperContext {
   // Current transcribing slice index
   private int transcribeSliceIndex = 0;
   private boolean isUseSlices = false;
+  private boolean isLocalAgreement = false;
+  private boolean isTokenTimestamps = false;
   private boolean isRealtime = false;
   private boolean isCapturing = false;
   private boolean isStoppedByAction = false;
@@ -69,6 +74,8 @@ public class WhisperContext {
     sliceIndex = 0;
     transcribeSliceIndex = 0;
     isUseSlices = false;
+    isLocalAgreement = false;
+    isTokenTimestamps = false;
     isRealtime = false;
     isCapturing = false;
     isStoppedByAction = false;
@@ -79,7 +86,7 @@ public class WhisperContext {
 
   private boolean vad(int sliceIndex, int nSamples, int n) {
     if (isTranscribing) return true;
-    return vadSimple(jobId, sliceIndex, nSamples, n);
+    return vadDetect(jobId, sliceIndex, nSamples, n);
   }
 
   private void finishRealtimeTranscribe(WritableMap result) {
@@ -109,6 +116,8 @@ public class WhisperContext {
     int realtimeAudioSliceSec = options.hasKey("realtimeAudioSliceSec") ? options.getInt("realtimeAudioSliceSec") : 0;
     final int audioSliceSec = realtimeAudioSliceSec > 0 && realtimeAudioSliceSec < audioSec ? realtimeAudioSliceSec : audioSec;
     isUseSlices = audioSliceSec < audioSec;
+    isLocalAgreement = options.hasKey("realtimeLocalAgreement") && options.getBoolean("realtimeLocalAgreement");
+    isTokenTimestamps = options.hasKey("tokenTimestamps") && options.getBoolean("tokenTimestamps");
 
     double realtimeAudioMinSec = options.hasKey("realtimeAudioMinSec") ? options.getDouble("realtimeAudioMinSec") : 0;
     final double audioMinSec = realtimeAudioMinSec > 0.5 && realtimeAudioMinSec <= audioSliceSec ? realtimeAudioMinSec : 1;
@@ -231,7 +240,27 @@ public class WhisperContext {
     payload.putInt("sliceIndex", transcribeSliceIndex);
 
     if (code == 0) {
-      payload.putMap("data", getTextSegments(0, getTextSegmentCount(context)));
+      WritableMap data = getTextSegments(0, getTextSegmentCount(context));
+      if (isLocalAgreement) {
+        // segments only cover the audio after the committed segments
+        String committed = getRealtimeCommittedText(jobId);
+        String tentative = getRealtimeTentativeText(jobId);
+        data.putString("result", committed + tentative);
+        data.putString("committed", committed);
+        data.putString("tentative", tentative);
+      }
+      payload.putMap("data", data);
+      int[] speechSegments = getRealtimeSpeechSegments(jobId, transcribeSliceIndex);
+      if (speechSegments.length > 0) {
+        WritableArray segments = Arguments.createArray();
+        for (int i = 0; i + 1 < speechSegments.length; i += 2) {
+          WritableMap segment = Arguments.createMap();
+          segment.putInt("start", speechSegments[i]);
+          segment.putInt("end", speechSegments[i + 1]);
+          segments.pushMap(segment);
+        }
+        payload.putArray("speechSegments", segments);
+      }
     } else if (code != -999) { // Not aborted
       payload.putString("error", "Transcribe failed with code " + code);
     }
@@ -336,14 +365,15 @@ public class WhisperContext {
 
     this.jobId = jobId;
     isTranscribing = true;
-    float[] audioData = AudioUtils.decodeWaveFile(inputStream);
+    isTokenTimestamps = options.hasKey("tokenTimestamps") && options.getBoolean("tokenTimestamps");
+    short[] audioData = AudioUtils.decodeWaveFile(inputStream);
 
     boolean hasProgressCallback = options.hasKey("onProgress") && options.getBoolean("onProgress");
     boolean hasNewSegmentsCallback = options.hasKey("onNewSegments") && options.getBoolean("onNewSegments");
     int code = fullWithNewJob(
       jobId,
       context,
-      // float[] audio_data,
+      // short[] audio_data,
       audioData,
       // jint audio_data_len,
       audioData.length,
@@ -363,20 +393,50 @@ public class WhisperContext {
     return result;
   }
 
-  private WritableMap getTextSegments(int start, int count) {
+  private static String readText(ByteBuffer buffer) {
+    int length = buffer.getInt();
+    String text = new String(buffer.array(), buffer.position(), length, StandardCharsets.UTF_8);
+    buffer.position(buffer.position() + length);
+    return text;
+  }
+
+  // Segments [start, end) of the last transcription, fetched in one call (see rnwhisper::serialize_segments)
+  private WritableMap getTextSegments(int start, int end) {
+    ByteBuffer buffer = ByteBuffer.wrap(getTextSegmentsBuffer(context, start, end, isTokenTimestamps));
+    buffer.order(ByteOrder.nativeOrder());
+
     StringBuilder builder = new StringBuilder();
 
     WritableMap data = Arguments.createMap();
     WritableArray segments = Arguments.createArray();
-    for (int i = 0; i < count; i++) {
-      String text = getTextSegment(context, i);
+    int nSegments = buffer.getInt();
+    for (int i = 0; i < nSegments; i++) {
+      int t0 = (int) buffer.getLong();
+      int t1 = (int) buffer.getLong();
+      String text = readText(buffer);
       builder.append(text);
 
       WritableMap segment = Arguments.createMap();
-      Log.d(NAME, "getTextSegments: " + text + " " + transcribeSliceIndex);
       segment.putString("text", text);
-      segment.putInt("t0", getTextSegmentT0(context, i));
-      segment.putInt("t1", getTextSegmentT1(context, i));
+      segment.putInt("t0", t0);
+      segment.putInt("t1", t1);
+
+      int nTokens = buffer.getInt();
+      if (isTokenTimestamps) {
+        WritableArray tokens = Arguments.createArray();
+        for (int j = 0; j < nTokens; j++) {
+          WritableMap token = Arguments.createMap();
+          token.putInt("id", buffer.getInt());
+          token.putDouble("p", buffer.getFloat());
+          token.putInt("t0", (int) buffer.getLong());
+          token.putInt("t1", (int) buffer.getLong());
+          long tDtw = buffer.getLong();
+          if (tDtw >= 0) token.putInt("tDtw", (int) tDtw);
+          token.putString("text", readText(buffer));
+          tokens.pushMap(token);
+        }
+        segment.putArray("tokens", tokens);
+      }
       segments.pushMap(segment);
     }
     data.putString("result", builder.toString());
@@ -384,7 +444,6 @@ public class WhisperContext {
     return data;
   }
 
-
   public boolean isCapturing() {
     return isCapturing;
   }
@@ -480,15 +539,15 @@ public class WhisperContext {
   }
 
   // JNI methods
-  protected static native long initContext(String modelPath);
-  protected static native long initContextWithAsset(AssetManager assetManager, String modelPath);
-  protected static native long initContextWithInputStream(PushbackInputStream inputStream);
+  protected static native long initContext(String modelPath, ReadableMap options);
+  protected static native long initContextWithAsset(AssetManager assetManager, String modelPath, ReadableMap options);
+  protected static native long initContextWithInputStream(PushbackInputStream inputStream, ReadableMap options);
   protected static native void freeContext(long contextPtr);
 
   protected static native int fullWithNewJob(
     int job_id,
     long context,
-    float[] audio_data,
+    short[] audio_data,
     int audio_data_len,
     ReadableMap options,
     Callback Callback
@@ -496,9 +555,7 @@ public class WhisperContext {
   protected static native void abortTranscribe(int jobId);
   protected static native void abortAllTranscribe();
   protected static native int getTextSegmentCount(long context);
-  protected static native String getTextSegment(long context, int index);
-  protected static native int getTextSegmentT0(long context, int index);
-  protected static native int getTextSegmentT1(long context, int index);
+  protected static native byte[] getTextSegmentsBuffer(long context, int start, int end, boolean withTokens);
 
   protected static native void createRealtimeTranscribeJob(
     int job_id,
@@ -506,7 +563,7 @@ public class WhisperContext {
     ReadableMap options
   );
   protected static native void finishRealtimeTranscribeJob(int job_id, long context, int[] sliceNSamples);
-  protected static native boolean vadSimple(int job_id, int slice_index, int n_samples, int n);
+  protected static native boolean vadDetect(int job_id, int slice_index, int n_samples, int n);
   protected static native void putPcmData(int job_id, short[] buffer, int slice_index, int n_samples, int n);
   protected static native int fullWithJob(
     int job_id,
@@ -514,4 +571,7 @@ public class WhisperContext {
     int slice_index,
     int n_samples
   );
+  protected static native int[] getRealtimeSpeechSegments(int job_id, int slice_index);
+  protected static native String getRealtimeCommittedText(int job_id);
+  protected static native String getRealtimeTentativeText(int job_id);
 }
@@ -61,6 +61,18 @@ float getFloat(JNIEnv *env, jobject readableMap, const char *key, jfloat default
     return result;
 }
 
+jobject getArray(JNIEnv *env, jobject readableMap, const char *key, jobject defaultValue) {
+    if (!hasKey(env, readableMap, key)) {
+        return defaultValue;
+    }
+    jclass mapClass = env->GetObjectClass(readableMap);
+    jmethodID getArrayMethod = env->GetMethodID(mapClass, "getArray", "(Ljava/lang/String;)Lcom/facebook/react/bridge/ReadableArray;");
+    jstring jKey = env->NewStringUTF(key);
+    jobject result = env->CallObjectMethod(readableMap, getArrayMethod, jKey);
+    env->DeleteLocalRef(jKey);
+    return result;
+}
+
 jstring getString(JNIEnv *env, jobject readableMap, const char *key, jstring defaultValue) {
     if (!hasKey(env, readableMap, key)) {
         return defaultValue;
@@ -73,4 +85,22 @@ jstring getString(JNIEnv *env, jobject readableMap, const char *key, jstring def
     return result;
 }
 
-}
\ No newline at end of file
+}
+
+// ReadableArray utils
+
+namespace readablearray {
+
+int size(JNIEnv *env, jobject readableArray) {
+    jclass arrayClass = env->GetObjectClass(readableArray);
+    jmethodID sizeMethod = env->GetMethodID(arrayClass, "size", "()I");
+    return env->CallIntMethod(readableArray, sizeMethod);
+}
+
+jstring getString(JNIEnv *env, jobject readableArray, int index) {
+    jclass arrayClass = env->GetObjectClass(readableArray);
+    jmethodID getStringMethod = env->GetMethodID(arrayClass, "getString", "(I)Ljava/lang/String;");
+    return (jstring) env->CallObjectMethod(readableArray, getStringMethod, index);
+}
+
+}
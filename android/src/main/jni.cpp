@@ -3,6 +3,7 @@
 #include <android/asset_manager_jni.h>
 #include <android/log.h>
 #include <cstdlib>
+#include <cstring>
 #include <sys/sysinfo.h>
 #include <string>
 #include <thread>
@@ -148,13 +149,26 @@ static struct whisper_context *whisper_init_from_asset(
     return whisper_init_with_params(&loader, cparams);
 }
 
+static struct whisper_context_params createContextParams(JNIEnv *env, jobject options) {
+    struct whisper_context_params cparams = whisper_context_default_params();
+
+    jstring dtw_preset = readablemap::getString(env, options, "dtwPreset", nullptr);
+    if (dtw_preset != nullptr) {
+        const char *dtw_preset_chars = env->GetStringUTFChars(dtw_preset, nullptr);
+        rnwhisper::set_dtw_params(cparams, dtw_preset_chars, readablemap::getInt(env, options, "dtwNTop", -1));
+        env->ReleaseStringUTFChars(dtw_preset, dtw_preset_chars);
+        env->DeleteLocalRef(dtw_preset);
+    }
+    return cparams;
+}
+
 extern "C" {
 
 JNIEXPORT jlong JNICALL
 Java_com_rnwhisper_WhisperContext_initContext(
-        JNIEnv *env, jobject thiz, jstring model_path_str) {
+        JNIEnv *env, jobject thiz, jstring model_path_str, jobject options) {
     UNUSED(thiz);
-    struct whisper_context_params cparams;
+    struct whisper_context_params cparams = createContextParams(env, options);
     struct whisper_context *context = nullptr;
     const char *model_path_chars = env->GetStringUTFChars(model_path_str, nullptr);
     context = whisper_init_from_file_with_params(model_path_chars, cparams);
@@ -167,10 +181,11 @@ Java_com_rnwhisper_WhisperContext_initContextWithAsset(
     JNIEnv *env,
     jobject thiz,
     jobject asset_manager,
-    jstring model_path_str
+    jstring model_path_str,
+    jobject options
 ) {
     UNUSED(thiz);
-    struct whisper_context_params cparams;
+    struct whisper_context_params cparams = createContextParams(env, options);
     struct whisper_context *context = nullptr;
     const char *model_path_chars = env->GetStringUTFChars(model_path_str, nullptr);
     context = whisper_init_from_asset(env, asset_manager, model_path_chars, cparams);
@@ -182,10 +197,11 @@ JNIEXPORT jlong JNICALL
 Java_com_rnwhisper_WhisperContext_initContextWithInputStream(
     JNIEnv *env,
     jobject thiz,
-    jobject input_stream
+    jobject input_stream,
+    jobject options
 ) {
     UNUSED(thiz);
-    struct whisper_context_params cparams;
+    struct whisper_context_params cparams = createContextParams(env, options);
     struct whisper_context *context = nullptr;
     context = whisper_init_from_input_stream(env, input_stream, cparams);
     return reinterpret_cast<jlong>(context);
@@ -207,6 +223,8 @@ struct whisper_full_params createFullParams(JNIEnv *env, jobject options) {
     params.n_threads = n_threads > 0 ? n_threads : default_n_threads;
     params.translate = readablemap::getBool(env, options, "translate", false);
     params.speed_up = readablemap::getBool(env, options, "speedUp", false);
+    params.skip_silence = readablemap::getBool(env, options, "skipSilence", false);
+    params.silence_thold = readablemap::getFloat(env, options, "silenceThold", params.silence_thold);
     params.token_timestamps = readablemap::getBool(env, options, "tokenTimestamps", false);
     params.offset_ms = 0;
     params.no_context = true;
@@ -227,6 +245,8 @@ struct whisper_full_params createFullParams(JNIEnv *env, jobject options) {
     if (offset > -1) params.offset_ms = offset;
     int duration = readablemap::getInt(env, options, "duration", -1);
     if (duration > -1) params.duration_ms = duration;
+    int lang_detect_ms = readablemap::getInt(env, options, "langDetectMs", -1);
+    if (lang_detect_ms > -1) params.lang_detect_ms = lang_detect_ms;
     int word_thold = readablemap::getInt(env, options, "wordThold", -1);
     if (word_thold > -1) params.thold_pt = word_thold;
     float temperature = readablemap::getFloat(env, options, "temperature", -1);
@@ -246,6 +266,25 @@ struct whisper_full_params createFullParams(JNIEnv *env, jobject options) {
     return params;
 }
 
+static void setHotwords(JNIEnv *env, rnwhisper::job *job, jobject options) {
+    jobject hotwords = readablemap::getArray(env, options, "hotwords", nullptr);
+    if (hotwords == nullptr) return;
+
+    std::vector<std::string> words;
+    int n_hotwords = readablearray::size(env, hotwords);
+    for (int i = 0; i < n_hotwords; i++) {
+        jstring word = readablearray::getString(env, hotwords, i);
+        if (word == nullptr) continue;
+        const char *word_chars = env->GetStringUTFChars(word, nullptr);
+        words.push_back(word_chars);
+        env->ReleaseStringUTFChars(word, word_chars);
+        env->DeleteLocalRef(word);
+    }
+    env->DeleteLocalRef(hotwords);
+
+    job->set_hotwords(words, readablemap::getFloat(env, options, "hotwordBoost", job->params.hotword_boost));
+}
+
 struct callback_context {
     JNIEnv *env;
     jobject callback_instance;
@@ -257,14 +296,14 @@ Java_com_rnwhisper_WhisperContext_fullWithNewJob(
     jobject thiz,
     jint job_id,
     jlong context_ptr,
-    jfloatArray audio_data,
+    jshortArray audio_data,
     jint audio_data_len,
     jobject options,
     jobject callback_instance
 ) {
     UNUSED(thiz);
     struct whisper_context *context = reinterpret_cast<struct whisper_context *>(context_ptr);
-    jfloat *audio_data_arr = env->GetFloatArrayElements(audio_data, nullptr);
+    jshort *audio_data_arr = env->GetShortArrayElements(audio_data, nullptr);
 
     LOGI("About to create params");
 
@@ -297,16 +336,24 @@ Java_com_rnwhisper_WhisperContext_fullWithNewJob(
     }
 
     rnwhisper::job* job = rnwhisper::job_new(job_id, params);
+    job->n_processors = readablemap::getInt(env, options, "nProcessors", 1);
+    setHotwords(env, job, options);
 
     LOGI("About to reset timings");
     whisper_reset_timings(context);
 
-    LOGI("About to run whisper_full");
-    int code = whisper_full(context, params, audio_data_arr, audio_data_len);
+    int code;
+    if (job->n_processors > 1) {
+        LOGI("About to run whisper_full_parallel with %d processors", job->n_processors);
+        code = whisper_full_parallel_s16(context, job->params, audio_data_arr, audio_data_len, job->n_processors);
+    } else {
+        LOGI("About to run whisper_full");
+        code = whisper_full_s16(context, job->params, audio_data_arr, audio_data_len);
+    }
     if (code == 0) {
         // whisper_print_timings(context);
     }
-    env->ReleaseFloatArrayElements(audio_data, audio_data_arr, JNI_ABORT);
+    env->ReleaseShortArrayElements(audio_data, audio_data_arr, JNI_ABORT);
 
     if (job->is_aborted()) code = -999;
     rnwhisper::job_remove(job_id);
@@ -323,11 +370,22 @@ Java_com_rnwhisper_WhisperContext_createRealtimeTranscribeJob(
 ) {
     whisper_full_params params = createFullParams(env, options);
     rnwhisper::job* job = rnwhisper::job_new(job_id, params);
+    setHotwords(env, job, options);
+    job->use_agreement = readablemap::getBool(env, options, "realtimeLocalAgreement", false);
     rnwhisper::vad_params vad;
     vad.use_vad = readablemap::getBool(env, options, "useVad", false);
     vad.vad_ms = readablemap::getInt(env, options, "vadMs", 2000);
     vad.vad_thold = readablemap::getFloat(env, options, "vadThold", 0.6f);
     vad.freq_thold = readablemap::getFloat(env, options, "vadFreqThold", 100.0f);
+    jstring vad_mode = readablemap::getString(env, options, "vadMode", nullptr);
+    if (vad_mode != nullptr) {
+        const char* vad_mode_chars = env->GetStringUTFChars(vad_mode, nullptr);
+        if (strcmp(vad_mode_chars, "spectral") == 0) {
+            vad.mode = rnwhisper::VAD_MODE_SPECTRAL;
+        }
+        env->ReleaseStringUTFChars(vad_mode, vad_mode_chars);
+        env->DeleteLocalRef(vad_mode);
+    }
 
     jstring audio_output_path = readablemap::getString(env, options, "audioOutputPath", nullptr);
     const char* audio_output_path_str = nullptr;
@@ -374,7 +432,7 @@ Java_com_rnwhisper_WhisperContext_finishRealtimeTranscribeJob(
 }
 
 JNIEXPORT jboolean JNICALL
-Java_com_rnwhisper_WhisperContext_vadSimple(
+Java_com_rnwhisper_WhisperContext_vadDetect(
     JNIEnv *env,
     jobject thiz,
     jint job_id,
@@ -384,7 +442,7 @@ Java_com_rnwhisper_WhisperContext_vadSimple(
 ) {
     UNUSED(thiz);
     rnwhisper::job* job = rnwhisper::job_get(job_id);
-    return job->vad_simple(slice_index, n_samples, n);
+    return job->vad_detect(slice_index, n_samples, n);
 }
 
 JNIEXPORT void JNICALL
@@ -417,9 +475,7 @@ Java_com_rnwhisper_WhisperContext_fullWithJob(
     struct whisper_context *context = reinterpret_cast<struct whisper_context *>(context_ptr);
 
     rnwhisper::job* job = rnwhisper::job_get(job_id);
-    float* pcmf32 = job->pcm_slice_to_f32(slice_index, n_samples);
-    int code = whisper_full(context, job->params, pcmf32, n_samples);
-    free(pcmf32);
+    int code = job->full_realtime(context, slice_index, n_samples);
     if (code == 0) {
         // whisper_print_timings(context);
     }
@@ -427,6 +483,49 @@ Java_com_rnwhisper_WhisperContext_fullWithJob(
     return code;
 }
 
+JNIEXPORT jintArray JNICALL
+Java_com_rnwhisper_WhisperContext_getRealtimeSpeechSegments(
+    JNIEnv *env,
+    jobject thiz,
+    jint job_id,
+    jint slice_index
+) {
+    UNUSED(thiz);
+    rnwhisper::job *job = rnwhisper::job_get(job_id);
+    const std::vector<rnwhisper::vad_segment> segments = job->vad_segments(slice_index);
+    // start and end of each segment
+    std::vector<jint> values;
+    for (size_t i = 0; i < segments.size(); i++) {
+        values.push_back(segments[i].start);
+        values.push_back(segments[i].end);
+    }
+    jintArray result = env->NewIntArray(values.size());
+    env->SetIntArrayRegion(result, 0, values.size(), values.data());
+    return result;
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_rnwhisper_WhisperContext_getRealtimeCommittedText(
+    JNIEnv *env,
+    jobject thiz,
+    jint job_id
+) {
+    UNUSED(thiz);
+    rnwhisper::job *job = rnwhisper::job_get(job_id);
+    return env->NewStringUTF(job->agreement.committed.c_str());
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_rnwhisper_WhisperContext_getRealtimeTentativeText(
+    JNIEnv *env,
+    jobject thiz,
+    jint job_id
+) {
+    UNUSED(thiz);
+    rnwhisper::job *job = rnwhisper::job_get(job_id);
+    return env->NewStringUTF(job->agreement.tentative.c_str());
+}
+
 JNIEXPORT void JNICALL
 Java_com_rnwhisper_WhisperContext_abortTranscribe(
     JNIEnv *env,
@@ -456,32 +555,16 @@ Java_com_rnwhisper_WhisperContext_getTextSegmentCount(
     return whisper_full_n_segments(context);
 }
 
-JNIEXPORT jstring JNICALL
-Java_com_rnwhisper_WhisperContext_getTextSegment(
-        JNIEnv *env, jobject thiz, jlong context_ptr, jint index) {
-    UNUSED(thiz);
-    struct whisper_context *context = reinterpret_cast<struct whisper_context *>(context_ptr);
-    const char *text = whisper_full_get_segment_text(context, index);
-    jstring string = env->NewStringUTF(text);
-    return string;
-}
-
-JNIEXPORT jint JNICALL
-Java_com_rnwhisper_WhisperContext_getTextSegmentT0(
-        JNIEnv *env, jobject thiz, jlong context_ptr, jint index) {
-    UNUSED(env);
-    UNUSED(thiz);
-    struct whisper_context *context = reinterpret_cast<struct whisper_context *>(context_ptr);
-    return whisper_full_get_segment_t0(context, index);
-}
-
-JNIEXPORT jint JNICALL
-Java_com_rnwhisper_WhisperContext_getTextSegmentT1(
-        JNIEnv *env, jobject thiz, jlong context_ptr, jint index) {
-    UNUSED(env);
+JNIEXPORT jbyteArray JNICALL
+Java_com_rnwhisper_WhisperContext_getTextSegmentsBuffer(
+        JNIEnv *env, jobject thiz, jlong context_ptr, jint start, jint end, jboolean with_tokens) {
     UNUSED(thiz);
     struct whisper_context *context = reinterpret_cast<struct whisper_context *>(context_ptr);
-    return whisper_full_get_segment_t1(context, index);
+    std::vector<uint8_t> buffer;
+    rnwhisper::serialize_segments(context, start, end, with_tokens, buffer);
+    jbyteArray result = env->NewByteArray(buffer.size());
+    env->SetByteArrayRegion(result, 0, buffer.size(), reinterpret_cast<const jbyte *>(buffer.data()));
+    return result;
 }
 
 JNIEXPORT void JNICALL
@@ -0,0 +1,294 @@
+// AVX2 build of the CPU kernels that are reached through wsp_ggml_type_traits_t, for x86 builds whose baseline is
+// older than AVX2. wsp_ggml_init() switches type_traits to these when the CPU supports AVX2, FMA and F16C.
+//
+// This file has to be compiled with -mavx2 -mfma -mf16c (see android/src/main/CMakeLists.txt). Without these flags
+// it provides no kernels and the baseline ones are kept.
+
+#include "ggml-impl.h"
+
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+    defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+
+// the quantized kernels are the AVX2 paths of ggml-quants.c, compiled once more under other names
+#define wsp_quantize_row_q4_0_reference wsp_quantize_row_q4_0_reference_avx2
+#define wsp_quantize_row_q4_1_reference wsp_quantize_row_q4_1_reference_avx2
+#define wsp_quantize_row_q5_0_reference wsp_quantize_row_q5_0_reference_avx2
+#define wsp_quantize_row_q5_1_reference wsp_quantize_row_q5_1_reference_avx2
+#define wsp_quantize_row_q8_0_reference wsp_quantize_row_q8_0_reference_avx2
+#define wsp_quantize_row_q8_1_reference wsp_quantize_row_q8_1_reference_avx2
+#define wsp_quantize_row_q2_K_reference wsp_quantize_row_q2_K_reference_avx2
+#define wsp_quantize_row_q3_K_reference wsp_quantize_row_q3_K_reference_avx2
+#define wsp_quantize_row_q4_K_reference wsp_quantize_row_q4_K_reference_avx2
+#define wsp_quantize_row_q5_K_reference wsp_quantize_row_q5_K_reference_avx2
+#define wsp_quantize_row_q6_K_reference wsp_quantize_row_q6_K_reference_avx2
+#define wsp_quantize_row_q8_K_reference wsp_quantize_row_q8_K_reference_avx2
+
+#define wsp_quantize_row_q4_0 wsp_quantize_row_q4_0_avx2
+#define wsp_quantize_row_q4_1 wsp_quantize_row_q4_1_avx2
+#define wsp_quantize_row_q5_0 wsp_quantize_row_q5_0_avx2
+#define wsp_quantize_row_q5_1 wsp_quantize_row_q5_1_avx2
+#define wsp_quantize_row_q8_0 wsp_quantize_row_q8_0_avx2
+#define wsp_quantize_row_q8_1 wsp_quantize_row_q8_1_avx2
+#define wsp_quantize_row_q2_K wsp_quantize_row_q2_K_avx2
+#define wsp_quantize_row_q3_K wsp_quantize_row_q3_K_avx2
+#define wsp_quantize_row_q4_K wsp_quantize_row_q4_K_avx2
+#define wsp_quantize_row_q5_K wsp_quantize_row_q5_K_avx2
+#define wsp_quantize_row_q6_K wsp_quantize_row_q6_K_avx2
+#define wsp_quantize_row_q8_K wsp_quantize_row_q8_K_avx2
+
+#define wsp_dewsp_quantize_row_q4_0 wsp_dewsp_quantize_row_q4_0_avx2
+#define wsp_dewsp_quantize_row_q4_1 wsp_dewsp_quantize_row_q4_1_avx2
+#define wsp_dewsp_quantize_row_q5_0 wsp_dewsp_quantize_row_q5_0_avx2
+#define wsp_dewsp_quantize_row_q5_1 wsp_dewsp_quantize_row_q5_1_avx2
+#define wsp_dewsp_quantize_row_q8_0 wsp_dewsp_quantize_row_q8_0_avx2
+#define wsp_dewsp_quantize_row_q2_K wsp_dewsp_quantize_row_q2_K_avx2
+#define wsp_dewsp_quantize_row_q3_K wsp_dewsp_quantize_row_q3_K_avx2
+#define wsp_dewsp_quantize_row_q4_K wsp_dewsp_quantize_row_q4_K_avx2
+#define wsp_dewsp_quantize_row_q5_K wsp_dewsp_quantize_row_q5_K_avx2
+#define wsp_dewsp_quantize_row_q6_K wsp_dewsp_quantize_row_q6_K_avx2
+#define wsp_dewsp_quantize_row_q8_K wsp_dewsp_quantize_row_q8_K_avx2
+
+#define wsp_ggml_vec_dot_q4_0_q8_0 wsp_ggml_vec_dot_q4_0_q8_0_avx2
+#define wsp_ggml_vec_dot_q4_1_q8_1 wsp_ggml_vec_dot_q4_1_q8_1_avx2
+#define wsp_ggml_vec_dot_q5_0_q8_0 wsp_ggml_vec_dot_q5_0_q8_0_avx2
+#define wsp_ggml_vec_dot_q5_1_q8_1 wsp_ggml_vec_dot_q5_1_q8_1_avx2
+#define wsp_ggml_vec_dot_q8_0_q8_0 wsp_ggml_vec_dot_q8_0_q8_0_avx2
+#define wsp_ggml_vec_dot_q2_K_q8_K wsp_ggml_vec_dot_q2_K_q8_K_avx2
+#define wsp_ggml_vec_dot_q3_K_q8_K wsp_ggml_vec_dot_q3_K_q8_K_avx2
+#define wsp_ggml_vec_dot_q4_K_q8_K wsp_ggml_vec_dot_q4_K_q8_K_avx2
+#define wsp_ggml_vec_dot_q5_K_q8_K wsp_ggml_vec_dot_q5_K_q8_K_avx2
+#define wsp_ggml_vec_dot_q6_K_q8_K wsp_ggml_vec_dot_q6_K_q8_K_avx2
+
+#define wsp_ggml_gemm_q4_0_q8_0 wsp_ggml_gemm_q4_0_q8_0_avx2
+#define wsp_ggml_gemm_q5_0_q8_0 wsp_ggml_gemm_q5_0_q8_0_avx2
+#define wsp_ggml_gemm_q8_0_q8_0 wsp_ggml_gemm_q8_0_q8_0_avx2
+
+#define wsp_ggml_wsp_quantize_q2_K wsp_ggml_wsp_quantize_q2_K_avx2
+#define wsp_ggml_wsp_quantize_q3_K wsp_ggml_wsp_quantize_q3_K_avx2
+#define wsp_ggml_wsp_quantize_q4_K wsp_ggml_wsp_quantize_q4_K_avx2
+#define wsp_ggml_wsp_quantize_q5_K wsp_ggml_wsp_quantize_q5_K_avx2
+#define wsp_ggml_wsp_quantize_q6_K wsp_ggml_wsp_quantize_q6_K_avx2
+
+#include "ggml-quants.c"
+
+//
+// F32 / F16 (the WSP_GGML_SIMD versions of ggml.c with 8-wide AVX registers)
+//
+
+#define AVX2_F32_STEP 32
+#define AVX2_F32_ARR  (AVX2_F32_STEP/8)
+
+#define AVX2_GEMM_F16_MR 4
+#define AVX2_GEMM_F16_NR 2
+
+static inline __m256 avx2_load_f16(const wsp_ggml_fp16_t * x) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) x));
+}
+
+static void wsp_ggml_vec_dot_f32_avx2(const int n, float * restrict s, const float * restrict x, const float * restrict y) {
+    const int np = (n & ~(AVX2_F32_STEP - 1));
+
+    __m256 sum[AVX2_F32_ARR];
+
+    for (int j = 0; j < AVX2_F32_ARR; ++j) {
+        sum[j] = _mm256_setzero_ps();
+    }
+
+    for (int i = 0; i < np; i += AVX2_F32_STEP) {
+        for (int j = 0; j < AVX2_F32_ARR; ++j) {
+            sum[j] = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8*j), _mm256_loadu_ps(y + i + 8*j), sum[j]);
+        }
+    }
+
+    float sumf = hsum_float_8(_mm256_add_ps(_mm256_add_ps(sum[0], sum[1]), _mm256_add_ps(sum[2], sum[3])));
+
+    // leftovers
+    for (int i = np; i < n; ++i) {
+        sumf += x[i]*y[i];
+    }
+
+    *s = sumf;
+}
+
+static void wsp_ggml_vec_dot_f16_avx2(const int n, float * restrict s, const wsp_ggml_fp16_t * restrict x, const wsp_ggml_fp16_t * restrict y) {
+    const int np = (n & ~(AVX2_F32_STEP - 1));
+
+    __m256 sum[AVX2_F32_ARR];
+
+    for (int j = 0; j < AVX2_F32_ARR; ++j) {
+        sum[j] = _mm256_setzero_ps();
+    }
+
+    for (int i = 0; i < np; i += AVX2_F32_STEP) {
+        for (int j = 0; j < AVX2_F32_ARR; ++j) {
+            sum[j] = _mm256_fmadd_ps(avx2_load_f16(x + i + 8*j), avx2_load_f16(y + i + 8*j), sum[j]);
+        }
+    }
+
+    double sumf = hsum_float_8(_mm256_add_ps(_mm256_add_ps(sum[0], sum[1]), _mm256_add_ps(sum[2], sum[3])));
+
+    // leftovers
+    for (int i = np; i < n; ++i) {
+        sumf += (double)(WSP_GGML_FP16_TO_FP32(x[i])*WSP_GGML_FP16_TO_FP32(y[i]));
+    }
+
+    *s = sumf;
+}
+
+// same tiling as wsp_ggml_gemm_f16 in ggml.c
+static void wsp_ggml_gemm_f16_avx2(const int n, const int nr0, const int nr1, float * restrict s, size_t bs, const void * restrict x, size_t bx, const void * restrict y, size_t by) {
+    const int np = (n & ~7);
+
+    const int mr = nr0 - nr0 % AVX2_GEMM_F16_MR;
+    const int nr = nr1 - nr1 % AVX2_GEMM_F16_NR;
+
+    for (int j = 0; j < nr; j += AVX2_GEMM_F16_NR) {
+        const wsp_ggml_fp16_t * restrict ys[AVX2_GEMM_F16_NR];
+
+        for (int jj = 0; jj < AVX2_GEMM_F16_NR; ++jj) {
+            ys[jj] = (const wsp_ggml_fp16_t *) ((const char *) y + (j + jj)*by);
+        }
+
+        for (int i = 0; i < mr; i += AVX2_GEMM_F16_MR) {
+            const wsp_ggml_fp16_t * restrict xs[AVX2_GEMM_F16_MR];
+            __m256 sum[AVX2_GEMM_F16_MR][AVX2_GEMM_F16_NR];
+
+            for (int ii = 0; ii < AVX2_GEMM_F16_MR; ++ii) {
+                xs[ii] = (const wsp_ggml_fp16_t *) ((const char *) x + (i + ii)*bx);
+
+                for (int jj = 0; jj < AVX2_GEMM_F16_NR; ++jj) {
+                    sum[ii][jj] = _mm256_setzero_ps();
+                }
+            }
+
+            for (int k = 0; k < np; k += 8) {
+                __m256 ay[AVX2_GEMM_F16_NR];
+
+                for (int jj = 0; jj < AVX2_GEMM_F16_NR; ++jj) {
+                    ay[jj] = avx2_load_f16(ys[jj] + k);
+                }
+
+                for (int ii = 0; ii < AVX2_GEMM_F16_MR; ++ii) {
+                    const __m256 ax = avx2_load_f16(xs[ii] + k);
+
+                    for (int jj = 0; jj < AVX2_GEMM_F16_NR; ++jj) {
+                        sum[ii][jj] = _mm256_fmadd_ps(ax, ay[jj], sum[ii][jj]);
+                    }
+                }
+            }
+
+            for (int ii = 0; ii < AVX2_GEMM_F16_MR; ++ii) {
+                for (int jj = 0; jj < AVX2_GEMM_F16_NR; ++jj) {
+                    double sumf = hsum_float_8(sum[ii][jj]);
+
+                    // leftovers
+                    for (int k = np; k < n; ++k) {
+                        sumf += (double)(WSP_GGML_FP16_TO_FP32(xs[ii][k])*WSP_GGML_FP16_TO_FP32(ys[jj][k]));
+                    }
+
+                    s[(j + jj)*bs + i + ii] = sumf;
+                }
+            }
+        }
+
+        for (int jj = j; jj < j + AVX2_GEMM_F16_NR; ++jj) {
+            for (int i = mr; i < nr0; ++i) {
+                wsp_ggml_vec_dot_f16_avx2(n, s + jj*bs + i, (const wsp_ggml_fp16_t *) ((const char *) x + i*bx), (const wsp_ggml_fp16_t *) ((const char *) y + jj*by));
+            }
+        }
+    }
+
+    for (int j = nr; j < nr1; ++j) {
+        for (int i = 0; i < nr0; ++i) {
+            wsp_ggml_vec_dot_f16_avx2(n, s + j*bs + i, (const wsp_ggml_fp16_t *) ((const char *) x + i*bx), (const wsp_ggml_fp16_t *) ((const char *) y + j*by));
+        }
+    }
+}
+
+static void wsp_ggml_fp16_to_fp32_row_avx2(const wsp_ggml_fp16_t * restrict x, float * restrict y, int n) {
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, avx2_load_f16(x + i));
+    }
+
+    for (; i < n; ++i) {
+        y[i] = WSP_GGML_FP16_TO_FP32(x[i]);
+    }
+}
+
+static void wsp_ggml_fp32_to_fp16_row_avx2(const float * restrict x, wsp_ggml_fp16_t * restrict y, int n) {
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128((__m128i *) (y + i), _mm256_cvtps_ph(_mm256_loadu_ps(x + i), 0));
+    }
+
+    for (; i < n; ++i) {
+        y[i] = WSP_GGML_FP32_TO_FP16(x[i]);
+    }
+}
+
+static const struct wsp_ggml_cpu_kernels wsp_ggml_cpu_kernels_avx2 = {
+    /*.name       =*/ "avx2",
+    /*.to_float   =*/ {
+        [WSP_GGML_TYPE_F16]  = (wsp_ggml_to_float_t) wsp_ggml_fp16_to_fp32_row_avx2,
+        [WSP_GGML_TYPE_Q4_0] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q4_0,
+        [WSP_GGML_TYPE_Q4_1] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q4_1,
+        [WSP_GGML_TYPE_Q5_0] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q5_0,
+        [WSP_GGML_TYPE_Q5_1] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q5_1,
+        [WSP_GGML_TYPE_Q8_0] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q8_0,
+        [WSP_GGML_TYPE_Q2_K] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q2_K,
+        [WSP_GGML_TYPE_Q3_K] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q3_K,
+        [WSP_GGML_TYPE_Q4_K] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q4_K,
+        [WSP_GGML_TYPE_Q5_K] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q5_K,
+        [WSP_GGML_TYPE_Q6_K] = (wsp_ggml_to_float_t) wsp_dewsp_quantize_row_q6_K,
+    },
+    /*.from_float =*/ {
+        [WSP_GGML_TYPE_F16]  = (wsp_ggml_from_float_t) wsp_ggml_fp32_to_fp16_row_avx2,
+        [WSP_GGML_TYPE_Q4_0] = wsp_quantize_row_q4_0,
+        [WSP_GGML_TYPE_Q4_1] = wsp_quantize_row_q4_1,
+        [WSP_GGML_TYPE_Q5_0] = wsp_quantize_row_q5_0,
+        [WSP_GGML_TYPE_Q5_1] = wsp_quantize_row_q5_1,
+        [WSP_GGML_TYPE_Q8_0] = wsp_quantize_row_q8_0,
+        [WSP_GGML_TYPE_Q8_1] = wsp_quantize_row_q8_1,
+        [WSP_GGML_TYPE_Q2_K] = wsp_quantize_row_q2_K,
+        [WSP_GGML_TYPE_Q3_K] = wsp_quantize_row_q3_K,
+        [WSP_GGML_TYPE_Q4_K] = wsp_quantize_row_q4_K,
+        [WSP_GGML_TYPE_Q5_K] = wsp_quantize_row_q5_K,
+        [WSP_GGML_TYPE_Q6_K] = wsp_quantize_row_q6_K,
+        [WSP_GGML_TYPE_Q8_K] = wsp_quantize_row_q8_K,
+    },
+    /*.vec_dot    =*/ {
+        [WSP_GGML_TYPE_F32]  = (wsp_ggml_vec_dot_t) wsp_ggml_vec_dot_f32_avx2,
+        [WSP_GGML_TYPE_F16]  = (wsp_ggml_vec_dot_t) wsp_ggml_vec_dot_f16_avx2,
+        [WSP_GGML_TYPE_Q4_0] = wsp_ggml_vec_dot_q4_0_q8_0,
+        [WSP_GGML_TYPE_Q4_1] = wsp_ggml_vec_dot_q4_1_q8_1,
+        [WSP_GGML_TYPE_Q5_0] = wsp_ggml_vec_dot_q5_0_q8_0,
+        [WSP_GGML_TYPE_Q5_1] = wsp_ggml_vec_dot_q5_1_q8_1,
+        [WSP_GGML_TYPE_Q8_0] = wsp_ggml_vec_dot_q8_0_q8_0,
+        [WSP_GGML_TYPE_Q2_K] = wsp_ggml_vec_dot_q2_K_q8_K,
+        [WSP_GGML_TYPE_Q3_K] = wsp_ggml_vec_dot_q3_K_q8_K,
+        [WSP_GGML_TYPE_Q4_K] = wsp_ggml_vec_dot_q4_K_q8_K,
+        [WSP_GGML_TYPE_Q5_K] = wsp_ggml_vec_dot_q5_K_q8_K,
+        [WSP_GGML_TYPE_Q6_K] = wsp_ggml_vec_dot_q6_K_q8_K,
+    },
+    /*.gemm       =*/ {
+        [WSP_GGML_TYPE_F16]  = wsp_ggml_gemm_f16_avx2,
+        [WSP_GGML_TYPE_Q4_0] = wsp_ggml_gemm_q4_0_q8_0,
+        [WSP_GGML_TYPE_Q5_0] = wsp_ggml_gemm_q5_0_q8_0,
+        [WSP_GGML_TYPE_Q8_0] = wsp_ggml_gemm_q8_0_q8_0,
+    },
+};
+
+const struct wsp_ggml_cpu_kernels * wsp_ggml_cpu_kernels_avx2_get(void) {
+    return &wsp_ggml_cpu_kernels_avx2;
+}
+
+#else
+
+const struct wsp_ggml_cpu_kernels * wsp_ggml_cpu_kernels_avx2_get(void) {
+    return NULL;
+}
+
+#endif
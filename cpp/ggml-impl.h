@@ -69,7 +69,7 @@ extern "C" {
 #if defined(_MSC_VER) || defined(__MINGW32__)
 #include <intrin.h>
 #else
-#if defined(__AVX__) || defined(__AVX2__) || defined(__AVX512F__) || defined(__SSSE3__) || defined(__SSE3__)
+#if defined(__AVX__) || defined(__AVX2__) || defined(__AVX512F__) || defined(__SSSE3__) || defined(__SSE3__) || defined(__SSE2__)
 #if !defined(__riscv)
 #include <immintrin.h>
 #endif
@@ -205,9 +205,45 @@ static inline wsp_ggml_fp16_t wsp_ggml_compute_fp32_to_fp16(float f) {
 #endif // __ARM_NEON
 
 // precomputed f32 table for f16 (256 KB)
-// defined in ggml.c, initialized in wsp_ggml_init()
+// defined in ggml.c, initialized in wsp_ggml_init() when WSP_GGML_FP16_TO_FP32_TABLE is defined
 extern float wsp_ggml_table_f32_f16[1 << 16];
 
+// optional instructions of the CPU we are running on, for the kernels that pick an implementation at runtime
+// defined in ggml.c, initialized in wsp_ggml_init()
+struct wsp_ggml_cpu_features {
+    bool arm_dotprod; // SDOT/UDOT
+    bool arm_i8mm;    // SMMLA/UMMLA
+    bool arm_fp16;    // FP16 vector arithmetic
+
+    // x86, only set when the OS also saves the registers
+    bool x86_sse3;
+    bool x86_ssse3;
+    bool x86_avx;
+    bool x86_avx2;
+    bool x86_fma;
+    bool x86_f16c;
+    bool x86_avx512f;
+    bool x86_avx512bw;
+    bool x86_avx512_vnni;
+    bool x86_avx_vnni;
+};
+
+extern struct wsp_ggml_cpu_features wsp_ggml_cpu_features;
+
+// a set of kernels built for an instruction set above the baseline of the build, the non-NULL entries replace
+// the ones of wsp_ggml_type_traits_t in wsp_ggml_init() when the CPU supports it
+struct wsp_ggml_cpu_kernels {
+    const char * name;
+
+    wsp_ggml_to_float_t   to_float  [WSP_GGML_TYPE_COUNT];
+    wsp_ggml_from_float_t from_float[WSP_GGML_TYPE_COUNT];
+    wsp_ggml_vec_dot_t    vec_dot   [WSP_GGML_TYPE_COUNT];
+    wsp_ggml_gemm_t       gemm      [WSP_GGML_TYPE_COUNT];
+};
+
+// ggml-cpu-avx2.c, NULL if that file was not compiled with AVX2, FMA and F16C
+const struct wsp_ggml_cpu_kernels * wsp_ggml_cpu_kernels_avx2_get(void);
+
 // On ARM NEON, it's quicker to directly convert x -> x instead of calling into wsp_ggml_lookup_fp16_to_fp32,
 // so we define WSP_GGML_FP16_TO_FP32 and WSP_GGML_FP32_TO_FP16 elsewhere for NEON.
 // This is also true for POWER9.
@@ -222,6 +258,8 @@ inline static float wsp_ggml_lookup_fp16_to_fp32(wsp_ggml_fp16_t f) {
 #define WSP_GGML_FP16_TO_FP32(x) wsp_ggml_lookup_fp16_to_fp32(x)
 #define WSP_GGML_FP32_TO_FP16(x) WSP_GGML_COMPUTE_FP32_TO_FP16(x)
 
+#define WSP_GGML_FP16_TO_FP32_TABLE
+
 #endif
 
 #define WSP_GGML_HASHTABLE_FULL ((size_t)-1)
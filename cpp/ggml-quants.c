@@ -121,7 +121,7 @@ static inline __m256 sum_i16_pairs_float(const __m256i x) {
 }
 
 static inline __m256 mul_sum_us8_pairs_float(const __m256i ax, const __m256i sy) {
-#if __AVXVNNI__
+#if __AVXVNNI__ || (__AVX512VNNI__ && __AVX512VL__)
     const __m256i zero = _mm256_setzero_si256();
     const __m256i summed_pairs = _mm256_dpbusd_epi32(zero, ax, sy);
     return _mm256_cvtepi32_ps(summed_pairs);
@@ -167,6 +167,33 @@ static inline __m128i packNibbles( __m256i bytes )
     return _mm_packus_epi16( r0, r1 );
 #endif
 }
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+// two blocks of 32 bytes in one vector, lo in the low half
+static inline __m512i mm512_set_m256i(const __m256i hi, const __m256i lo) {
+    return _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+}
+
+// the scales of two blocks, dlo in the low 8 lanes
+static inline __m512 mm512_set_2x8_ps(const float dhi, const float dlo) {
+    return _mm512_mask_blend_ps(0xFF00, _mm512_set1_ps(dlo), _mm512_set1_ps(dhi));
+}
+
+// multiply int8_t, add results in groups of four and return as float vector
+static inline __m512 mul_sum_i8_quads_float_x16(const __m512i x, const __m512i y) {
+    const __m512i zero = _mm512_setzero_si512();
+    // Get absolute values of x vectors
+    const __m512i ax = _mm512_abs_epi8(x);
+    // Sign the values of the y vectors (there is no 512-bit _mm_sign_epi8)
+    const __m512i sy = _mm512_mask_sub_epi8(y, _mm512_movepi8_mask(x), zero, y);
+#if __AVX512VNNI__
+    const __m512i summed_quads = _mm512_dpbusd_epi32(zero, ax, sy);
+#else
+    const __m512i summed_quads = _mm512_madd_epi16(_mm512_set1_epi16(1), _mm512_maddubs_epi16(ax, sy));
+#endif
+    return _mm512_cvtepi32_ps(summed_quads);
+}
+#endif
 #elif defined(__AVX__)
 // spread 32 bits to 32 bytes { 0x00, 0xFF }
 static inline __m256i bytes_from_bits_32(const uint8_t * x) {
@@ -409,6 +436,68 @@ inline static wsp_ggml_int8x16x4_t wsp_ggml_vld1q_s8_x4(const int8_t * ptr) {
 #endif
 #endif
 
+#if defined(__ARM_NEON)
+
+// SDOT (ARMv8.2 dotprod) and SMMLA (ARMv8.6 i8mm) are selected at runtime from wsp_ggml_cpu_features, so that a
+// build for plain ARMv8 still uses them on the CPUs that have them. Without the matching -march they are emitted
+// with .inst (the assembler would reject the mnemonics), the register numbers of the operands come from the
+// symbols defined by WSP_GGML_ASM_VREG_NUMS.
+
+#if defined(__ARM_FEATURE_DOTPROD)
+#define WSP_GGML_ARM_DOTPROD true
+#elif defined(__aarch64__)
+#define WSP_GGML_ARM_DOTPROD wsp_ggml_cpu_features.arm_dotprod
+#else
+#define WSP_GGML_ARM_DOTPROD false
+#endif
+
+#if defined(__ARM_FEATURE_MATMUL_INT8)
+#define WSP_GGML_ARM_I8MM true
+#elif defined(__aarch64__)
+#define WSP_GGML_ARM_I8MM wsp_ggml_cpu_features.arm_i8mm
+#else
+#define WSP_GGML_ARM_I8MM false
+#endif
+
+#define WSP_GGML_ASM_VREG_NUMS \
+    ".irp n,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31\n" \
+    ".equ .Lwsp_ggml_vreg_v\\n, \\n\n" \
+    ".endr\n"
+
+// acc[i] += a[4*i + 0..3] . b[4*i + 0..3]
+inline static int32x4_t wsp_ggml_vdotq_s32(int32x4_t acc, const int8x16_t a, const int8x16_t b) {
+#if defined(__ARM_FEATURE_DOTPROD)
+    return vdotq_s32(acc, a, b);
+#elif defined(__aarch64__)
+    __asm__(WSP_GGML_ASM_VREG_NUMS
+            ".inst 0x4e809400 | (.Lwsp_ggml_vreg_%2 << 16) | (.Lwsp_ggml_vreg_%1 << 5) | .Lwsp_ggml_vreg_%0"
+            : "+w"(acc) : "w"(a), "w"(b));
+    return acc;
+#else
+    // not used (WSP_GGML_ARM_DOTPROD is false), same total with the lanes summed in another order
+    const int16x8_t p0 = vmull_s8(vget_low_s8 (a), vget_low_s8 (b));
+    const int16x8_t p1 = vmull_s8(vget_high_s8(a), vget_high_s8(b));
+    return vaddq_s32(acc, vaddq_s32(vpaddlq_s16(p0), vpaddlq_s16(p1)));
+#endif
+}
+
+#if defined(__aarch64__)
+// acc += the 2x2 products of the rows of a and b, each 16 bytes holding two rows of 8 int8:
+//   { a0.b0, a0.b1, a1.b0, a1.b1 }
+inline static int32x4_t wsp_ggml_vmmlaq_s32(int32x4_t acc, const int8x16_t a, const int8x16_t b) {
+#if defined(__ARM_FEATURE_MATMUL_INT8)
+    return vmmlaq_s32(acc, a, b);
+#else
+    __asm__(WSP_GGML_ASM_VREG_NUMS
+            ".inst 0x4e80a400 | (.Lwsp_ggml_vreg_%2 << 16) | (.Lwsp_ggml_vreg_%1 << 5) | .Lwsp_ggml_vreg_%0"
+            : "+w"(acc) : "w"(a), "w"(b));
+    return acc;
+#endif
+}
+#endif
+
+#endif // __ARM_NEON
+
 #if defined(__ARM_NEON) || defined(__wasm_simd128__)
 #define B1(c,s,n)  0x ## n ## c ,  0x ## n ## s
 #define B2(c,s,n) B1(c,s,n ## c), B1(c,s,n ## s)
@@ -2438,6 +2527,8 @@ void wsp_ggml_vec_dot_q4_0_q8_0(int n, float * restrict s, const void * restrict
 
     assert(nb % 2 == 0); // TODO: handle odd nb
 
+    const bool dotprod = WSP_GGML_ARM_DOTPROD;
+
     for (int i = 0; i < nb; i += 2) {
         const block_q4_0 * restrict x0 = &x[i + 0];
         const block_q4_0 * restrict x1 = &x[i + 1];
@@ -2468,32 +2559,32 @@ void wsp_ggml_vec_dot_q4_0_q8_0(int n, float * restrict s, const void * restrict
         const int8x16_t v1_1l = vld1q_s8(y1->qs);
         const int8x16_t v1_1h = vld1q_s8(y1->qs + 16);
 
-#if defined(__ARM_FEATURE_DOTPROD)
-        // dot product into int32x4_t
-        const int32x4_t p_0 = vdotq_s32(vdotq_s32(vdupq_n_s32(0), v0_0ls, v1_0l), v0_0hs, v1_0h);
-        const int32x4_t p_1 = vdotq_s32(vdotq_s32(vdupq_n_s32(0), v0_1ls, v1_1l), v0_1hs, v1_1h);
+        if (dotprod) {
+            // dot product into int32x4_t
+            const int32x4_t p_0 = wsp_ggml_vdotq_s32(wsp_ggml_vdotq_s32(vdupq_n_s32(0), v0_0ls, v1_0l), v0_0hs, v1_0h);
+            const int32x4_t p_1 = wsp_ggml_vdotq_s32(wsp_ggml_vdotq_s32(vdupq_n_s32(0), v0_1ls, v1_1l), v0_1hs, v1_1h);
 
-        sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(p_0), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
-        sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(p_1), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
-#else
-        const int16x8_t pl0l = vmull_s8(vget_low_s8 (v0_0ls), vget_low_s8 (v1_0l));
-        const int16x8_t pl0h = vmull_s8(vget_high_s8(v0_0ls), vget_high_s8(v1_0l));
-        const int16x8_t ph0l = vmull_s8(vget_low_s8 (v0_0hs), vget_low_s8 (v1_0h));
-        const int16x8_t ph0h = vmull_s8(vget_high_s8(v0_0hs), vget_high_s8(v1_0h));
+            sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(p_0), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
+            sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(p_1), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
+        } else {
+            const int16x8_t pl0l = vmull_s8(vget_low_s8 (v0_0ls), vget_low_s8 (v1_0l));
+            const int16x8_t pl0h = vmull_s8(vget_high_s8(v0_0ls), vget_high_s8(v1_0l));
+            const int16x8_t ph0l = vmull_s8(vget_low_s8 (v0_0hs), vget_low_s8 (v1_0h));
+            const int16x8_t ph0h = vmull_s8(vget_high_s8(v0_0hs), vget_high_s8(v1_0h));
 
-        const int16x8_t pl1l = vmull_s8(vget_low_s8 (v0_1ls), vget_low_s8 (v1_1l));
-        const int16x8_t pl1h = vmull_s8(vget_high_s8(v0_1ls), vget_high_s8(v1_1l));
-        const int16x8_t ph1l = vmull_s8(vget_low_s8 (v0_1hs), vget_low_s8 (v1_1h));
-        const int16x8_t ph1h = vmull_s8(vget_high_s8(v0_1hs), vget_high_s8(v1_1h));
+            const int16x8_t pl1l = vmull_s8(vget_low_s8 (v0_1ls), vget_low_s8 (v1_1l));
+            const int16x8_t pl1h = vmull_s8(vget_high_s8(v0_1ls), vget_high_s8(v1_1l));
+            const int16x8_t ph1l = vmull_s8(vget_low_s8 (v0_1hs), vget_low_s8 (v1_1h));
+            const int16x8_t ph1h = vmull_s8(vget_high_s8(v0_1hs), vget_high_s8(v1_1h));
 
-        const int32x4_t pl0 = vaddq_s32(vpaddlq_s16(pl0l), vpaddlq_s16(pl0h));
-        const int32x4_t ph0 = vaddq_s32(vpaddlq_s16(ph0l), vpaddlq_s16(ph0h));
-        const int32x4_t pl1 = vaddq_s32(vpaddlq_s16(pl1l), vpaddlq_s16(pl1h));
-        const int32x4_t ph1 = vaddq_s32(vpaddlq_s16(ph1l), vpaddlq_s16(ph1h));
+            const int32x4_t pl0 = vaddq_s32(vpaddlq_s16(pl0l), vpaddlq_s16(pl0h));
+            const int32x4_t ph0 = vaddq_s32(vpaddlq_s16(ph0l), vpaddlq_s16(ph0h));
+            const int32x4_t pl1 = vaddq_s32(vpaddlq_s16(pl1l), vpaddlq_s16(pl1h));
+            const int32x4_t ph1 = vaddq_s32(vpaddlq_s16(ph1l), vpaddlq_s16(ph1h));
 
-        sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(pl0, ph0)), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
-        sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(pl1, ph1)), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
-#endif
+            sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(pl0, ph0)), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
+            sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(pl1, ph1)), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
+        }
     }
 
     *s = vaddvq_f32(sumv0) + vaddvq_f32(sumv1);
@@ -2915,6 +3006,8 @@ void wsp_ggml_vec_dot_q5_0_q8_0(const int n, float * restrict s, const void * re
 
     assert(nb % 2 == 0); // TODO: handle odd nb
 
+    const bool dotprod = WSP_GGML_ARM_DOTPROD;
+
     for (int i = 0; i < nb; i += 2) {
         const block_q5_0 * restrict x0 = &x[i];
         const block_q5_0 * restrict x1 = &x[i + 1];
@@ -2963,32 +3056,32 @@ void wsp_ggml_vec_dot_q5_0_q8_0(const int n, float * restrict s, const void * re
         const int8x16_t v1_1l = vld1q_s8(y1->qs);
         const int8x16_t v1_1h = vld1q_s8(y1->qs + 16);
 
-#if defined(__ARM_FEATURE_DOTPROD)
-        sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(
-                        vdotq_s32(vdupq_n_s32(0), v0_0lf, v1_0l),
-                        vdotq_s32(vdupq_n_s32(0), v0_0hf, v1_0h))), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
-        sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(
-                        vdotq_s32(vdupq_n_s32(0), v0_1lf, v1_1l),
-                        vdotq_s32(vdupq_n_s32(0), v0_1hf, v1_1h))), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
-#else
-        const int16x8_t pl0l = vmull_s8(vget_low_s8 (v0_0lf), vget_low_s8 (v1_0l));
-        const int16x8_t pl0h = vmull_s8(vget_high_s8(v0_0lf), vget_high_s8(v1_0l));
-        const int16x8_t ph0l = vmull_s8(vget_low_s8 (v0_0hf), vget_low_s8 (v1_0h));
-        const int16x8_t ph0h = vmull_s8(vget_high_s8(v0_0hf), vget_high_s8(v1_0h));
+        if (dotprod) {
+            sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), v0_0lf, v1_0l),
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), v0_0hf, v1_0h))), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
+            sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), v0_1lf, v1_1l),
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), v0_1hf, v1_1h))), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
+        } else {
+            const int16x8_t pl0l = vmull_s8(vget_low_s8 (v0_0lf), vget_low_s8 (v1_0l));
+            const int16x8_t pl0h = vmull_s8(vget_high_s8(v0_0lf), vget_high_s8(v1_0l));
+            const int16x8_t ph0l = vmull_s8(vget_low_s8 (v0_0hf), vget_low_s8 (v1_0h));
+            const int16x8_t ph0h = vmull_s8(vget_high_s8(v0_0hf), vget_high_s8(v1_0h));
 
-        const int16x8_t pl1l = vmull_s8(vget_low_s8 (v0_1lf), vget_low_s8 (v1_1l));
-        const int16x8_t pl1h = vmull_s8(vget_high_s8(v0_1lf), vget_high_s8(v1_1l));
-        const int16x8_t ph1l = vmull_s8(vget_low_s8 (v0_1hf), vget_low_s8 (v1_1h));
-        const int16x8_t ph1h = vmull_s8(vget_high_s8(v0_1hf), vget_high_s8(v1_1h));
+            const int16x8_t pl1l = vmull_s8(vget_low_s8 (v0_1lf), vget_low_s8 (v1_1l));
+            const int16x8_t pl1h = vmull_s8(vget_high_s8(v0_1lf), vget_high_s8(v1_1l));
+            const int16x8_t ph1l = vmull_s8(vget_low_s8 (v0_1hf), vget_low_s8 (v1_1h));
+            const int16x8_t ph1h = vmull_s8(vget_high_s8(v0_1hf), vget_high_s8(v1_1h));
 
-        const int32x4_t pl0 = vaddq_s32(vpaddlq_s16(pl0l), vpaddlq_s16(pl0h));
-        const int32x4_t ph0 = vaddq_s32(vpaddlq_s16(ph0l), vpaddlq_s16(ph0h));
-        const int32x4_t pl1 = vaddq_s32(vpaddlq_s16(pl1l), vpaddlq_s16(pl1h));
-        const int32x4_t ph1 = vaddq_s32(vpaddlq_s16(ph1l), vpaddlq_s16(ph1h));
+            const int32x4_t pl0 = vaddq_s32(vpaddlq_s16(pl0l), vpaddlq_s16(pl0h));
+            const int32x4_t ph0 = vaddq_s32(vpaddlq_s16(ph0l), vpaddlq_s16(ph0h));
+            const int32x4_t pl1 = vaddq_s32(vpaddlq_s16(pl1l), vpaddlq_s16(pl1h));
+            const int32x4_t ph1 = vaddq_s32(vpaddlq_s16(ph1l), vpaddlq_s16(ph1h));
 
-        sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(pl0, ph0)), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
-        sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(pl1, ph1)), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
-#endif
+            sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(pl0, ph0)), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
+            sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(pl1, ph1)), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
+        }
     }
 
     *s = vaddvq_f32(sumv0) + vaddvq_f32(sumv1);
@@ -3533,6 +3626,8 @@ void wsp_ggml_vec_dot_q8_0_q8_0(const int n, float * restrict s, const void * re
 
     assert(nb % 2 == 0); // TODO: handle odd nb
 
+    const bool dotprod = WSP_GGML_ARM_DOTPROD;
+
     for (int i = 0; i < nb; i += 2) {
         const block_q8_0 * restrict x0 = &x[i + 0];
         const block_q8_0 * restrict x1 = &x[i + 1];
@@ -3550,37 +3645,58 @@ void wsp_ggml_vec_dot_q8_0_q8_0(const int n, float * restrict s, const void * re
         const int8x16_t y1_0 = vld1q_s8(y1->qs);
         const int8x16_t y1_1 = vld1q_s8(y1->qs + 16);
 
-#if defined(__ARM_FEATURE_DOTPROD)
-        sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(
-                        vdotq_s32(vdupq_n_s32(0), x0_0, y0_0),
-                        vdotq_s32(vdupq_n_s32(0), x0_1, y0_1))), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
+        if (dotprod) {
+            sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), x0_0, y0_0),
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), x0_1, y0_1))), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
 
-        sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(
-                        vdotq_s32(vdupq_n_s32(0), x1_0, y1_0),
-                        vdotq_s32(vdupq_n_s32(0), x1_1, y1_1))), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
+            sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), x1_0, y1_0),
+                            wsp_ggml_vdotq_s32(vdupq_n_s32(0), x1_1, y1_1))), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
 
-#else
-        const int16x8_t p0_0 = vmull_s8(vget_low_s8 (x0_0), vget_low_s8 (y0_0));
-        const int16x8_t p0_1 = vmull_s8(vget_high_s8(x0_0), vget_high_s8(y0_0));
-        const int16x8_t p0_2 = vmull_s8(vget_low_s8 (x0_1), vget_low_s8 (y0_1));
-        const int16x8_t p0_3 = vmull_s8(vget_high_s8(x0_1), vget_high_s8(y0_1));
-
-        const int16x8_t p1_0 = vmull_s8(vget_low_s8 (x1_0), vget_low_s8 (y1_0));
-        const int16x8_t p1_1 = vmull_s8(vget_high_s8(x1_0), vget_high_s8(y1_0));
-        const int16x8_t p1_2 = vmull_s8(vget_low_s8 (x1_1), vget_low_s8 (y1_1));
-        const int16x8_t p1_3 = vmull_s8(vget_high_s8(x1_1), vget_high_s8(y1_1));
-
-        const int32x4_t p0 = vaddq_s32(vpaddlq_s16(p0_0), vpaddlq_s16(p0_1));
-        const int32x4_t p1 = vaddq_s32(vpaddlq_s16(p0_2), vpaddlq_s16(p0_3));
-        const int32x4_t p2 = vaddq_s32(vpaddlq_s16(p1_0), vpaddlq_s16(p1_1));
-        const int32x4_t p3 = vaddq_s32(vpaddlq_s16(p1_2), vpaddlq_s16(p1_3));
-
-        sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(p0, p1)), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
-        sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(p2, p3)), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
-#endif
+        } else {
+            const int16x8_t p0_0 = vmull_s8(vget_low_s8 (x0_0), vget_low_s8 (y0_0));
+            const int16x8_t p0_1 = vmull_s8(vget_high_s8(x0_0), vget_high_s8(y0_0));
+            const int16x8_t p0_2 = vmull_s8(vget_low_s8 (x0_1), vget_low_s8 (y0_1));
+            const int16x8_t p0_3 = vmull_s8(vget_high_s8(x0_1), vget_high_s8(y0_1));
+
+            const int16x8_t p1_0 = vmull_s8(vget_low_s8 (x1_0), vget_low_s8 (y1_0));
+            const int16x8_t p1_1 = vmull_s8(vget_high_s8(x1_0), vget_high_s8(y1_0));
+            const int16x8_t p1_2 = vmull_s8(vget_low_s8 (x1_1), vget_low_s8 (y1_1));
+            const int16x8_t p1_3 = vmull_s8(vget_high_s8(x1_1), vget_high_s8(y1_1));
+
+            const int32x4_t p0 = vaddq_s32(vpaddlq_s16(p0_0), vpaddlq_s16(p0_1));
+            const int32x4_t p1 = vaddq_s32(vpaddlq_s16(p0_2), vpaddlq_s16(p0_3));
+            const int32x4_t p2 = vaddq_s32(vpaddlq_s16(p1_0), vpaddlq_s16(p1_1));
+            const int32x4_t p3 = vaddq_s32(vpaddlq_s16(p1_2), vpaddlq_s16(p1_3));
+
+            sumv0 = vmlaq_n_f32(sumv0, vcvtq_f32_s32(vaddq_s32(p0, p1)), WSP_GGML_FP16_TO_FP32(x0->d)*WSP_GGML_FP16_TO_FP32(y0->d));
+            sumv1 = vmlaq_n_f32(sumv1, vcvtq_f32_s32(vaddq_s32(p2, p3)), WSP_GGML_FP16_TO_FP32(x1->d)*WSP_GGML_FP16_TO_FP32(y1->d));
+        }
     }
 
     *s = vaddvq_f32(sumv0) + vaddvq_f32(sumv1);
+#elif defined(__AVX512F__) && defined(__AVX512BW__)
+    // Initialize accumulator with zeros
+    __m512 acc = _mm512_setzero_ps();
+
+    // Main loop, two blocks at a time; with an odd nb the last block is paired with itself and a zero scale
+    for (int i = 0; i < nb; i += 2) {
+        const int j = i + 1 < nb ? i + 1 : i;
+
+        // Compute combined scales for the blocks
+        const __m512 d = mm512_set_2x8_ps(
+                j != i ? WSP_GGML_FP16_TO_FP32(x[j].d) * WSP_GGML_FP16_TO_FP32(y[j].d) : 0.0f,
+                WSP_GGML_FP16_TO_FP32(x[i].d) * WSP_GGML_FP16_TO_FP32(y[i].d));
+
+        const __m512i bx = mm512_set_m256i(_mm256_loadu_si256((const __m256i *)x[j].qs), _mm256_loadu_si256((const __m256i *)x[i].qs));
+        const __m512i by = mm512_set_m256i(_mm256_loadu_si256((const __m256i *)y[j].qs), _mm256_loadu_si256((const __m256i *)y[i].qs));
+
+        // Multiply q with scale and accumulate
+        acc = _mm512_fmadd_ps(d, mul_sum_i8_quads_float_x16(bx, by), acc);
+    }
+
+    *s = _mm512_reduce_add_ps(acc);
 #elif defined(__AVX2__) || defined(__AVX__)
     // Initialize accumulator with zeros
     __m256 acc = _mm256_setzero_ps();
@@ -3641,6 +3757,324 @@ void wsp_ggml_vec_dot_q8_0_q8_0(const int n, float * restrict s, const void * re
 #endif
 }
 
+//
+// Tiled dot products (wsp_ggml_type_traits_t.gemm) for the large matrix multiplications: a tile of GEMM_MR rows of x
+// times GEMM_NR rows of y is accumulated in registers, so each block of x is loaded and unpacked once per GEMM_NR
+// rows of y and each block of y once per GEMM_MR rows of x, instead of both once per dot product
+//
+
+#define GEMM_MR 4
+#define GEMM_NR 2
+
+#if defined(__ARM_NEON)
+// unpack block ib of a row of x to 32 signed bytes
+static inline void gemm_unpack_x(const enum wsp_ggml_type type, const char * restrict x, const int ib, int8x16_t * restrict qx, float * restrict d) {
+    switch (type) {
+        case WSP_GGML_TYPE_Q4_0:
+            {
+                const block_q4_0 * restrict b = (const block_q4_0 *) x + ib;
+                const uint8x16_t v = vld1q_u8(b->qs);
+                qx[0] = vsubq_s8(vreinterpretq_s8_u8(vandq_u8(v, vdupq_n_u8(0x0F))), vdupq_n_s8(0x8));
+                qx[1] = vsubq_s8(vreinterpretq_s8_u8(vshrq_n_u8(v, 4)),              vdupq_n_s8(0x8));
+                *d = WSP_GGML_FP16_TO_FP32(b->d);
+            } break;
+        case WSP_GGML_TYPE_Q5_0:
+            {
+                const block_q5_0 * restrict b = (const block_q5_0 *) x + ib;
+                uint32_t qh;
+                uint64_t tmp[4];
+                memcpy(&qh, b->qh, sizeof(qh));
+
+                // extract the 5th bit via lookup table ((!b) << 4)
+                tmp[0] = table_b2b_1[(qh >>  0) & 0xFF];
+                tmp[1] = table_b2b_1[(qh >>  8) & 0xFF];
+                tmp[2] = table_b2b_1[(qh >> 16) & 0xFF];
+                tmp[3] = table_b2b_1[(qh >> 24)       ];
+
+                const uint8x16_t v = vld1q_u8(b->qs);
+                qx[0] = vsubq_s8(vreinterpretq_s8_u8(vandq_u8(v, vdupq_n_u8(0x0F))), vld1q_s8((const int8_t *)(tmp + 0)));
+                qx[1] = vsubq_s8(vreinterpretq_s8_u8(vshrq_n_u8(v, 4)),              vld1q_s8((const int8_t *)(tmp + 2)));
+                *d = WSP_GGML_FP16_TO_FP32(b->d);
+            } break;
+        default:
+            {
+                const block_q8_0 * restrict b = (const block_q8_0 *) x + ib;
+                qx[0] = vld1q_s8(b->qs);
+                qx[1] = vld1q_s8(b->qs + 16);
+                *d = WSP_GGML_FP16_TO_FP32(b->d);
+            } break;
+    }
+}
+
+static inline int32x4_t gemm_dot_s8(const bool dotprod, const int8x16_t * restrict qx, const int8x16_t * restrict qy) {
+    if (dotprod) {
+        return wsp_ggml_vdotq_s32(wsp_ggml_vdotq_s32(vdupq_n_s32(0), qx[0], qy[0]), qx[1], qy[1]);
+    }
+
+    const int16x8_t p0 = vmull_s8(vget_low_s8 (qx[0]), vget_low_s8 (qy[0]));
+    const int16x8_t p1 = vmull_s8(vget_high_s8(qx[0]), vget_high_s8(qy[0]));
+    const int16x8_t p2 = vmull_s8(vget_low_s8 (qx[1]), vget_low_s8 (qy[1]));
+    const int16x8_t p3 = vmull_s8(vget_high_s8(qx[1]), vget_high_s8(qy[1]));
+
+    return vaddq_s32(vaddq_s32(vpaddlq_s16(p0), vpaddlq_s16(p1)), vaddq_s32(vpaddlq_s16(p2), vpaddlq_s16(p3)));
+}
+
+static inline void gemm_q8_0_tile(const enum wsp_ggml_type type, const bool dotprod, const int nb, float * restrict s, const size_t bs,
+        const char * restrict x, const size_t bx, const char * restrict y, const size_t by) {
+    float32x4_t acc[GEMM_MR][GEMM_NR];
+
+    for (int i = 0; i < GEMM_MR; ++i) {
+        for (int j = 0; j < GEMM_NR; ++j) {
+            acc[i][j] = vdupq_n_f32(0.0f);
+        }
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        int8x16_t qy[GEMM_NR][2];
+        float     dy[GEMM_NR];
+
+        for (int j = 0; j < GEMM_NR; ++j) {
+            const block_q8_0 * restrict b = (const block_q8_0 *) (y + j*by) + ib;
+            qy[j][0] = vld1q_s8(b->qs);
+            qy[j][1] = vld1q_s8(b->qs + 16);
+            dy[j] = WSP_GGML_FP16_TO_FP32(b->d);
+        }
+
+        for (int i = 0; i < GEMM_MR; ++i) {
+            int8x16_t qx[2];
+            float     dx;
+            gemm_unpack_x(type, x + i*bx, ib, qx, &dx);
+
+            for (int j = 0; j < GEMM_NR; ++j) {
+                acc[i][j] = vmlaq_n_f32(acc[i][j], vcvtq_f32_s32(gemm_dot_s8(dotprod, qx, qy[j])), dx*dy[j]);
+            }
+        }
+    }
+
+    for (int i = 0; i < GEMM_MR; ++i) {
+        for (int j = 0; j < GEMM_NR; ++j) {
+            s[j*bs + i] = vaddvq_f32(acc[i][j]);
+        }
+    }
+}
+
+#if defined(__aarch64__)
+// i8mm: the rows of x and y are taken in pairs, interleaved by 8 bytes, and each 2x2 group of dot products
+// is 4 smmla per block instead of 8 sdot
+static inline void gemm_q8_0_tile_mmla(const enum wsp_ggml_type type, const int nb, float * restrict s, const size_t bs,
+        const char * restrict x, const size_t bx, const char * restrict y, const size_t by) {
+    // lanes: x_2i.y_2j, x_2i.y_2j+1, x_2i+1.y_2j, x_2i+1.y_2j+1
+    float32x4_t acc[GEMM_MR/2][GEMM_NR/2];
+
+    for (int i = 0; i < GEMM_MR/2; ++i) {
+        for (int j = 0; j < GEMM_NR/2; ++j) {
+            acc[i][j] = vdupq_n_f32(0.0f);
+        }
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        int8x16_t qy[GEMM_NR/2][4];
+        float     dy[GEMM_NR];
+
+        for (int j = 0; j < GEMM_NR/2; ++j) {
+            const block_q8_0 * restrict b0 = (const block_q8_0 *) (y + (2*j + 0)*by) + ib;
+            const block_q8_0 * restrict b1 = (const block_q8_0 *) (y + (2*j + 1)*by) + ib;
+
+            const int64x2_t y0l = vreinterpretq_s64_s8(vld1q_s8(b0->qs));
+            const int64x2_t y0h = vreinterpretq_s64_s8(vld1q_s8(b0->qs + 16));
+            const int64x2_t y1l = vreinterpretq_s64_s8(vld1q_s8(b1->qs));
+            const int64x2_t y1h = vreinterpretq_s64_s8(vld1q_s8(b1->qs + 16));
+
+            qy[j][0] = vreinterpretq_s8_s64(vzip1q_s64(y0l, y1l));
+            qy[j][1] = vreinterpretq_s8_s64(vzip2q_s64(y0l, y1l));
+            qy[j][2] = vreinterpretq_s8_s64(vzip1q_s64(y0h, y1h));
+            qy[j][3] = vreinterpretq_s8_s64(vzip2q_s64(y0h, y1h));
+
+            dy[2*j + 0] = WSP_GGML_FP16_TO_FP32(b0->d);
+            dy[2*j + 1] = WSP_GGML_FP16_TO_FP32(b1->d);
+        }
+
+        for (int i = 0; i < GEMM_MR/2; ++i) {
+            int8x16_t qx0[2];
+            int8x16_t qx1[2];
+            float     dx[2];
+            gemm_unpack_x(type, x + (2*i + 0)*bx, ib, qx0, &dx[0]);
+            gemm_unpack_x(type, x + (2*i + 1)*bx, ib, qx1, &dx[1]);
+
+            const int64x2_t x0l = vreinterpretq_s64_s8(qx0[0]);
+            const int64x2_t x0h = vreinterpretq_s64_s8(qx0[1]);
+            const int64x2_t x1l = vreinterpretq_s64_s8(qx1[0]);
+            const int64x2_t x1h = vreinterpretq_s64_s8(qx1[1]);
+
+            const int8x16_t qx[4] = {
+                vreinterpretq_s8_s64(vzip1q_s64(x0l, x1l)),
+                vreinterpretq_s8_s64(vzip2q_s64(x0l, x1l)),
+                vreinterpretq_s8_s64(vzip1q_s64(x0h, x1h)),
+                vreinterpretq_s8_s64(vzip2q_s64(x0h, x1h)),
+            };
+
+            for (int j = 0; j < GEMM_NR/2; ++j) {
+                int32x4_t p = vdupq_n_s32(0);
+                p = wsp_ggml_vmmlaq_s32(p, qx[0], qy[j][0]);
+                p = wsp_ggml_vmmlaq_s32(p, qx[1], qy[j][1]);
+                p = wsp_ggml_vmmlaq_s32(p, qx[2], qy[j][2]);
+                p = wsp_ggml_vmmlaq_s32(p, qx[3], qy[j][3]);
+
+                const float d[4] = {
+                    dx[0]*dy[2*j + 0], dx[0]*dy[2*j + 1],
+                    dx[1]*dy[2*j + 0], dx[1]*dy[2*j + 1],
+                };
+
+                acc[i][j] = vmlaq_f32(acc[i][j], vcvtq_f32_s32(p), vld1q_f32(d));
+            }
+        }
+    }
+
+    for (int i = 0; i < GEMM_MR/2; ++i) {
+        for (int j = 0; j < GEMM_NR/2; ++j) {
+            s[(2*j + 0)*bs + 2*i + 0] = vgetq_lane_f32(acc[i][j], 0);
+            s[(2*j + 1)*bs + 2*i + 0] = vgetq_lane_f32(acc[i][j], 1);
+            s[(2*j + 0)*bs + 2*i + 1] = vgetq_lane_f32(acc[i][j], 2);
+            s[(2*j + 1)*bs + 2*i + 1] = vgetq_lane_f32(acc[i][j], 3);
+        }
+    }
+}
+#endif
+#elif defined(__AVX2__)
+// unpack block ib of a row of x to 32 signed bytes
+static inline __m256i gemm_unpack_x(const enum wsp_ggml_type type, const char * restrict x, const int ib, float * restrict d) {
+    switch (type) {
+        case WSP_GGML_TYPE_Q4_0:
+            {
+                const block_q4_0 * restrict b = (const block_q4_0 *) x + ib;
+                *d = WSP_GGML_FP16_TO_FP32(b->d);
+                return _mm256_sub_epi8(bytes_from_nibbles_32(b->qs), _mm256_set1_epi8(8));
+            }
+        case WSP_GGML_TYPE_Q5_0:
+            {
+                const block_q5_0 * restrict b = (const block_q5_0 *) x + ib;
+                const __m256i bxhi = _mm256_andnot_si256(bytes_from_bits_32(b->qh), _mm256_set1_epi8((char)0xF0));
+                *d = WSP_GGML_FP16_TO_FP32(b->d);
+                return _mm256_or_si256(bytes_from_nibbles_32(b->qs), bxhi);
+            }
+        default:
+            {
+                const block_q8_0 * restrict b = (const block_q8_0 *) x + ib;
+                *d = WSP_GGML_FP16_TO_FP32(b->d);
+                return _mm256_loadu_si256((const __m256i *) b->qs);
+            }
+    }
+}
+
+static inline void gemm_q8_0_tile(const enum wsp_ggml_type type, const int nb, float * restrict s, const size_t bs,
+        const char * restrict x, const size_t bx, const char * restrict y, const size_t by) {
+    __m256 acc[GEMM_MR][GEMM_NR];
+
+    for (int i = 0; i < GEMM_MR; ++i) {
+        for (int j = 0; j < GEMM_NR; ++j) {
+            acc[i][j] = _mm256_setzero_ps();
+        }
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        __m256i qy[GEMM_NR];
+        float   dy[GEMM_NR];
+
+        for (int j = 0; j < GEMM_NR; ++j) {
+            const block_q8_0 * restrict b = (const block_q8_0 *) (y + j*by) + ib;
+            qy[j] = _mm256_loadu_si256((const __m256i *) b->qs);
+            dy[j] = WSP_GGML_FP16_TO_FP32(b->d);
+        }
+
+        for (int i = 0; i < GEMM_MR; ++i) {
+            float dx;
+            const __m256i qx = gemm_unpack_x(type, x + i*bx, ib, &dx);
+
+            for (int j = 0; j < GEMM_NR; ++j) {
+                acc[i][j] = _mm256_fmadd_ps(_mm256_set1_ps(dx*dy[j]), mul_sum_i8_pairs_float(qx, qy[j]), acc[i][j]);
+            }
+        }
+    }
+
+    for (int i = 0; i < GEMM_MR; ++i) {
+        for (int j = 0; j < GEMM_NR; ++j) {
+            s[j*bs + i] = hsum_float_8(acc[i][j]);
+        }
+    }
+}
+#endif
+
+// the full tiles go through gemm_q8_0_tile, the rows left over (and everything without NEON or AVX2) through vec_dot
+static inline void gemm_q8_0(const enum wsp_ggml_type type, wsp_ggml_vec_dot_t vec_dot, const int n, const int nr0, const int nr1,
+        float * restrict s, const size_t bs, const void * restrict vx, const size_t bx, const void * restrict vy, const size_t by) {
+    const char * restrict x = vx;
+    const char * restrict y = vy;
+
+    assert(n % QK8_0 == 0);
+
+#if defined(__ARM_NEON) || defined(__AVX2__)
+    const int mr = nr0 - nr0 % GEMM_MR;
+    const int nr = nr1 - nr1 % GEMM_NR;
+#else
+    const int mr = 0;
+    const int nr = 0;
+
+    WSP_GGML_UNUSED(type);
+#endif
+
+#if defined(__ARM_NEON)
+    const bool dotprod = WSP_GGML_ARM_DOTPROD;
+#endif
+#if defined(__aarch64__)
+    const bool i8mm    = WSP_GGML_ARM_I8MM;
+#endif
+
+    for (int j = 0; j < nr; j += GEMM_NR) {
+#if defined(__ARM_NEON)
+        for (int i = 0; i < mr; i += GEMM_MR) {
+#if defined(__aarch64__)
+            if (i8mm) {
+                gemm_q8_0_tile_mmla(type, n/QK8_0, s + j*bs + i, bs, x + i*bx, bx, y + j*by, by);
+                continue;
+            }
+#endif
+            if (dotprod) {
+                gemm_q8_0_tile(type, true,  n/QK8_0, s + j*bs + i, bs, x + i*bx, bx, y + j*by, by);
+            } else {
+                gemm_q8_0_tile(type, false, n/QK8_0, s + j*bs + i, bs, x + i*bx, bx, y + j*by, by);
+            }
+        }
+#elif defined(__AVX2__)
+        for (int i = 0; i < mr; i += GEMM_MR) {
+            gemm_q8_0_tile(type, n/QK8_0, s + j*bs + i, bs, x + i*bx, bx, y + j*by, by);
+        }
+#endif
+        for (int jj = j; jj < j + GEMM_NR; ++jj) {
+            for (int i = mr; i < nr0; ++i) {
+                vec_dot(n, s + jj*bs + i, x + i*bx, y + jj*by);
+            }
+        }
+    }
+
+    for (int j = nr; j < nr1; ++j) {
+        for (int i = 0; i < nr0; ++i) {
+            vec_dot(n, s + j*bs + i, x + i*bx, y + j*by);
+        }
+    }
+}
+
+void wsp_ggml_gemm_q4_0_q8_0(const int n, const int nr0, const int nr1, float * restrict s, size_t bs, const void * restrict vx, size_t bx, const void * restrict vy, size_t by) {
+    gemm_q8_0(WSP_GGML_TYPE_Q4_0, wsp_ggml_vec_dot_q4_0_q8_0, n, nr0, nr1, s, bs, vx, bx, vy, by);
+}
+
+void wsp_ggml_gemm_q5_0_q8_0(const int n, const int nr0, const int nr1, float * restrict s, size_t bs, const void * restrict vx, size_t bx, const void * restrict vy, size_t by) {
+    gemm_q8_0(WSP_GGML_TYPE_Q5_0, wsp_ggml_vec_dot_q5_0_q8_0, n, nr0, nr1, s, bs, vx, bx, vy, by);
+}
+
+void wsp_ggml_gemm_q8_0_q8_0(const int n, const int nr0, const int nr1, float * restrict s, size_t bs, const void * restrict vx, size_t bx, const void * restrict vy, size_t by) {
+    gemm_q8_0(WSP_GGML_TYPE_Q8_0, wsp_ggml_vec_dot_q8_0_q8_0, n, nr0, nr1, s, bs, vx, bx, vy, by);
+}
+
 #if QK_K == 256
 void wsp_ggml_vec_dot_q2_K_q8_K(const int n, float * restrict s, const void * restrict vx, const void * restrict vy) {
 
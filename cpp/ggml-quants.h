@@ -222,3 +222,9 @@ void wsp_ggml_vec_dot_q3_K_q8_K(int n, float * restrict s, const void * restrict
 void wsp_ggml_vec_dot_q4_K_q8_K(int n, float * restrict s, const void * restrict vx, const void * restrict vy);
 void wsp_ggml_vec_dot_q5_K_q8_K(int n, float * restrict s, const void * restrict vx, const void * restrict vy);
 void wsp_ggml_vec_dot_q6_K_q8_K(int n, float * restrict s, const void * restrict vx, const void * restrict vy);
+
+// Tiled dot products of nr0 rows of x (row stride bx bytes) with nr1 rows of y (stride by):
+//   s[j*bs + i] = dot(x_i, y_j)
+void wsp_ggml_gemm_q4_0_q8_0(int n, int nr0, int nr1, float * restrict s, size_t bs, const void * restrict vx, size_t bx, const void * restrict vy, size_t by);
+void wsp_ggml_gemm_q5_0_q8_0(int n, int nr0, int nr1, float * restrict s, size_t bs, const void * restrict vx, size_t bx, const void * restrict vy, size_t by);
+void wsp_ggml_gemm_q8_0_q8_0(int n, int nr0, int nr1, float * restrict s, size_t bs, const void * restrict vx, size_t bx, const void * restrict vy, size_t by);
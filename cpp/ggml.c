@@ -104,6 +104,31 @@ typedef void * thread_ret_t;
 #include <TargetConditionals.h>
 #endif
 
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#ifndef AT_HWCAP2
+#define AT_HWCAP2 26
+#endif
+#ifndef HWCAP2_I8MM
+#define HWCAP2_I8MM (1 << 13)
+#endif
+#ifndef HWCAP_ASIMDHP
+#define HWCAP_ASIMDHP (1 << 10)
+#endif
+#elif defined(__aarch64__) && defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define WSP_GGML_X86
+#if !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+#endif
+
 #if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)) && \
     (!defined(TARGET_OS_TV) && !defined(TARGET_OS_WATCH))
 
@@ -155,6 +180,12 @@ void wsp_ggml_print_backtrace(void) {
 #define WSP_GGML_VEC_DOT_UNROLL  2
 #define WSP_GGML_VEC_MAD_UNROLL  32
 
+// F16 flash attention tile: q rows x k/v rows processed together
+#define WSP_GGML_FLASH_ATTN_BR 16
+#define WSP_GGML_FLASH_ATTN_BC 64
+// F32 work buffer of a thread for a head size of D and M k/v rows
+#define WSP_GGML_FLASH_ATTN_WSIZE(D, M) (WSP_GGML_FLASH_ATTN_BR*(2*(D) + WSP_GGML_FLASH_ATTN_BC + 2) + 2*(D)*wsp_ggml_up((M), WSP_GGML_FLASH_ATTN_BC))
+
 //
 // logging
 //
@@ -275,9 +306,173 @@ static wsp_ggml_fp16_t wsp_ggml_table_silu_f16[1 << 16];
 // precomputed exp table for f16 (128 KB)
 static wsp_ggml_fp16_t wsp_ggml_table_exp_f16[1 << 16];
 
+// the f16 tables above are computed on first use, by the first thread that calls wsp_ggml_table_require()
+enum wsp_ggml_table {
+    WSP_GGML_TABLE_GELU,
+    WSP_GGML_TABLE_GELU_QUICK,
+    WSP_GGML_TABLE_SILU,
+    WSP_GGML_TABLE_EXP,
+
+    WSP_GGML_TABLE_COUNT,
+};
+
+static void wsp_ggml_table_require(enum wsp_ggml_table table);
+
 // precomputed f32 table for f16 (256 KB) (ggml-impl.h)
+// only filled when WSP_GGML_FP16_TO_FP32 is a lookup into it
 float wsp_ggml_table_f32_f16[1 << 16];
 
+// optional CPU instructions (ggml-impl.h)
+struct wsp_ggml_cpu_features wsp_ggml_cpu_features;
+
+#if defined(__aarch64__) && defined(__APPLE__)
+static bool wsp_ggml_sysctl_flag(const char * name) {
+    int value = 0;
+    size_t size = sizeof(value);
+    return sysctlbyname(name, &value, &size, NULL, 0) == 0 && value != 0;
+}
+#endif
+
+#if defined(WSP_GGML_X86)
+static void wsp_ggml_cpuid(const unsigned leaf, const unsigned subleaf, unsigned r[4]) {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuidex(regs, leaf, subleaf);
+    memcpy(r, regs, sizeof(regs));
+#else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// register state saved by the OS on context switches (XCR0)
+static uint64_t wsp_ggml_xgetbv(void) {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t) edx << 32) | eax;
+#endif
+}
+
+static void wsp_ggml_detect_x86_features(struct wsp_ggml_cpu_features * f) {
+    unsigned r[4];
+
+    wsp_ggml_cpuid(0, 0, r);
+    const unsigned max_leaf = r[0];
+
+    wsp_ggml_cpuid(1, 0, r);
+    const unsigned ecx1 = r[2];
+
+    const uint64_t xcr0 = (ecx1 & (1u << 27)) ? wsp_ggml_xgetbv() : 0; // OSXSAVE
+    const bool os_avx    = (xcr0 & 0x06) == 0x06; // XMM, YMM
+    const bool os_avx512 = (xcr0 & 0xe6) == 0xe6; // XMM, YMM, opmask, ZMM
+
+    f->x86_sse3  = (ecx1 & (1u <<  0)) != 0;
+    f->x86_ssse3 = (ecx1 & (1u <<  9)) != 0;
+    f->x86_avx   = (ecx1 & (1u << 28)) != 0 && os_avx;
+    f->x86_fma   = (ecx1 & (1u << 12)) != 0 && f->x86_avx;
+    f->x86_f16c  = (ecx1 & (1u << 29)) != 0 && f->x86_avx;
+
+    if (max_leaf >= 7) {
+        wsp_ggml_cpuid(7, 0, r);
+        const unsigned max_subleaf = r[0];
+
+        f->x86_avx2        = (r[1] & (1u <<  5)) != 0 && f->x86_avx;
+        f->x86_avx512f     = (r[1] & (1u << 16)) != 0 && os_avx512;
+        f->x86_avx512bw    = (r[1] & (1u << 30)) != 0 && f->x86_avx512f;
+        f->x86_avx512_vnni = (r[2] & (1u << 11)) != 0 && f->x86_avx512f;
+
+        if (max_subleaf >= 1) {
+            wsp_ggml_cpuid(7, 1, r);
+            f->x86_avx_vnni = (r[0] & (1u << 4)) != 0 && f->x86_avx;
+        }
+    }
+}
+#endif
+
+static void wsp_ggml_detect_cpu_features(struct wsp_ggml_cpu_features * f) {
+    memset(f, 0, sizeof(*f));
+
+#if defined(WSP_GGML_X86)
+    wsp_ggml_detect_x86_features(f);
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+    const unsigned long hwcap  = getauxval(AT_HWCAP);
+    const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+
+    f->arm_dotprod = (hwcap  & HWCAP_ASIMDDP) != 0;
+    f->arm_i8mm    = (hwcap2 & HWCAP2_I8MM)   != 0;
+    f->arm_fp16    = (hwcap  & HWCAP_ASIMDHP) != 0;
+#elif defined(__aarch64__) && defined(__APPLE__)
+    f->arm_dotprod = wsp_ggml_sysctl_flag("hw.optional.arm.FEAT_DotProd");
+    f->arm_i8mm    = wsp_ggml_sysctl_flag("hw.optional.arm.FEAT_I8MM");
+    f->arm_fp16    = wsp_ggml_sysctl_flag("hw.optional.arm.FEAT_FP16");
+#else
+    // no runtime detection, trust the build
+#if defined(__ARM_FEATURE_DOTPROD)
+    f->arm_dotprod = true;
+#endif
+#if defined(__ARM_FEATURE_MATMUL_INT8)
+    f->arm_i8mm = true;
+#endif
+#if defined(__ARM_FEATURE_FP16_VECTOR_ARITHMETIC)
+    f->arm_fp16 = true;
+#endif
+#endif
+}
+
+// the instructions the build was compiled for are used anywhere (wsp_ggml_vec_*, WSP_GGML_F16_VEC, compiler
+// generated code), only the type_traits kernels are selected at runtime, so a CPU lacking one of them cannot
+// run the library: the first one missing, or NULL
+static const char * wsp_ggml_cpu_missing_feature(const struct wsp_ggml_cpu_features * f) {
+#if defined(WSP_GGML_X86)
+#if defined(__SSE3__)
+    if (!f->x86_sse3) return "SSE3";
+#endif
+#if defined(__SSSE3__)
+    if (!f->x86_ssse3) return "SSSE3";
+#endif
+#if defined(__AVX__)
+    if (!f->x86_avx) return "AVX";
+#endif
+#if defined(__AVX2__)
+    if (!f->x86_avx2) return "AVX2";
+#endif
+#if defined(__FMA__)
+    if (!f->x86_fma) return "FMA";
+#endif
+#if defined(__F16C__)
+    if (!f->x86_f16c) return "F16C";
+#endif
+#if defined(__AVX512F__)
+    if (!f->x86_avx512f) return "AVX512F";
+#endif
+#if defined(__AVX512BW__)
+    if (!f->x86_avx512bw) return "AVX512BW";
+#endif
+#if defined(__AVX512VNNI__)
+    if (!f->x86_avx512_vnni) return "AVX512_VNNI";
+#endif
+#if defined(__AVXVNNI__)
+    if (!f->x86_avx_vnni) return "AVX_VNNI";
+#endif
+#endif
+#if defined(__ARM_FEATURE_DOTPROD)
+    if (!f->arm_dotprod) return "ARM dotprod";
+#endif
+#if defined(__ARM_FEATURE_MATMUL_INT8)
+    if (!f->arm_i8mm) return "ARM i8mm";
+#endif
+#if defined(__ARM_FEATURE_FP16_VECTOR_ARITHMETIC)
+    if (!f->arm_fp16) return "ARM FP16 vector arithmetic";
+#endif
+    UNUSED(f);
+
+    return NULL;
+}
+
 // note: do not use these inside ggml.c
 // these are meant to be used via the ggml.h API
 float wsp_ggml_fp16_to_fp32(wsp_ggml_fp16_t x) {
@@ -289,13 +484,33 @@ wsp_ggml_fp16_t wsp_ggml_fp32_to_fp16(float x) {
 }
 
 void wsp_ggml_fp16_to_fp32_row(const wsp_ggml_fp16_t * x, float * y, int n) {
-    for (int i = 0; i < n; i++) {
+    int i = 0;
+#if defined(__AVX512F__)
+    for (; i + 15 < n; i += 16) {
+        __m256i x_vec = _mm256_loadu_si256((const __m256i *)(x + i));
+        _mm512_storeu_ps(y + i, _mm512_cvtph_ps(x_vec));
+    }
+#endif
+#if defined(__F16C__)
+    for (; i + 7 < n; i += 8) {
+        __m128i x_vec = _mm_loadu_si128((const __m128i *)(x + i));
+        _mm256_storeu_ps(y + i, _mm256_cvtph_ps(x_vec));
+    }
+#endif
+    for (; i < n; i++) {
         y[i] = WSP_GGML_FP16_TO_FP32(x[i]);
     }
 }
 
 void wsp_ggml_fp32_to_fp16_row(const float * x, wsp_ggml_fp16_t * y, int n) {
     int i = 0;
+#if defined(__AVX512F__)
+    for (; i + 15 < n; i += 16) {
+        __m512 x_vec = _mm512_loadu_ps(x + i);
+        __m256i y_vec = _mm512_cvtps_ph(x_vec, _MM_FROUND_TO_NEAREST_INT);
+        _mm256_storeu_si256((__m256i *)(y + i), y_vec);
+    }
+#endif
 #if defined(__F16C__)
     for (; i + 7 < n; i += 8) {
         __m256 x_vec = _mm256_loadu_ps(x + i);
@@ -393,8 +608,10 @@ static const size_t CACHE_LINE_SIZE_F32 = CACHE_LINE_SIZE/sizeof(float);
 
 static void wsp_ggml_vec_dot_f32(const int n, float * restrict s, const float * restrict x, const float * restrict y);
 static void wsp_ggml_vec_dot_f16(const int n, float * restrict s, wsp_ggml_fp16_t * restrict x, wsp_ggml_fp16_t * restrict y);
+static void wsp_ggml_gemm_f16(const int n, const int nr0, const int nr1, float * restrict s, size_t bs, const void * restrict x, size_t bx, const void * restrict y, size_t by);
 
-static const wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
+// not const: wsp_ggml_init() can replace the kernels with the ones of wsp_ggml_cpu_select_kernels()
+static wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
     [WSP_GGML_TYPE_I8] = {
         .type_name                = "i8",
         .blck_size                = 1,
@@ -431,6 +648,7 @@ static const wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
         .from_float_reference     = (wsp_ggml_from_float_t) wsp_ggml_fp32_to_fp16_row,
         .vec_dot                  = (wsp_ggml_vec_dot_t) wsp_ggml_vec_dot_f16,
         .vec_dot_type             = WSP_GGML_TYPE_F16,
+        .gemm                     = wsp_ggml_gemm_f16,
     },
     [WSP_GGML_TYPE_Q4_0] = {
         .type_name                = "q4_0",
@@ -442,6 +660,7 @@ static const wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
         .from_float_reference     = (wsp_ggml_from_float_t) wsp_quantize_row_q4_0_reference,
         .vec_dot                  = wsp_ggml_vec_dot_q4_0_q8_0,
         .vec_dot_type             = WSP_GGML_TYPE_Q8_0,
+        .gemm                     = wsp_ggml_gemm_q4_0_q8_0,
     },
     [WSP_GGML_TYPE_Q4_1] = {
         .type_name                = "q4_1",
@@ -486,6 +705,7 @@ static const wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
         .from_float_reference     = (wsp_ggml_from_float_t) wsp_quantize_row_q5_0_reference,
         .vec_dot                  = wsp_ggml_vec_dot_q5_0_q8_0,
         .vec_dot_type             = WSP_GGML_TYPE_Q8_0,
+        .gemm                     = wsp_ggml_gemm_q5_0_q8_0,
     },
     [WSP_GGML_TYPE_Q5_1] = {
         .type_name                = "q5_1",
@@ -508,6 +728,7 @@ static const wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
         .from_float_reference     = (wsp_ggml_from_float_t) wsp_quantize_row_q8_0_reference,
         .vec_dot                  = wsp_ggml_vec_dot_q8_0_q8_0,
         .vec_dot_type             = WSP_GGML_TYPE_Q8_0,
+        .gemm                     = wsp_ggml_gemm_q8_0_q8_0,
     },
     [WSP_GGML_TYPE_Q8_1] = {
         .type_name                = "q8_1",
@@ -582,6 +803,35 @@ static const wsp_ggml_type_traits_t type_traits[WSP_GGML_TYPE_COUNT] = {
     }
 };
 
+// kernels built for a newer instruction set than the rest of the library, if the CPU has it
+static const struct wsp_ggml_cpu_kernels * wsp_ggml_cpu_select_kernels(const struct wsp_ggml_cpu_features * f) {
+#if defined(WSP_GGML_X86) && !defined(__AVX2__)
+    if (f->x86_avx2 && f->x86_fma && f->x86_f16c) {
+        return wsp_ggml_cpu_kernels_avx2_get();
+    }
+#endif
+    UNUSED(f);
+
+    return NULL;
+}
+
+static void wsp_ggml_cpu_apply_kernels(const struct wsp_ggml_cpu_kernels * k) {
+    for (int i = 0; i < WSP_GGML_TYPE_COUNT; ++i) {
+        if (k->to_float[i]) {
+            type_traits[i].to_float = k->to_float[i];
+        }
+        if (k->from_float[i]) {
+            type_traits[i].from_float = k->from_float[i];
+        }
+        if (k->vec_dot[i]) {
+            type_traits[i].vec_dot = k->vec_dot[i];
+        }
+        if (k->gemm[i]) {
+            type_traits[i].gemm = k->gemm[i];
+        }
+    }
+}
+
 // For internal test use
 wsp_ggml_type_traits_t wsp_ggml_internal_get_type_traits(enum wsp_ggml_type type) {
     WSP_GGML_ASSERT(type < WSP_GGML_TYPE_COUNT);
@@ -730,6 +980,78 @@ inline static float vaddvq_f32(float32x4_t v) {
     #define WSP_GGML_F16_VEC_REDUCE         WSP_GGML_F32Cx4_REDUCE
 #endif
 
+#elif defined(__AVX512F__)
+
+#define WSP_GGML_SIMD
+
+// F32 AVX512
+
+#define WSP_GGML_F32_STEP 64
+#define WSP_GGML_F32_EPR  16
+
+#define WSP_GGML_F32x16         __m512
+#define WSP_GGML_F32x16_ZERO    _mm512_setzero_ps()
+#define WSP_GGML_F32x16_SET1(x) _mm512_set1_ps(x)
+#define WSP_GGML_F32x16_LOAD    _mm512_loadu_ps
+#define WSP_GGML_F32x16_STORE   _mm512_storeu_ps
+#define WSP_GGML_F32x16_FMA(a, b, c) _mm512_fmadd_ps(b, c, a)
+#define WSP_GGML_F32x16_ADD     _mm512_add_ps
+#define WSP_GGML_F32x16_MUL     _mm512_mul_ps
+#define WSP_GGML_F32x16_REDUCE(res, x)                                \
+do {                                                              \
+    int offset = WSP_GGML_F32_ARR >> 1;                               \
+    for (int i = 0; i < offset; ++i) {                            \
+        x[i] = _mm512_add_ps(x[i], x[offset+i]);                  \
+    }                                                             \
+    offset >>= 1;                                                 \
+    for (int i = 0; i < offset; ++i) {                            \
+        x[i] = _mm512_add_ps(x[i], x[offset+i]);                  \
+    }                                                             \
+    offset >>= 1;                                                 \
+    for (int i = 0; i < offset; ++i) {                            \
+        x[i] = _mm512_add_ps(x[i], x[offset+i]);                  \
+    }                                                             \
+    res = _mm512_reduce_add_ps(x[0]);                             \
+} while (0)
+
+#define WSP_GGML_F32_VEC        WSP_GGML_F32x16
+#define WSP_GGML_F32_VEC_ZERO   WSP_GGML_F32x16_ZERO
+#define WSP_GGML_F32_VEC_SET1   WSP_GGML_F32x16_SET1
+#define WSP_GGML_F32_VEC_LOAD   WSP_GGML_F32x16_LOAD
+#define WSP_GGML_F32_VEC_STORE  WSP_GGML_F32x16_STORE
+#define WSP_GGML_F32_VEC_FMA    WSP_GGML_F32x16_FMA
+#define WSP_GGML_F32_VEC_ADD    WSP_GGML_F32x16_ADD
+#define WSP_GGML_F32_VEC_MUL    WSP_GGML_F32x16_MUL
+#define WSP_GGML_F32_VEC_REDUCE WSP_GGML_F32x16_REDUCE
+
+// F16 AVX512
+
+#define WSP_GGML_F16_STEP 64
+#define WSP_GGML_F16_EPR  16
+
+// F16 arithmetic is not supported by AVX512F, so we use F32 instead
+// unlike the 256-bit ones, the 512-bit conversions are part of AVX512F and do not need F16C
+
+#define WSP_GGML_F32Cx16             __m512
+#define WSP_GGML_F32Cx16_ZERO        _mm512_setzero_ps()
+#define WSP_GGML_F32Cx16_SET1(x)     _mm512_set1_ps(x)
+#define WSP_GGML_F32Cx16_LOAD(x)     _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(x)))
+#define WSP_GGML_F32Cx16_STORE(x, y) _mm256_storeu_si256((__m256i *)(x), _mm512_cvtps_ph(y, 0))
+#define WSP_GGML_F32Cx16_FMA         WSP_GGML_F32x16_FMA
+#define WSP_GGML_F32Cx16_ADD         _mm512_add_ps
+#define WSP_GGML_F32Cx16_MUL         _mm512_mul_ps
+#define WSP_GGML_F32Cx16_REDUCE      WSP_GGML_F32x16_REDUCE
+
+#define WSP_GGML_F16_VEC                WSP_GGML_F32Cx16
+#define WSP_GGML_F16_VEC_ZERO           WSP_GGML_F32Cx16_ZERO
+#define WSP_GGML_F16_VEC_SET1           WSP_GGML_F32Cx16_SET1
+#define WSP_GGML_F16_VEC_LOAD(p, i)     WSP_GGML_F32Cx16_LOAD(p)
+#define WSP_GGML_F16_VEC_STORE(p, r, i) WSP_GGML_F32Cx16_STORE(p, r[i])
+#define WSP_GGML_F16_VEC_FMA            WSP_GGML_F32Cx16_FMA
+#define WSP_GGML_F16_VEC_ADD            WSP_GGML_F32Cx16_ADD
+#define WSP_GGML_F16_VEC_MUL            WSP_GGML_F32Cx16_MUL
+#define WSP_GGML_F16_VEC_REDUCE         WSP_GGML_F32Cx16_REDUCE
+
 #elif defined(__AVX__)
 
 #define WSP_GGML_SIMD
@@ -1119,6 +1441,33 @@ static inline void __sse_f16x4_store(wsp_ggml_fp16_t *x, __m128 y) {
 #define WSP_GGML_F16_ARR (WSP_GGML_F16_STEP/WSP_GGML_F16_EPR)
 #endif
 
+// WSP_GGML_CONV_1D_K3_T
+//   output samples of a wsp_ggml_conv_1d_k3 register tile
+#ifdef WSP_GGML_SIMD
+#define WSP_GGML_CONV_1D_K3_T (2*WSP_GGML_F32_EPR)
+#else
+#define WSP_GGML_CONV_1D_K3_T 8
+#endif
+
+// WSP_GGML_GEMM_MIN_ROWS
+//   src1 rows from which mul_mat uses the tiled wsp_ggml_type_traits_t.gemm instead of one vec_dot per output
+// WSP_GGML_GEMM_BLCK_0, WSP_GGML_GEMM_BLCK_1
+//   src0 rows x src1 rows of a gemm cache block
+// WSP_GGML_GEMM_F16_MR, WSP_GGML_GEMM_F16_NR
+//   src0 rows x src1 rows of a wsp_ggml_gemm_f16 register tile
+#define WSP_GGML_GEMM_MIN_ROWS 2
+#define WSP_GGML_GEMM_BLCK_0   64
+#define WSP_GGML_GEMM_BLCK_1   64
+#define WSP_GGML_GEMM_F16_MR   4
+#define WSP_GGML_GEMM_F16_NR   2
+
+// WSP_GGML_GEMM_F16_KB
+//   elements of the rows after which the fp16 accumulators of wsp_ggml_gemm_f16 are added to f32 ones,
+//   with FP16 vector arithmetic a full row (4*n_state) summed in one fp16 lane loses precision
+#if defined(__ARM_FEATURE_FP16_VECTOR_ARITHMETIC)
+#define WSP_GGML_GEMM_F16_KB   64
+#endif
+
 //
 // fundamental operations
 //
@@ -1270,6 +1619,129 @@ inline static void wsp_ggml_vec_dot_f16_unroll(const int n, const int xs, float
     }
 }
 
+// tiled dot products (wsp_ggml_type_traits_t.gemm): s[j*bs + i] = dot(x_i, y_j)
+// a WSP_GGML_GEMM_F16_MR x WSP_GGML_GEMM_F16_NR tile is accumulated in registers, so every vector of x is loaded
+// (and converted) once per WSP_GGML_GEMM_F16_NR rows of y and every vector of y once per WSP_GGML_GEMM_F16_MR rows of x
+
+static void wsp_ggml_gemm_f16(const int n, const int nr0, const int nr1, float * restrict s, size_t bs, const void * restrict x, size_t bx, const void * restrict y, size_t by) {
+#if defined(WSP_GGML_SIMD)
+    const int np = (n & ~(WSP_GGML_F16_EPR - 1));
+
+    const int mr = nr0 - nr0 % WSP_GGML_GEMM_F16_MR;
+    const int nr = nr1 - nr1 % WSP_GGML_GEMM_F16_NR;
+
+    for (int j = 0; j < nr; j += WSP_GGML_GEMM_F16_NR) {
+        wsp_ggml_fp16_t * restrict ys[WSP_GGML_GEMM_F16_NR];
+
+        for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+            ys[jj] = (wsp_ggml_fp16_t *) ((const char *) y + (j + jj)*by);
+        }
+
+        for (int i = 0; i < mr; i += WSP_GGML_GEMM_F16_MR) {
+            wsp_ggml_fp16_t * restrict xs[WSP_GGML_GEMM_F16_MR];
+
+            for (int ii = 0; ii < WSP_GGML_GEMM_F16_MR; ++ii) {
+                xs[ii] = (wsp_ggml_fp16_t *) ((const char *) x + (i + ii)*bx);
+            }
+
+            WSP_GGML_F16_VEC sum[WSP_GGML_GEMM_F16_MR][WSP_GGML_GEMM_F16_NR];
+
+            for (int ii = 0; ii < WSP_GGML_GEMM_F16_MR; ++ii) {
+                for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+                    sum[ii][jj] = WSP_GGML_F16_VEC_ZERO;
+                }
+            }
+
+#if defined(WSP_GGML_GEMM_F16_KB)
+            float32x4_t sum32[WSP_GGML_GEMM_F16_MR][WSP_GGML_GEMM_F16_NR][2];
+
+            for (int ii = 0; ii < WSP_GGML_GEMM_F16_MR; ++ii) {
+                for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+                    sum32[ii][jj][0] = vdupq_n_f32(0.0f);
+                    sum32[ii][jj][1] = vdupq_n_f32(0.0f);
+                }
+            }
+
+            for (int k0 = 0; k0 < np; k0 += WSP_GGML_GEMM_F16_KB) {
+                const int k1 = MIN(k0 + WSP_GGML_GEMM_F16_KB, np);
+#else
+            {
+                const int k0 = 0;
+                const int k1 = np;
+#endif
+                for (int k = k0; k < k1; k += WSP_GGML_F16_EPR) {
+                    WSP_GGML_F16_VEC ay[WSP_GGML_GEMM_F16_NR];
+
+                    for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+                        ay[jj] = WSP_GGML_F16_VEC_LOAD(ys[jj] + k, 0);
+                    }
+
+                    for (int ii = 0; ii < WSP_GGML_GEMM_F16_MR; ++ii) {
+                        const WSP_GGML_F16_VEC ax = WSP_GGML_F16_VEC_LOAD(xs[ii] + k, 0);
+
+                        for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+                            sum[ii][jj] = WSP_GGML_F16_VEC_FMA(sum[ii][jj], ax, ay[jj]);
+                        }
+                    }
+                }
+#if defined(WSP_GGML_GEMM_F16_KB)
+                for (int ii = 0; ii < WSP_GGML_GEMM_F16_MR; ++ii) {
+                    for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+                        sum32[ii][jj][0] = vaddq_f32(sum32[ii][jj][0], vcvt_f32_f16(vget_low_f16 (sum[ii][jj])));
+                        sum32[ii][jj][1] = vaddq_f32(sum32[ii][jj][1], vcvt_f32_f16(vget_high_f16(sum[ii][jj])));
+                        sum[ii][jj] = WSP_GGML_F16_VEC_ZERO;
+                    }
+                }
+#endif
+            }
+
+            for (int ii = 0; ii < WSP_GGML_GEMM_F16_MR; ++ii) {
+                for (int jj = 0; jj < WSP_GGML_GEMM_F16_NR; ++jj) {
+#if defined(WSP_GGML_GEMM_F16_KB)
+                    wsp_ggml_float sumf = vaddvq_f32(vaddq_f32(sum32[ii][jj][0], sum32[ii][jj][1]));
+#else
+                    // the reduce macros work on WSP_GGML_F16_ARR accumulators
+                    WSP_GGML_F16_VEC acc[WSP_GGML_F16_ARR] = { sum[ii][jj] };
+                    wsp_ggml_float sumf = 0.0;
+
+                    for (int r = 1; r < WSP_GGML_F16_ARR; ++r) {
+                        acc[r] = WSP_GGML_F16_VEC_ZERO;
+                    }
+
+                    WSP_GGML_F16_VEC_REDUCE(sumf, acc);
+#endif
+
+                    // leftovers
+                    for (int k = np; k < n; ++k) {
+                        sumf += (wsp_ggml_float)(WSP_GGML_FP16_TO_FP32(xs[ii][k])*WSP_GGML_FP16_TO_FP32(ys[jj][k]));
+                    }
+
+                    s[(j + jj)*bs + i + ii] = sumf;
+                }
+            }
+        }
+
+        for (int jj = j; jj < j + WSP_GGML_GEMM_F16_NR; ++jj) {
+            for (int i = mr; i < nr0; ++i) {
+                wsp_ggml_vec_dot_f16(n, s + jj*bs + i, (wsp_ggml_fp16_t *) ((const char *) x + i*bx), (wsp_ggml_fp16_t *) ((const char *) y + jj*by));
+            }
+        }
+    }
+
+    for (int j = nr; j < nr1; ++j) {
+        for (int i = 0; i < nr0; ++i) {
+            wsp_ggml_vec_dot_f16(n, s + j*bs + i, (wsp_ggml_fp16_t *) ((const char *) x + i*bx), (wsp_ggml_fp16_t *) ((const char *) y + j*by));
+        }
+    }
+#else
+    for (int j = 0; j < nr1; ++j) {
+        for (int i = 0; i < nr0; ++i) {
+            wsp_ggml_vec_dot_f16(n, s + j*bs + i, (wsp_ggml_fp16_t *) ((const char *) x + i*bx), (wsp_ggml_fp16_t *) ((const char *) y + j*by));
+        }
+    }
+#endif
+}
+
 inline static void wsp_ggml_vec_mad_f32(const int n, float * restrict y, const float * restrict x, const float v) {
 #if defined(WSP_GGML_SIMD)
     const int np = (n & ~(WSP_GGML_F32_STEP - 1));
@@ -1401,33 +1873,268 @@ static const float GELU_COEF_A     = 0.044715f;
 static const float GELU_QUICK_COEF = -1.702f;
 static const float SQRT_2_OVER_PI  = 0.79788456080286535587989211986876f;
 
+// use the 64K F16 tables for GELU, Quick GELU, SILU and EXP instead of the SIMD kernels below
+// set once in wsp_ggml_init, the tables are only computed when this is true
+static bool wsp_ggml_act_use_tables = true;
+
+//
+// SIMD exp
+//
+// exp(x) = 2^n * exp(b) with n = round(x/ln(2)) and a degree-5 polynomial for exp(b) - 1 on |b| <= ln(2)/2,
+// max error ~1.5 ulp; inputs with |n| > 126 take a slower path that handles overflow, underflow and -INF
+//
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+
+#define WSP_GGML_V_EXPF
+
+#define WSP_GGML_V_EPR    4
+#define WSP_GGML_V        float32x4_t
+#define WSP_GGML_V_LOAD   vld1q_f32
+#define WSP_GGML_V_STORE  vst1q_f32
+#define WSP_GGML_V_SET1   vdupq_n_f32
+#define WSP_GGML_V_ADD    vaddq_f32
+#define WSP_GGML_V_SUB    vsubq_f32
+#define WSP_GGML_V_MUL    vmulq_f32
+#define WSP_GGML_V_DIV    vdivq_f32
+#define WSP_GGML_V_REDUCE vaddvq_f32
+
+inline static float32x4_t wsp_ggml_v_expf(float32x4_t x) {
+    const float32x4_t r = vdupq_n_f32(0x1.8p23f);
+    const float32x4_t z = vfmaq_f32(r, x, vdupq_n_f32(0x1.715476p+0f));
+    const float32x4_t n = vsubq_f32(z, r);
+    const float32x4_t b = vfmsq_f32(vfmsq_f32(x, n, vdupq_n_f32(0x1.62e4p-1f)), n, vdupq_n_f32(0x1.7f7d1cp-20f));
+    const uint32x4_t  e = vshlq_n_u32(vreinterpretq_u32_f32(z), 23);
+    const float32x4_t k = vreinterpretq_f32_u32(vaddq_u32(e, vreinterpretq_u32_f32(vdupq_n_f32(1))));
+    const uint32x4_t  c = vcagtq_f32(n, vdupq_n_f32(126));
+    const float32x4_t u = vmulq_f32(b, b);
+    const float32x4_t j = vfmaq_f32(
+            vmulq_f32(vdupq_n_f32(0x1.ffffecp-1f), b),
+            vfmaq_f32(vfmaq_f32(vdupq_n_f32(0x1.fffdb6p-2f), vdupq_n_f32(0x1.555e66p-3f), b),
+                      vfmaq_f32(vdupq_n_f32(0x1.573e2ep-5f), vdupq_n_f32(0x1.0e4020p-7f), b), u), u);
+    if (!vpaddd_u64(vreinterpretq_u64_u32(c))) {
+        return vfmaq_f32(k, j, k);
+    }
+    const uint32x4_t  d  = vandq_u32(vclezq_f32(n), vdupq_n_u32(0x82000000));
+    const float32x4_t s1 = vreinterpretq_f32_u32(vaddq_u32(d, vdupq_n_u32(0x7f000000)));
+    const float32x4_t s2 = vreinterpretq_f32_u32(vsubq_u32(e, d));
+    return vbslq_f32(vcagtq_f32(n, vdupq_n_f32(192)), vmulq_f32(s1, s1),
+                     vbslq_f32(c, vmulq_f32(vfmaq_f32(s2, s2, j), s1), vfmaq_f32(k, k, j)));
+}
+
+#elif defined(__AVX512F__)
+
+#define WSP_GGML_V_EXPF
+
+#define WSP_GGML_V_EPR    16
+#define WSP_GGML_V        __m512
+#define WSP_GGML_V_LOAD   _mm512_loadu_ps
+#define WSP_GGML_V_STORE  _mm512_storeu_ps
+#define WSP_GGML_V_SET1   _mm512_set1_ps
+#define WSP_GGML_V_ADD    _mm512_add_ps
+#define WSP_GGML_V_SUB    _mm512_sub_ps
+#define WSP_GGML_V_MUL    _mm512_mul_ps
+#define WSP_GGML_V_DIV    _mm512_div_ps
+#define WSP_GGML_V_REDUCE _mm512_reduce_add_ps
+
+inline static __m512 wsp_ggml_v_expf(__m512 x) {
+    const __m512 r = _mm512_set1_ps(0x1.8p23f);
+    const __m512 z = _mm512_fmadd_ps(x, _mm512_set1_ps(0x1.715476p+0f), r);
+    const __m512 n = _mm512_sub_ps(z, r);
+    const __m512 b = _mm512_fnmadd_ps(n, _mm512_set1_ps(0x1.7f7d1cp-20f),
+                     _mm512_fnmadd_ps(n, _mm512_set1_ps(0x1.62e4p-1f), x));
+    const __mmask16 d = _mm512_cmp_ps_mask(_mm512_abs_ps(n), _mm512_set1_ps(192), _CMP_GT_OQ);
+    const __m512 u = _mm512_mul_ps(b, b);
+    const __m512 j = _mm512_fmadd_ps(
+            _mm512_fmadd_ps(_mm512_fmadd_ps(_mm512_set1_ps(0x1.0e4020p-7f), b, _mm512_set1_ps(0x1.573e2ep-5f)), u,
+                            _mm512_fmadd_ps(_mm512_set1_ps(0x1.555e66p-3f), b, _mm512_set1_ps(0x1.fffdb6p-2f))), u,
+            _mm512_fmadd_ps(_mm512_set1_ps(0x1.ffffecp-1f), b, _mm512_set1_ps(1.0f)));
+    const __m512 res = _mm512_scalef_ps(j, n);
+    if (_mm512_kortestz(d, d)) {
+        return res;
+    }
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 alt  = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(n, zero, _CMP_LE_OQ), _mm512_set1_ps(INFINITY), zero);
+    return _mm512_mask_blend_ps(d, res, alt);
+}
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+#define WSP_GGML_V_EXPF
+
+#define WSP_GGML_V_EPR    8
+#define WSP_GGML_V        __m256
+#define WSP_GGML_V_LOAD   _mm256_loadu_ps
+#define WSP_GGML_V_STORE  _mm256_storeu_ps
+#define WSP_GGML_V_SET1   _mm256_set1_ps
+#define WSP_GGML_V_ADD    _mm256_add_ps
+#define WSP_GGML_V_SUB    _mm256_sub_ps
+#define WSP_GGML_V_MUL    _mm256_mul_ps
+#define WSP_GGML_V_DIV    _mm256_div_ps
+#define WSP_GGML_V_REDUCE wsp_ggml_v_reduce
+
+inline static float wsp_ggml_v_reduce(__m256 x) {
+    __m128 res = _mm_add_ps(_mm256_extractf128_ps(x, 1), _mm256_castps256_ps128(x));
+    res = _mm_add_ps(res, _mm_movehl_ps(res, res));
+    res = _mm_add_ss(res, _mm_movehdup_ps(res));
+    return _mm_cvtss_f32(res);
+}
+
+inline static __m256 wsp_ggml_v_expf(__m256 x) {
+    const __m256  r = _mm256_set1_ps(0x1.8p23f);
+    const __m256  z = _mm256_fmadd_ps(x, _mm256_set1_ps(0x1.715476p+0f), r);
+    const __m256  n = _mm256_sub_ps(z, r);
+    const __m256  b = _mm256_fnmadd_ps(n, _mm256_set1_ps(0x1.7f7d1cp-20f),
+                      _mm256_fnmadd_ps(n, _mm256_set1_ps(0x1.62e4p-1f), x));
+    const __m256i e = _mm256_slli_epi32(_mm256_castps_si256(z), 23);
+    const __m256  k = _mm256_castsi256_ps(_mm256_add_epi32(e, _mm256_castps_si256(_mm256_set1_ps(1))));
+    const __m256i c = _mm256_castps_si256(_mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.f), n), _mm256_set1_ps(126), _CMP_GT_OQ));
+    const __m256  u = _mm256_mul_ps(b, b);
+    const __m256  j = _mm256_fmadd_ps(
+            _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_set1_ps(0x1.0e4020p-7f), b, _mm256_set1_ps(0x1.573e2ep-5f)), u,
+                            _mm256_fmadd_ps(_mm256_set1_ps(0x1.555e66p-3f), b, _mm256_set1_ps(0x1.fffdb6p-2f))), u,
+            _mm256_mul_ps(_mm256_set1_ps(0x1.ffffecp-1f), b));
+    if (!_mm256_movemask_ps(_mm256_castsi256_ps(c))) {
+        return _mm256_fmadd_ps(j, k, k);
+    }
+    const __m256i g  = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(n, _mm256_setzero_ps(), _CMP_LE_OQ)), _mm256_set1_epi32(0x82000000u));
+    const __m256  s1 = _mm256_castsi256_ps(_mm256_add_epi32(g, _mm256_set1_epi32(0x7f000000u)));
+    const __m256  s2 = _mm256_castsi256_ps(_mm256_sub_epi32(e, g));
+    const __m256i d  = _mm256_castps_si256(_mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.f), n), _mm256_set1_ps(192), _CMP_GT_OQ));
+    return _mm256_or_ps(
+            _mm256_and_ps(_mm256_castsi256_ps(d), _mm256_mul_ps(s1, s1)),
+            _mm256_andnot_ps(_mm256_castsi256_ps(d), _mm256_or_ps(
+                    _mm256_and_ps   (_mm256_castsi256_ps(c), _mm256_mul_ps(_mm256_fmadd_ps(s2, j, s2), s1)),
+                    _mm256_andnot_ps(_mm256_castsi256_ps(c), _mm256_fmadd_ps(k, j, k)))));
+}
+
+#elif defined(__SSE2__)
+
+#define WSP_GGML_V_EXPF
+
+#define WSP_GGML_V_EPR    4
+#define WSP_GGML_V        __m128
+#define WSP_GGML_V_LOAD   _mm_loadu_ps
+#define WSP_GGML_V_STORE  _mm_storeu_ps
+#define WSP_GGML_V_SET1   _mm_set1_ps
+#define WSP_GGML_V_ADD    _mm_add_ps
+#define WSP_GGML_V_SUB    _mm_sub_ps
+#define WSP_GGML_V_MUL    _mm_mul_ps
+#define WSP_GGML_V_DIV    _mm_div_ps
+#define WSP_GGML_V_REDUCE wsp_ggml_v_reduce
+
+#if defined(__FMA__)
+#define WSP_GGML_V_MADD(x, y, z)  _mm_fmadd_ps(x, y, z)
+#define WSP_GGML_V_NMADD(x, y, z) _mm_fnmadd_ps(x, y, z)
+#else
+#define WSP_GGML_V_MADD(x, y, z)  _mm_add_ps(_mm_mul_ps(x, y), z)
+#define WSP_GGML_V_NMADD(x, y, z) _mm_sub_ps(z, _mm_mul_ps(x, y))
+#endif
+
+inline static float wsp_ggml_v_reduce(__m128 x) {
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+inline static __m128 wsp_ggml_v_expf(__m128 x) {
+    const __m128  r = _mm_set1_ps(0x1.8p23f);
+    const __m128  z = WSP_GGML_V_MADD(x, _mm_set1_ps(0x1.715476p+0f), r);
+    const __m128  n = _mm_sub_ps(z, r);
+    const __m128  b = WSP_GGML_V_NMADD(n, _mm_set1_ps(0x1.7f7d1cp-20f),
+                      WSP_GGML_V_NMADD(n, _mm_set1_ps(0x1.62e4p-1f), x));
+    const __m128i e = _mm_slli_epi32(_mm_castps_si128(z), 23);
+    const __m128  k = _mm_castsi128_ps(_mm_add_epi32(e, _mm_castps_si128(_mm_set1_ps(1))));
+    const __m128i c = _mm_castps_si128(_mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), n), _mm_set1_ps(126)));
+    const __m128  u = _mm_mul_ps(b, b);
+    const __m128  j = WSP_GGML_V_MADD(
+            WSP_GGML_V_MADD(WSP_GGML_V_MADD(_mm_set1_ps(0x1.0e4020p-7f), b, _mm_set1_ps(0x1.573e2ep-5f)), u,
+                            WSP_GGML_V_MADD(_mm_set1_ps(0x1.555e66p-3f), b, _mm_set1_ps(0x1.fffdb6p-2f))), u,
+            _mm_mul_ps(_mm_set1_ps(0x1.ffffecp-1f), b));
+    if (!_mm_movemask_epi8(c)) {
+        return WSP_GGML_V_MADD(j, k, k);
+    }
+    const __m128i g  = _mm_and_si128(_mm_castps_si128(_mm_cmple_ps(n, _mm_setzero_ps())), _mm_set1_epi32(0x82000000u));
+    const __m128  s1 = _mm_castsi128_ps(_mm_add_epi32(g, _mm_set1_epi32(0x7f000000u)));
+    const __m128  s2 = _mm_castsi128_ps(_mm_sub_epi32(e, g));
+    const __m128i d  = _mm_castps_si128(_mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), n), _mm_set1_ps(192)));
+    return _mm_or_ps(
+            _mm_and_ps(_mm_castsi128_ps(d), _mm_mul_ps(s1, s1)),
+            _mm_andnot_ps(_mm_castsi128_ps(d), _mm_or_ps(
+                    _mm_and_ps   (_mm_castsi128_ps(c), _mm_mul_ps(WSP_GGML_V_MADD(s2, j, s2), s1)),
+                    _mm_andnot_ps(_mm_castsi128_ps(c), WSP_GGML_V_MADD(k, j, k)))));
+}
+
+#endif
+
+#ifdef WSP_GGML_V_EXPF
+// x*sigmoid(t) = x/(1 + exp(-t))
+inline static WSP_GGML_V wsp_ggml_v_mul_sigmoid(WSP_GGML_V x, WSP_GGML_V t) {
+    const WSP_GGML_V one = WSP_GGML_V_SET1(1.0f);
+    return WSP_GGML_V_DIV(x, WSP_GGML_V_ADD(one, wsp_ggml_v_expf(WSP_GGML_V_SUB(WSP_GGML_V_SET1(0.0f), t))));
+}
+
+// tanh approximation: 0.5*x*(1 + tanh(u)) = x*sigmoid(2*u)
+inline static WSP_GGML_V wsp_ggml_v_gelu(WSP_GGML_V x) {
+    const WSP_GGML_V u = WSP_GGML_V_MUL(WSP_GGML_V_MUL(WSP_GGML_V_SET1(2.0f*SQRT_2_OVER_PI), x),
+                                        WSP_GGML_V_ADD(WSP_GGML_V_SET1(1.0f), WSP_GGML_V_MUL(WSP_GGML_V_SET1(GELU_COEF_A), WSP_GGML_V_MUL(x, x))));
+    return wsp_ggml_v_mul_sigmoid(x, u);
+}
+
+inline static WSP_GGML_V wsp_ggml_v_gelu_quick(WSP_GGML_V x) {
+    return wsp_ggml_v_mul_sigmoid(x, WSP_GGML_V_MUL(WSP_GGML_V_SET1(-GELU_QUICK_COEF), x));
+}
+
+inline static WSP_GGML_V wsp_ggml_v_silu(WSP_GGML_V x) {
+    return wsp_ggml_v_mul_sigmoid(x, x);
+}
+#endif
+
 inline static float wsp_ggml_gelu_f32(float x) {
     return 0.5f*x*(1.0f + tanhf(SQRT_2_OVER_PI*x*(1.0f + GELU_COEF_A*x*x)));
 }
 
 inline static void wsp_ggml_vec_gelu_f16(const int n, wsp_ggml_fp16_t * y, const wsp_ggml_fp16_t * x) {
-    const uint16_t * i16 = (const uint16_t *) x;
+    if (wsp_ggml_act_use_tables) {
+        wsp_ggml_table_require(WSP_GGML_TABLE_GELU);
+        const uint16_t * i16 = (const uint16_t *) x;
+        for (int i = 0; i < n; ++i) {
+            y[i] = wsp_ggml_table_gelu_f16[i16[i]];
+        }
+        return;
+    }
     for (int i = 0; i < n; ++i) {
-        y[i] = wsp_ggml_table_gelu_f16[i16[i]];
+        y[i] = WSP_GGML_FP32_TO_FP16(wsp_ggml_gelu_f32(WSP_GGML_FP16_TO_FP32(x[i])));
     }
 }
 
-#ifdef WSP_GGML_GELU_FP16
 inline static void wsp_ggml_vec_gelu_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#ifdef WSP_GGML_V_EXPF
+    if (!wsp_ggml_act_use_tables) {
+        for (; i + WSP_GGML_V_EPR <= n; i += WSP_GGML_V_EPR) {
+            WSP_GGML_V_STORE(y + i, wsp_ggml_v_gelu(WSP_GGML_V_LOAD(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = wsp_ggml_gelu_f32(x[i]);
+        }
+        return;
+    }
+#endif
+#ifdef WSP_GGML_GELU_FP16
+    wsp_ggml_table_require(WSP_GGML_TABLE_GELU);
     uint16_t t;
-    for (int i = 0; i < n; ++i) {
+    for (; i < n; ++i) {
         wsp_ggml_fp16_t fp16 = WSP_GGML_FP32_TO_FP16(x[i]);
         memcpy(&t, &fp16, sizeof(uint16_t));
         y[i] = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_gelu_f16[t]);
     }
-}
 #else
-inline static void wsp_ggml_vec_gelu_f32(const int n, float * y, const float * x) {
-    for (int i = 0; i < n; ++i) {
+    for (; i < n; ++i) {
         y[i] = wsp_ggml_gelu_f32(x[i]);
     }
-}
 #endif
+}
 
 inline static float wsp_ggml_gelu_quick_f32(float x) {
     return x*(1.0f/(1.0f+expf(GELU_QUICK_COEF*x)));
@@ -1440,28 +2147,80 @@ inline static float wsp_ggml_gelu_quick_f32(float x) {
 //    }
 //}
 
-#ifdef WSP_GGML_GELU_QUICK_FP16
 inline static void wsp_ggml_vec_gelu_quick_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#ifdef WSP_GGML_V_EXPF
+    if (!wsp_ggml_act_use_tables) {
+        for (; i + WSP_GGML_V_EPR <= n; i += WSP_GGML_V_EPR) {
+            WSP_GGML_V_STORE(y + i, wsp_ggml_v_gelu_quick(WSP_GGML_V_LOAD(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = wsp_ggml_gelu_quick_f32(x[i]);
+        }
+        return;
+    }
+#endif
+#ifdef WSP_GGML_GELU_QUICK_FP16
+    wsp_ggml_table_require(WSP_GGML_TABLE_GELU_QUICK);
     uint16_t t;
-    for (int i = 0; i < n; ++i) {
+    for (; i < n; ++i) {
         wsp_ggml_fp16_t fp16 = WSP_GGML_FP32_TO_FP16(x[i]);
         memcpy(&t, &fp16, sizeof(uint16_t));
         y[i] = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_gelu_quick_f16[t]);
     }
-}
 #else
-inline static void wsp_ggml_vec_gelu_quick_f32(const int n, float * y, const float * x) {
-    for (int i = 0; i < n; ++i) {
+    for (; i < n; ++i) {
         y[i] = wsp_ggml_gelu_quick_f32(x[i]);
     }
-}
 #endif
+}
 
 // Sigmoid Linear Unit (SiLU) function
 inline static float wsp_ggml_silu_f32(float x) {
     return x/(1.0f + expf(-x));
 }
 
+static void wsp_ggml_table_fill(enum wsp_ggml_table table) {
+    const uint64_t t_start = wsp_ggml_time_us(); UNUSED(t_start);
+
+    wsp_ggml_fp16_t ii;
+    for (int i = 0; i < (1 << 16); ++i) {
+        uint16_t ui = i;
+        memcpy(&ii, &ui, sizeof(ii));
+        const float f = WSP_GGML_COMPUTE_FP16_TO_FP32(ii);
+        switch (table) {
+            case WSP_GGML_TABLE_GELU:       wsp_ggml_table_gelu_f16[i]       = WSP_GGML_FP32_TO_FP16(wsp_ggml_gelu_f32(f));       break;
+            case WSP_GGML_TABLE_GELU_QUICK: wsp_ggml_table_gelu_quick_f16[i] = WSP_GGML_FP32_TO_FP16(wsp_ggml_gelu_quick_f32(f)); break;
+            case WSP_GGML_TABLE_SILU:       wsp_ggml_table_silu_f16[i]       = WSP_GGML_FP32_TO_FP16(wsp_ggml_silu_f32(f));       break;
+            case WSP_GGML_TABLE_EXP:        wsp_ggml_table_exp_f16[i]        = WSP_GGML_FP32_TO_FP16(expf(f));                    break;
+            default: WSP_GGML_ASSERT(false);
+        }
+    }
+
+    const uint64_t t_end = wsp_ggml_time_us(); UNUSED(t_end);
+
+    WSP_GGML_PRINT_DEBUG("%s: table %d initialized in %f ms\n", __func__, (int) table, (t_end - t_start)/1000.0f);
+}
+
+static atomic_int wsp_ggml_table_claimed[WSP_GGML_TABLE_COUNT];
+static atomic_int wsp_ggml_table_ready  [WSP_GGML_TABLE_COUNT];
+
+static void wsp_ggml_table_require(enum wsp_ggml_table table) {
+    if (atomic_load(&wsp_ggml_table_ready[table])) {
+        return;
+    }
+
+    if (atomic_fetch_add(&wsp_ggml_table_claimed[table], 1) == 0) {
+        wsp_ggml_table_fill(table);
+        atomic_store(&wsp_ggml_table_ready[table], 1);
+    } else {
+        // another thread is computing it
+        while (!atomic_load(&wsp_ggml_table_ready[table])) {
+            sched_yield();
+        }
+    }
+}
+
 //inline static void wsp_ggml_vec_silu_f16(const int n, wsp_ggml_fp16_t * y, const wsp_ggml_fp16_t * x) {
 //    const uint16_t * i16 = (const uint16_t *) x;
 //    for (int i = 0; i < n; ++i) {
@@ -1469,22 +2228,33 @@ inline static float wsp_ggml_silu_f32(float x) {
 //    }
 //}
 
-#ifdef WSP_GGML_SILU_FP16
 inline static void wsp_ggml_vec_silu_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#ifdef WSP_GGML_V_EXPF
+    if (!wsp_ggml_act_use_tables) {
+        for (; i + WSP_GGML_V_EPR <= n; i += WSP_GGML_V_EPR) {
+            WSP_GGML_V_STORE(y + i, wsp_ggml_v_silu(WSP_GGML_V_LOAD(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = wsp_ggml_silu_f32(x[i]);
+        }
+        return;
+    }
+#endif
+#ifdef WSP_GGML_SILU_FP16
+    wsp_ggml_table_require(WSP_GGML_TABLE_SILU);
     uint16_t t;
-    for (int i = 0; i < n; ++i) {
+    for (; i < n; ++i) {
         wsp_ggml_fp16_t fp16 = WSP_GGML_FP32_TO_FP16(x[i]);
         memcpy(&t, &fp16, sizeof(uint16_t));
         y[i] = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_silu_f16[t]);
     }
-}
 #else
-inline static void wsp_ggml_vec_silu_f32(const int n, float * y, const float * x) {
-    for (int i = 0; i < n; ++i) {
+    for (; i < n; ++i) {
         y[i] = wsp_ggml_silu_f32(x[i]);
     }
-}
 #endif
+}
 
 inline static float wsp_ggml_silu_backward_f32(float x, float dy) {
     const float s = 1.0f/(1.0f + expf(-x));
@@ -1494,10 +2264,13 @@ inline static float wsp_ggml_silu_backward_f32(float x, float dy) {
 #ifdef WSP_GGML_SILU_FP16
 inline static void wsp_ggml_vec_silu_backward_f32(const int n, float * dx, const float * x, const float * dy) {
     for (int i = 0; i < n; ++i) {
-        // we did not use x[i] to compute forward silu but its f16 equivalent
+        // with the tables we did not use x[i] to compute forward silu but its f16 equivalent
         // take derivative at f16 of x[i]:
-        wsp_ggml_fp16_t fp16 = WSP_GGML_FP32_TO_FP16(x[i]);
-        float usedx = WSP_GGML_FP16_TO_FP32(fp16);
+        float usedx = x[i];
+        if (wsp_ggml_act_use_tables) {
+            wsp_ggml_fp16_t fp16 = WSP_GGML_FP32_TO_FP16(x[i]);
+            usedx = WSP_GGML_FP16_TO_FP32(fp16);
+        }
         dx[i] = wsp_ggml_silu_backward_f32(usedx, dy[i]);
     }
 }
@@ -1509,6 +2282,42 @@ inline static void wsp_ggml_vec_silu_backward_f32(const int n, float * dx, const
 }
 #endif
 
+// y[i] = exp(x[i] - max) with exp(-INF) = 0, returns the sum of y
+static wsp_ggml_float wsp_ggml_vec_soft_max_f32(const int n, float * y, const float * x, const float max) {
+    int i = 0;
+    wsp_ggml_float sum = 0.0;
+    if (wsp_ggml_act_use_tables) {
+        wsp_ggml_table_require(WSP_GGML_TABLE_EXP);
+        uint16_t scvt;
+        for (; i < n; ++i) {
+            if (x[i] == -INFINITY) {
+                y[i] = 0.0f;
+            } else {
+                wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(x[i] - max);
+                memcpy(&scvt, &s, sizeof(scvt));
+                const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt]);
+                sum += (wsp_ggml_float)val;
+                y[i] = val;
+            }
+        }
+        return sum;
+    }
+#ifdef WSP_GGML_V_EXPF
+    const WSP_GGML_V vmax = WSP_GGML_V_SET1(max);
+    for (; i + WSP_GGML_V_EPR <= n; i += WSP_GGML_V_EPR) {
+        const WSP_GGML_V val = wsp_ggml_v_expf(WSP_GGML_V_SUB(WSP_GGML_V_LOAD(x + i), vmax));
+        WSP_GGML_V_STORE(y + i, val);
+        sum += (wsp_ggml_float)WSP_GGML_V_REDUCE(val);
+    }
+#endif
+    for (; i < n; ++i) {
+        const float val = expf(x[i] - max);
+        sum += (wsp_ggml_float)val;
+        y[i] = val;
+    }
+    return sum;
+}
+
 inline static void wsp_ggml_vec_sum_f32(const int n, float * s, const float * x) {
 #ifndef WSP_GGML_USE_ACCELERATE
     wsp_ggml_float sum = 0.0;
@@ -1593,9 +2402,11 @@ static const char * WSP_GGML_OP_NAME[WSP_GGML_OP_COUNT] = {
     "RMS_NORM",
     "RMS_NORM_BACK",
     "GROUP_NORM",
+    "NORM_AFFINE",
 
     "MUL_MAT",
     "MUL_MAT_ID",
+    "MUL_MAT_BIAS",
     "OUT_PROD",
 
     "SCALE",
@@ -1619,6 +2430,7 @@ static const char * WSP_GGML_OP_NAME[WSP_GGML_OP_COUNT] = {
     "CLAMP",
     "CONV_TRANSPOSE_1D",
     "IM2COL",
+    "CONV_1D_K3",
     "CONV_TRANSPOSE_2D",
     "POOL_1D",
     "POOL_2D",
@@ -1652,7 +2464,7 @@ static const char * WSP_GGML_OP_NAME[WSP_GGML_OP_COUNT] = {
     "CROSS_ENTROPY_LOSS_BACK",
 };
 
-static_assert(WSP_GGML_OP_COUNT == 72, "WSP_GGML_OP_COUNT != 72");
+static_assert(WSP_GGML_OP_COUNT == 75, "WSP_GGML_OP_COUNT != 75");
 
 static const char * WSP_GGML_OP_SYMBOL[WSP_GGML_OP_COUNT] = {
     "none",
@@ -1679,9 +2491,11 @@ static const char * WSP_GGML_OP_SYMBOL[WSP_GGML_OP_COUNT] = {
     "rms_norm(x)",
     "rms_norm_back(x)",
     "group_norm(x)",
+    "norm_affine(x)",
 
     "X*Y",
     "X[i]*Y",
+    "X*Y+b",
     "X*Y",
 
     "x*v",
@@ -1705,6 +2519,7 @@ static const char * WSP_GGML_OP_SYMBOL[WSP_GGML_OP_COUNT] = {
     "clamp(x)",
     "conv_transpose_1d(x)",
     "im2col(x)",
+    "conv_1d_k3(x)",
     "conv_transpose_2d(x)",
     "pool_1d(x)",
     "pool_2d(x)",
@@ -1738,7 +2553,7 @@ static const char * WSP_GGML_OP_SYMBOL[WSP_GGML_OP_COUNT] = {
     "cross_entropy_loss_back(x,y)",
 };
 
-static_assert(WSP_GGML_OP_COUNT == 72, "WSP_GGML_OP_COUNT != 72");
+static_assert(WSP_GGML_OP_COUNT == 75, "WSP_GGML_OP_COUNT != 75");
 
 static_assert(WSP_GGML_OP_POOL_COUNT == 2, "WSP_GGML_OP_POOL_COUNT != 2");
 
@@ -1779,12 +2594,14 @@ static void wsp_ggml_setup_op_has_task_pass(void) {
         p[WSP_GGML_OP_ACC                    ] = true;
         p[WSP_GGML_OP_MUL_MAT                ] = true;
         p[WSP_GGML_OP_MUL_MAT_ID             ] = true;
+        p[WSP_GGML_OP_MUL_MAT_BIAS           ] = true;
         p[WSP_GGML_OP_OUT_PROD               ] = true;
         p[WSP_GGML_OP_SET                    ] = true;
         p[WSP_GGML_OP_GET_ROWS_BACK          ] = true;
         p[WSP_GGML_OP_DIAG_MASK_INF          ] = true;
         p[WSP_GGML_OP_DIAG_MASK_ZERO         ] = true;
         p[WSP_GGML_OP_CONV_TRANSPOSE_1D      ] = true;
+        p[WSP_GGML_OP_CONV_1D_K3             ] = true;
         p[WSP_GGML_OP_CONV_TRANSPOSE_2D      ] = true;
         p[WSP_GGML_OP_FLASH_ATTN_BACK        ] = true;
         p[WSP_GGML_OP_CROSS_ENTROPY_LOSS     ] = true;
@@ -2202,12 +3019,39 @@ struct wsp_ggml_context * wsp_ggml_init(struct wsp_ggml_init_params params) {
     wsp_ggml_critical_section_start();
 
     static bool is_first_call = true;
+    static const char * cpu_missing_feature = NULL;
 
     if (is_first_call) {
         // initialize time system (required on Windows)
         wsp_ggml_time_init();
 
-        // initialize GELU, Quick GELU, SILU and EXP F32 tables
+        wsp_ggml_detect_cpu_features(&wsp_ggml_cpu_features);
+
+        cpu_missing_feature = wsp_ggml_cpu_missing_feature(&wsp_ggml_cpu_features);
+        if (cpu_missing_feature) {
+            WSP_GGML_PRINT("%s: this build uses %s, which the CPU does not support\n", __func__, cpu_missing_feature);
+        }
+
+        {
+            const struct wsp_ggml_cpu_kernels * kernels = wsp_ggml_cpu_select_kernels(&wsp_ggml_cpu_features);
+
+            if (kernels) {
+                wsp_ggml_cpu_apply_kernels(kernels);
+
+                WSP_GGML_PRINT_DEBUG("%s: using the %s kernels\n", __func__, kernels->name);
+            }
+        }
+
+        // the SIMD exp kernels replace the GELU, Quick GELU, SILU and EXP tables when available
+        // the tables themselves are computed on first use (wsp_ggml_table_require)
+#if defined(WSP_GGML_V_EXPF)
+        wsp_ggml_act_use_tables = false;
+#else
+        wsp_ggml_act_use_tables = true;
+#endif
+
+#if defined(WSP_GGML_FP16_TO_FP32_TABLE)
+        // initialize the F32 table, it is read by every WSP_GGML_FP16_TO_FP32
         {
             const uint64_t t_start = wsp_ggml_time_us(); UNUSED(t_start);
 
@@ -2215,17 +3059,14 @@ struct wsp_ggml_context * wsp_ggml_init(struct wsp_ggml_init_params params) {
             for (int i = 0; i < (1 << 16); ++i) {
                 uint16_t ui = i;
                 memcpy(&ii, &ui, sizeof(ii));
-                const float f = wsp_ggml_table_f32_f16[i] = WSP_GGML_COMPUTE_FP16_TO_FP32(ii);
-                wsp_ggml_table_gelu_f16[i] = WSP_GGML_FP32_TO_FP16(wsp_ggml_gelu_f32(f));
-                wsp_ggml_table_gelu_quick_f16[i] = WSP_GGML_FP32_TO_FP16(wsp_ggml_gelu_quick_f32(f));
-                wsp_ggml_table_silu_f16[i] = WSP_GGML_FP32_TO_FP16(wsp_ggml_silu_f32(f));
-                wsp_ggml_table_exp_f16[i]  = WSP_GGML_FP32_TO_FP16(expf(f));
+                wsp_ggml_table_f32_f16[i] = WSP_GGML_COMPUTE_FP16_TO_FP32(ii);
             }
 
             const uint64_t t_end = wsp_ggml_time_us(); UNUSED(t_end);
 
-            WSP_GGML_PRINT_DEBUG("%s: GELU, Quick GELU, SILU and EXP tables initialized in %f ms\n", __func__, (t_end - t_start)/1000.0f);
+            WSP_GGML_PRINT_DEBUG("%s: F32 table initialized in %f ms\n", __func__, (t_end - t_start)/1000.0f);
         }
+#endif
 
         // initialize g_state
         {
@@ -2259,6 +3100,12 @@ struct wsp_ggml_context * wsp_ggml_init(struct wsp_ggml_init_params params) {
         is_first_call = false;
     }
 
+    if (cpu_missing_feature) {
+        wsp_ggml_critical_section_end();
+
+        return NULL;
+    }
+
     // find non-used context in g_state
     struct wsp_ggml_context * ctx = NULL;
 
@@ -4055,35 +4902,99 @@ struct wsp_ggml_tensor * wsp_ggml_group_norm(
     return wsp_ggml_group_norm_impl(ctx, a, n_groups, false);
 }
 
-struct wsp_ggml_tensor * wsp_ggml_group_norm_inplace(
-    struct wsp_ggml_context * ctx,
-    struct wsp_ggml_tensor * a,
-    int n_groups) {
-    return wsp_ggml_group_norm_impl(ctx, a, n_groups, true);
+struct wsp_ggml_tensor * wsp_ggml_group_norm_inplace(
+    struct wsp_ggml_context * ctx,
+    struct wsp_ggml_tensor * a,
+    int n_groups) {
+    return wsp_ggml_group_norm_impl(ctx, a, n_groups, true);
+}
+
+// wsp_ggml_norm_affine
+
+struct wsp_ggml_tensor * wsp_ggml_norm_affine(
+        struct wsp_ggml_context * ctx,
+        struct wsp_ggml_tensor  * a,
+        struct wsp_ggml_tensor  * w,
+        struct wsp_ggml_tensor  * b,
+        float eps) {
+    WSP_GGML_ASSERT(w->type == WSP_GGML_TYPE_F32 && wsp_ggml_is_contiguous(w) && wsp_ggml_nelements(w) == a->ne[0]);
+    WSP_GGML_ASSERT(b->type == WSP_GGML_TYPE_F32 && wsp_ggml_is_contiguous(b) && wsp_ggml_nelements(b) == a->ne[0]);
+
+    bool is_node = false;
+
+    if (a->grad || w->grad || b->grad) {
+        WSP_GGML_ASSERT(false); // TODO: implement backward
+        is_node = true;
+    }
+
+    struct wsp_ggml_tensor * result = wsp_ggml_dup_tensor(ctx, a);
+
+    wsp_ggml_set_op_params(result, &eps, sizeof(eps));
+
+    result->op   = WSP_GGML_OP_NORM_AFFINE;
+    result->grad = is_node ? wsp_ggml_dup_tensor(ctx, result) : NULL;
+    result->src[0] = a;
+    result->src[1] = w;
+    result->src[2] = b;
+
+    return result;
+}
+
+// wsp_ggml_mul_mat
+
+struct wsp_ggml_tensor * wsp_ggml_mul_mat(
+        struct wsp_ggml_context * ctx,
+        struct wsp_ggml_tensor  * a,
+        struct wsp_ggml_tensor  * b) {
+    WSP_GGML_ASSERT(wsp_ggml_can_mul_mat(a, b));
+    WSP_GGML_ASSERT(!wsp_ggml_is_transposed(a));
+
+    bool is_node = false;
+
+    if (a->grad || b->grad) {
+        is_node = true;
+    }
+
+    const int64_t ne[4] = { a->ne[1], b->ne[1], b->ne[2], b->ne[3] };
+    struct wsp_ggml_tensor * result = wsp_ggml_new_tensor(ctx, WSP_GGML_TYPE_F32, MAX(a->n_dims, b->n_dims), ne);
+
+    result->op   = WSP_GGML_OP_MUL_MAT;
+    result->grad = is_node ? wsp_ggml_dup_tensor(ctx, result) : NULL;
+    result->src[0] = a;
+    result->src[1] = b;
+
+    return result;
 }
 
-// wsp_ggml_mul_mat
+// wsp_ggml_mul_mat_bias
 
-struct wsp_ggml_tensor * wsp_ggml_mul_mat(
+struct wsp_ggml_tensor * wsp_ggml_mul_mat_bias(
         struct wsp_ggml_context * ctx,
         struct wsp_ggml_tensor  * a,
-        struct wsp_ggml_tensor  * b) {
+        struct wsp_ggml_tensor  * b,
+        struct wsp_ggml_tensor  * c,
+        bool gelu) {
     WSP_GGML_ASSERT(wsp_ggml_can_mul_mat(a, b));
     WSP_GGML_ASSERT(!wsp_ggml_is_transposed(a));
+    WSP_GGML_ASSERT(c->type == WSP_GGML_TYPE_F32 && wsp_ggml_is_contiguous(c) && wsp_ggml_nelements(c) == a->ne[1]);
 
     bool is_node = false;
 
-    if (a->grad || b->grad) {
+    if (a->grad || b->grad || c->grad) {
+        WSP_GGML_ASSERT(false); // TODO: implement backward
         is_node = true;
     }
 
     const int64_t ne[4] = { a->ne[1], b->ne[1], b->ne[2], b->ne[3] };
     struct wsp_ggml_tensor * result = wsp_ggml_new_tensor(ctx, WSP_GGML_TYPE_F32, MAX(a->n_dims, b->n_dims), ne);
 
-    result->op   = WSP_GGML_OP_MUL_MAT;
+    wsp_ggml_set_op_params_i32(result, 0, gelu ? 1 : 0);
+
+    result->op   = WSP_GGML_OP_MUL_MAT_BIAS;
     result->grad = is_node ? wsp_ggml_dup_tensor(ctx, result) : NULL;
     result->src[0] = a;
     result->src[1] = b;
+    result->src[2] = c;
 
     return result;
 }
@@ -5261,6 +6172,47 @@ struct wsp_ggml_tensor* wsp_ggml_conv_1d_ph(
     return wsp_ggml_conv_1d(ctx, a, b, s, a->ne[0] / 2, d);
 }
 
+// wsp_ggml_conv_1d_k3
+
+struct wsp_ggml_tensor * wsp_ggml_conv_1d_k3(
+        struct wsp_ggml_context * ctx,
+        struct wsp_ggml_tensor  * a,
+        struct wsp_ggml_tensor  * b,
+        struct wsp_ggml_tensor  * c,
+        int                   s,
+        bool                  gelu) {
+    WSP_GGML_ASSERT(a->ne[0] == 3);
+    WSP_GGML_ASSERT(a->ne[1] == b->ne[1]);
+    WSP_GGML_ASSERT(a->ne[3] == 1);
+    WSP_GGML_ASSERT(wsp_ggml_is_matrix(b));
+    WSP_GGML_ASSERT(wsp_ggml_nelements(c) == a->ne[2]);
+    WSP_GGML_ASSERT(s > 0);
+
+    bool is_node = false;
+
+    if (a->grad || b->grad || c->grad) {
+        WSP_GGML_ASSERT(false); // TODO: implement backward
+        is_node = true;
+    }
+
+    const int64_t ne[4] = {
+        wsp_ggml_calc_conv_output_size(b->ne[0], 3, s, 1, 1),
+        a->ne[2], 1, 1,
+    };
+    struct wsp_ggml_tensor * result = wsp_ggml_new_tensor(ctx, WSP_GGML_TYPE_F32, 2, ne);
+
+    int32_t params[] = { s, gelu ? 1 : 0 };
+    wsp_ggml_set_op_params(result, params, sizeof(params));
+
+    result->op = WSP_GGML_OP_CONV_1D_K3;
+    result->grad = is_node ? wsp_ggml_dup_tensor(ctx, result) : NULL;
+    result->src[0] = a;
+    result->src[1] = b;
+    result->src[2] = c;
+
+    return result;
+}
+
 // wsp_ggml_conv_transpose_1d
 
 static int64_t wsp_ggml_calc_conv_transpose_1d_output_size(int64_t ins, int64_t ks, int s, int p, int d) {
@@ -5616,6 +6568,16 @@ struct wsp_ggml_tensor * wsp_ggml_flash_attn(
         struct wsp_ggml_tensor  * k,
         struct wsp_ggml_tensor  * v,
         bool                  masked) {
+    return wsp_ggml_flash_attn_scaled(ctx, q, k, v, masked, 1.0f/sqrtf(q->ne[0]));
+}
+
+struct wsp_ggml_tensor * wsp_ggml_flash_attn_scaled(
+        struct wsp_ggml_context * ctx,
+        struct wsp_ggml_tensor  * q,
+        struct wsp_ggml_tensor  * k,
+        struct wsp_ggml_tensor  * v,
+        bool                  masked,
+        float                 scale) {
     WSP_GGML_ASSERT(wsp_ggml_can_mul_mat(k, q));
     // TODO: check if vT can be multiplied by (k*qT)
 
@@ -5628,8 +6590,9 @@ struct wsp_ggml_tensor * wsp_ggml_flash_attn(
     //struct wsp_ggml_tensor * result = wsp_ggml_dup_tensor(ctx, q);
     struct wsp_ggml_tensor * result = wsp_ggml_new_tensor(ctx, WSP_GGML_TYPE_F32, q->n_dims, q->ne);
 
-    int32_t t = masked ? 1 : 0;
-    wsp_ggml_set_op_params(result, &t, sizeof(t));
+    int32_t params[] = { masked ? 1 : 0, 0 };
+    memcpy(params + 1, &scale, sizeof(float));
+    wsp_ggml_set_op_params(result, params, sizeof(params));
 
     result->op   = WSP_GGML_OP_FLASH_ATTN;
     result->grad = is_node ? wsp_ggml_dup_tensor(ctx, result) : NULL;
@@ -6491,10 +7454,8 @@ static void wsp_ggml_compute_forward_dup_f16(
                         id += ne00 * ir0;
                         for (int i01 = ir0; i01 < ir1; i01++) {
                             const wsp_ggml_fp16_t * src0_ptr = (wsp_ggml_fp16_t *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
-                            for (int i00 = 0; i00 < ne00; i00++) {
-                                dst_ptr[id] = WSP_GGML_FP16_TO_FP32(src0_ptr[i00]);
-                                id++;
-                            }
+                            wsp_ggml_fp16_to_fp32_row(src0_ptr, dst_ptr + id, ne00);
+                            id += ne00;
                         }
                         id += ne00 * (ne01 - ir1);
                     }
@@ -9206,6 +10167,84 @@ static void wsp_ggml_compute_forward_norm(
     }
 }
 
+// wsp_ggml_compute_forward_norm_affine
+
+static void wsp_ggml_compute_forward_norm_affine_f32(
+        const struct wsp_ggml_compute_params * params,
+        const struct wsp_ggml_tensor * src0,
+        const struct wsp_ggml_tensor * src1,
+        const struct wsp_ggml_tensor * src2,
+        struct wsp_ggml_tensor * dst) {
+    WSP_GGML_ASSERT(wsp_ggml_are_same_shape(src0, dst));
+
+    if (params->type == WSP_GGML_TASK_INIT || params->type == WSP_GGML_TASK_FINALIZE) {
+        return;
+    }
+
+    WSP_GGML_ASSERT(src0->nb[0] == sizeof(float));
+
+    const int ith = params->ith;
+    const int nth = params->nth;
+
+    WSP_GGML_TENSOR_UNARY_OP_LOCALS
+
+    float eps;
+    memcpy(&eps, dst->op_params, sizeof(float));
+
+    const float * w = (const float *) src1->data;
+    const float * b = (const float *) src2->data;
+
+    for (int64_t i03 = 0; i03 < ne03; i03++) {
+        for (int64_t i02 = 0; i02 < ne02; i02++) {
+            for (int64_t i01 = ith; i01 < ne01; i01 += nth) {
+                const float * x = (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
+
+                wsp_ggml_float sum = 0.0;
+                for (int64_t i00 = 0; i00 < ne00; i00++) {
+                    sum += (wsp_ggml_float)x[i00];
+                }
+
+                float mean = sum/ne00;
+
+                float * y = (float *) ((char *) dst->data + i01*nb1 + i02*nb2 + i03*nb3);
+
+                wsp_ggml_float sum2 = 0.0;
+                for (int64_t i00 = 0; i00 < ne00; i00++) {
+                    float v = x[i00] - mean;
+                    y[i00] = v;
+                    sum2 += (wsp_ggml_float)(v*v);
+                }
+
+                float variance = sum2/ne00;
+                const float scale = 1.0f/sqrtf(variance + eps);
+
+                // the row is still in cache
+                for (int64_t i00 = 0; i00 < ne00; i00++) {
+                    y[i00] = (y[i00]*scale)*w[i00] + b[i00];
+                }
+            }
+        }
+    }
+}
+
+static void wsp_ggml_compute_forward_norm_affine(
+        const struct wsp_ggml_compute_params * params,
+        const struct wsp_ggml_tensor * src0,
+        const struct wsp_ggml_tensor * src1,
+        const struct wsp_ggml_tensor * src2,
+        struct wsp_ggml_tensor * dst) {
+    switch (src0->type) {
+        case WSP_GGML_TYPE_F32:
+            {
+                wsp_ggml_compute_forward_norm_affine_f32(params, src0, src1, src2, dst);
+            } break;
+        default:
+            {
+                WSP_GGML_ASSERT(false);
+            } break;
+    }
+}
+
 // wsp_ggml_compute_forward_group_rms_norm
 
 static void wsp_ggml_compute_forward_rms_norm_f32(
@@ -9575,6 +10614,23 @@ static bool wsp_ggml_compute_forward_mul_mat_use_blas(
 // cne1 = ne11 and ne1
 // in a normal matrix multiplication, off1 = 0 and cne1 = ne1
 // during WSP_GGML_TASK_INIT, the full src1 is converted regardless of off1 and cne1
+#if defined(WSP_GGML_USE_ACCELERATE) || defined(WSP_GGML_USE_OPENBLAS) || defined(WSP_GGML_USE_CLBLAST)
+// bias (+ gelu) of the rows [i1, i1 + n1) of a wsp_ggml_mul_mat_bias result computed by a BLAS
+static void wsp_ggml_mul_mat_bias_rows(struct wsp_ggml_tensor * dst, const float * bias, bool gelu, int64_t i1, int64_t n1) {
+    for (int64_t i3 = 0; i3 < dst->ne[3]; i3++) {
+        for (int64_t i2 = 0; i2 < dst->ne[2]; i2++) {
+            for (int64_t i = i1; i < i1 + n1; i++) {
+                float * row = (float *) ((char *) dst->data + i*dst->nb[1] + i2*dst->nb[2] + i3*dst->nb[3]);
+                wsp_ggml_vec_add_f32(dst->ne[0], row, row, bias);
+                if (gelu) {
+                    wsp_ggml_vec_gelu_f32(dst->ne[0], row, row);
+                }
+            }
+        }
+    }
+}
+#endif
+
 static void wsp_ggml_compute_forward_mul_mat(
         const struct wsp_ggml_compute_params * params,
         const struct wsp_ggml_tensor * src0,
@@ -9616,6 +10672,10 @@ static void wsp_ggml_compute_forward_mul_mat(
     const int64_t r2 = ne12/ne02;
     const int64_t r3 = ne13/ne03;
 
+    // wsp_ggml_mul_mat_bias: bias (+ gelu) applied to the rows as they are computed
+    const float * bias = dst->op == WSP_GGML_OP_MUL_MAT_BIAS ? (const float *) dst->src[2]->data : NULL;
+    const bool    gelu = dst->op == WSP_GGML_OP_MUL_MAT_BIAS && wsp_ggml_get_op_params_i32(dst, 0) != 0;
+
     // nb01 >= nb00 - src0 is not transposed
     //   compute by src0 rows
 
@@ -9623,6 +10683,9 @@ static void wsp_ggml_compute_forward_mul_mat(
     if (wsp_ggml_cl_can_mul_mat(src0, src1, dst)) {
         if (params->ith == 0 && params->type == WSP_GGML_TASK_COMPUTE) {
             wsp_ggml_cl_mul_mat(src0, src1, dst, params->wdata, params->wsize);
+            if (bias) {
+                wsp_ggml_mul_mat_bias_rows(dst, bias, gelu, 0, ne1);
+            }
         }
         return;
     }
@@ -9674,6 +10737,10 @@ static void wsp_ggml_compute_forward_mul_mat(
             }
         }
 
+        if (bias) {
+            wsp_ggml_mul_mat_bias_rows(dst, bias, gelu, off1, cne1);
+        }
+
         //printf("CBLAS = %f ms, %d x %d x %d x %d\n", (wsp_ggml_perf_time_us() - t0)/1000.0, ne0, ne1, ne2, ne3);
 
         return;
@@ -9741,6 +10808,56 @@ static void wsp_ggml_compute_forward_mul_mat(
     assert(ne12 % ne02 == 0);
     assert(ne13 % ne03 == 0);
 
+    wsp_ggml_gemm_t const gemm = type_traits[type].gemm;
+
+    if (gemm && cne1 >= WSP_GGML_GEMM_MIN_ROWS) {
+        // cache blocks of src0 rows x src1 rows, the src1 blocks do not cross a (i12, i13) plane
+        const int64_t blck_0 = WSP_GGML_GEMM_BLCK_0;
+        const int64_t blck_1 = WSP_GGML_GEMM_BLCK_1;
+
+        const size_t by = src1_cont || src1->type != vec_dot_type ? row_size : nb11;
+
+        for (int64_t iir1 = ir110; iir1 < ir111; ) {
+            const int64_t i13 = (iir1/(ne12*cne1));
+            const int64_t i12 = (iir1 - i13*ne12*cne1)/cne1;
+            const int64_t i11 = (iir1 - i13*ne12*cne1 - i12*cne1) + off1;
+
+            const int64_t n1 = MIN(MIN(blck_1, ir111 - iir1), off1 + cne1 - i11);
+
+            // broadcast src0 into src1
+            const int64_t i03 = i13/r3;
+            const int64_t i02 = i12/r2;
+
+            const char * src0_row = (const char *) src0->data + (0 + i02*nb02 + i03*nb03);
+            const char * src1_col = (const char *) wdata +
+                (src1_cont || src1->type != vec_dot_type
+                 ? (i11      + i12*ne11 + i13*ne12*ne11)*row_size
+                 : (i11*nb11 + i12*nb12 + i13*nb13));
+
+            float * dst_col = (float *) ((char *) dst->data + (i11*nb1 + i12*nb2 + i13*nb3));
+
+            for (int64_t iir0 = ir010; iir0 < ir011; iir0 += blck_0) {
+                const int64_t n0 = MIN(blck_0, ir011 - iir0);
+
+                gemm(ne00, n0, n1, dst_col + iir0, nb1/sizeof(float), src0_row + iir0*nb01, nb01, src1_col, by);
+
+                if (bias) {
+                    for (int64_t j = 0; j < n1; ++j) {
+                        float * d = (float *) ((char *) dst_col + j*nb1) + iir0;
+                        wsp_ggml_vec_add_f32(n0, d, d, bias + iir0);
+                        if (gelu) {
+                            wsp_ggml_vec_gelu_f32(n0, d, d);
+                        }
+                    }
+                }
+            }
+
+            iir1 += n1;
+        }
+
+        return;
+    }
+
     // block-tiling attempt
     const int64_t blck_0 = 16;
     const int64_t blck_1 = 16;
@@ -9783,7 +10900,17 @@ static void wsp_ggml_compute_forward_mul_mat(
                 for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir011; ++ir0) {
                     vec_dot(ne00, &tmp[ir0 - iir0], src0_row + ir0*nb01, src1_col);
                 }
-                memcpy(&dst_col[iir0], tmp, (MIN(iir0 + blck_0, ir011) - iir0)*sizeof(float));
+
+                const int64_t n0 = MIN(iir0 + blck_0, ir011) - iir0;
+
+                if (bias) {
+                    wsp_ggml_vec_add_f32(n0, &dst_col[iir0], tmp, bias + iir0);
+                    if (gelu) {
+                        wsp_ggml_vec_gelu_f32(n0, &dst_col[iir0], &dst_col[iir0]);
+                    }
+                } else {
+                    memcpy(&dst_col[iir0], tmp, n0*sizeof(float));
+                }
             }
         }
     }
@@ -10850,21 +11977,7 @@ static void wsp_ggml_compute_forward_soft_max_f32(
         float max = -INFINITY;
         wsp_ggml_vec_max_f32(nc, &max, wp);
 
-        wsp_ggml_float sum = 0.0;
-
-        uint16_t scvt;
-        for (int i = 0; i < nc; i++) {
-            if (wp[i] == -INFINITY) {
-                dp[i] = 0.0f;
-            } else {
-                // const float val = (wp[i] == -INFINITY) ? 0.0 : exp(wp[i] - max);
-                wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(wp[i] - max);
-                memcpy(&scvt, &s, sizeof(scvt));
-                const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt]);
-                sum += (wsp_ggml_float)val;
-                dp[i] = val;
-            }
-        }
+        wsp_ggml_float sum = wsp_ggml_vec_soft_max_f32(nc, dp, wp, max);
 
         assert(sum > 0.0);
 
@@ -11879,10 +12992,146 @@ static void wsp_ggml_compute_forward_im2col_f16(
     int ofs0 = is_2D ? nb13 : nb12;
     int ofs1 = is_2D ? nb12 : nb11;
 
-    WSP_GGML_ASSERT(nb00 == sizeof(wsp_ggml_fp16_t));
+    WSP_GGML_ASSERT(nb00 == sizeof(wsp_ggml_fp16_t));
+    WSP_GGML_ASSERT(nb10 == sizeof(float));
+
+    if (params->type == WSP_GGML_TASK_INIT) {
+        return;
+    }
+
+    if (params->type == WSP_GGML_TASK_FINALIZE) {
+        return;
+    }
+
+    // im2col: [N, IC, IH, IW] => [N, OH, OW, IC*KH*KW]
+    {
+        wsp_ggml_fp16_t * const wdata = (wsp_ggml_fp16_t *) dst->data;
+
+        for (int64_t in = 0; in < N; in++) {
+            for (int64_t ioh = 0; ioh < OH; ioh++) { // 1
+                for (int64_t iow = 0; iow < OW; iow++) {
+                    for (int64_t iic = ith; iic < IC; iic += nth) {
+
+                        // micro kernel
+                        wsp_ggml_fp16_t * dst_data = wdata + (in*OH*OW + ioh*OW + iow)*(IC*KH*KW); // [IC, KH, KW]
+                        const float * const src_data = (float *)((char *) src1->data + in*ofs0 + iic*ofs1); // [IH, IW]
+
+                        for (int64_t ikh = 0; ikh < KH; ikh++) {  // 1
+                            for (int64_t ikw = 0; ikw < KW; ikw++) {
+                                const int64_t iiw = iow*s0 + ikw*d0 - p0;
+                                const int64_t iih = ioh*s1 + ikh*d1 - p1;
+
+                                if (iih < 0 || iih >= IH || iiw < 0 || iiw >= IW) {
+                                    dst_data[iic*(KH*KW) + ikh*KW + ikw] = 0;
+                                } else {
+                                    dst_data[iic*(KH*KW) + ikh*KW + ikw] = WSP_GGML_FP32_TO_FP16(src_data[iih*IW + iiw]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void wsp_ggml_compute_forward_im2col(
+        const struct wsp_ggml_compute_params * params,
+        const struct wsp_ggml_tensor * src0,
+        const struct wsp_ggml_tensor * src1,
+              struct wsp_ggml_tensor * dst) {
+    switch (src0->type) {
+        case WSP_GGML_TYPE_F16:
+            {
+                wsp_ggml_compute_forward_im2col_f16(params, src0, src1, dst);
+            } break;
+        case WSP_GGML_TYPE_F32:
+            {
+                WSP_GGML_ASSERT(false);
+            } break;
+        default:
+            {
+                WSP_GGML_ASSERT(false);
+            } break;
+    }
+}
+
+// wsp_ggml_compute_forward_conv_1d_k3
+
+// y[oc][t] = c[oc] + sum_ic sum_k a[oc][ic][k]*x[ic][s*t + k - 1], t = 0 .. OL-1
+// The input is packed in tiles of T = WSP_GGML_CONV_1D_K3_T output samples, X[tile][ic][k][0:T] holding the
+// (zero-padded) samples read by the tap k, so a tile streams through contiguous memory whatever the stride.
+// Blocks of 4 output channels x T samples are accumulated in registers over all the input channels, then the
+// output is final and the gelu is applied while it is in cache. The tiles are visited in blocks that fit in
+// the L2 cache, so the kernel rows of all the output channels reuse them.
+static void wsp_ggml_compute_forward_conv_1d_k3_f32(
+        const struct wsp_ggml_compute_params * params,
+        const struct wsp_ggml_tensor * src0,
+        const struct wsp_ggml_tensor * src1,
+        const struct wsp_ggml_tensor * src2,
+              struct wsp_ggml_tensor * dst) {
+    WSP_GGML_ASSERT(src0->type == WSP_GGML_TYPE_F16 || src0->type == WSP_GGML_TYPE_F32);
+    WSP_GGML_ASSERT(src1->type == WSP_GGML_TYPE_F32);
+    WSP_GGML_ASSERT(src2->type == WSP_GGML_TYPE_F32);
+    WSP_GGML_ASSERT( dst->type == WSP_GGML_TYPE_F32);
+
+    int64_t t0 = wsp_ggml_perf_time_us();
+    UNUSED(t0);
+
+    WSP_GGML_TENSOR_BINARY_OP_LOCALS
+
+    const int ith = params->ith;
+    const int nth = params->nth;
+
+    const int32_t s    = ((const int32_t *)(dst->op_params))[0];
+    const bool    gelu = ((const int32_t *)(dst->op_params))[1] != 0;
+
+    const int T = WSP_GGML_CONV_1D_K3_T;
+
+    const int64_t IC = ne01;
+    const int64_t OC = ne02;
+    const int64_t L  = ne10;
+    const int64_t OL = ne0;
+    const int64_t NT = (OL + T - 1)/T; // tiles
+
+    WSP_GGML_ASSERT(nb00 == wsp_ggml_type_size(src0->type));
     WSP_GGML_ASSERT(nb10 == sizeof(float));
+    WSP_GGML_ASSERT(nb0  == sizeof(float));
+    WSP_GGML_ASSERT(wsp_ggml_is_contiguous(src2));
+
+    float * const wk = (float *) params->wdata; // [OC][IC][3]
+    float * const wx = wk + 3*IC*OC;            // [NT][IC][3][T]
 
     if (params->type == WSP_GGML_TASK_INIT) {
+        // F32 kernel
+        for (int64_t i02 = 0; i02 < OC; i02++) {
+            for (int64_t i01 = 0; i01 < IC; i01++) {
+                const char * src = (const char *) src0->data + i02*nb02 + i01*nb01;
+                float * dst_data = wk + (i02*IC + i01)*3;
+                if (src0->type == WSP_GGML_TYPE_F16) {
+                    for (int64_t i00 = 0; i00 < 3; i00++) {
+                        dst_data[i00] = WSP_GGML_FP16_TO_FP32(((const wsp_ggml_fp16_t *) src)[i00]);
+                    }
+                } else {
+                    memcpy(dst_data, src, 3*sizeof(float));
+                }
+            }
+        }
+
+        // input tiles
+        for (int64_t i11 = 0; i11 < IC; i11++) {
+            const float * const src = (const float *)((const char *) src1->data + i11*nb11);
+            for (int64_t it = 0; it < NT; it++) {
+                float * dst_data = wx + ((it*IC + i11)*3)*T;
+                for (int k = 0; k < 3; k++) {
+                    for (int j = 0; j < T; j++) {
+                        const int64_t i10 = s*(it*T + j) + k - 1;
+                        dst_data[k*T + j] = i10 >= 0 && i10 < L ? src[i10] : 0.0f;
+                    }
+                }
+            }
+        }
+
         return;
     }
 
@@ -11890,51 +13139,102 @@ static void wsp_ggml_compute_forward_im2col_f16(
         return;
     }
 
-    // im2col: [N, IC, IH, IW] => [N, OH, OW, IC*KH*KW]
-    {
-        wsp_ggml_fp16_t * const wdata = (wsp_ggml_fp16_t *) dst->data;
+    // blocks of 4 output channels per thread
+    const int64_t nr = (OC + 3)/4;
+    const int64_t dr = (nr + nth - 1)/nth;
 
-        for (int64_t in = 0; in < N; in++) {
-            for (int64_t ioh = 0; ioh < OH; ioh++) { // 1
-                for (int64_t iow = 0; iow < OW; iow++) {
-                    for (int64_t iic = ith; iic < IC; iic += nth) {
+    const int64_t ir0 = MIN(4*dr*ith, OC);
+    const int64_t ir1 = MIN(ir0 + 4*dr, OC);
 
-                        // micro kernel
-                        wsp_ggml_fp16_t * dst_data = wdata + (in*OH*OW + ioh*OW + iow)*(IC*KH*KW); // [IC, KH, KW]
-                        const float * const src_data = (float *)((char *) src1->data + in*ofs0 + iic*ofs1); // [IH, IW]
+    // tiles per block, ~256 KB of input
+    const int64_t nb = MAX(1, (256*1024/sizeof(float))/(3*IC*T));
 
-                        for (int64_t ikh = 0; ikh < KH; ikh++) {  // 1
-                            for (int64_t ikw = 0; ikw < KW; ikw++) {
-                                const int64_t iiw = iow*s0 + ikw*d0 - p0;
-                                const int64_t iih = ioh*s1 + ikh*d1 - p1;
+    for (int64_t ib = 0; ib < NT; ib += nb) {
+        const int64_t ie = MIN(ib + nb, NT);
 
-                                if (iih < 0 || iih >= IH || iiw < 0 || iiw >= IW) {
-                                    dst_data[iic*(KH*KW) + ikh*KW + ikw] = 0;
-                                } else {
-                                    dst_data[iic*(KH*KW) + ikh*KW + ikw] = WSP_GGML_FP32_TO_FP16(src_data[iih*IW + iiw]);
-                                }
-                            }
+        for (int64_t oc = ir0; oc < ir1; oc += 4) {
+            const int64_t noc = MIN(4, ir1 - oc);
+
+            float * y[4];
+            const float * w[4];
+            float bias[4];
+            for (int i = 0; i < 4; i++) {
+                // the missing channels of the last block compute the last one again
+                const int64_t ioc = oc + MIN(i, noc - 1);
+                y[i]    = (float *)((char *) dst->data + ioc*nb1);
+                w[i]    = wk + ioc*IC*3;
+                bias[i] = ((const float *) src2->data)[ioc];
+            }
+
+            for (int64_t it = ib; it < ie; it++) {
+                const float * x = wx + it*IC*3*T;
+
+                const int64_t t  = it*T;
+                const int     nt = MIN(T, OL - t);
+
+                float tile[4][WSP_GGML_CONV_1D_K3_T];
+
+#if defined(WSP_GGML_SIMD)
+                WSP_GGML_F32_VEC sum[4][2];
+
+                for (int i = 0; i < 4; i++) {
+                    sum[i][0] = WSP_GGML_F32_VEC_SET1(bias[i]);
+                    sum[i][1] = sum[i][0];
+                }
+
+                for (int64_t ick = 0; ick < 3*IC; ick++) {
+                    const WSP_GGML_F32_VEC x0 = WSP_GGML_F32_VEC_LOAD(x + ick*T);
+                    const WSP_GGML_F32_VEC x1 = WSP_GGML_F32_VEC_LOAD(x + ick*T + WSP_GGML_F32_EPR);
+
+                    for (int i = 0; i < 4; i++) {
+                        const WSP_GGML_F32_VEC wv = WSP_GGML_F32_VEC_SET1(w[i][ick]);
+                        sum[i][0] = WSP_GGML_F32_VEC_FMA(sum[i][0], x0, wv);
+                        sum[i][1] = WSP_GGML_F32_VEC_FMA(sum[i][1], x1, wv);
+                    }
+                }
+
+                for (int i = 0; i < 4; i++) {
+                    WSP_GGML_F32_VEC_STORE(tile[i],                    sum[i][0]);
+                    WSP_GGML_F32_VEC_STORE(tile[i] + WSP_GGML_F32_EPR, sum[i][1]);
+                }
+#else
+                for (int i = 0; i < 4; i++) {
+                    for (int j = 0; j < T; j++) {
+                        tile[i][j] = bias[i];
+                    }
+                }
+
+                for (int64_t ick = 0; ick < 3*IC; ick++) {
+                    for (int i = 0; i < 4; i++) {
+                        for (int j = 0; j < T; j++) {
+                            tile[i][j] += w[i][ick]*x[ick*T + j];
                         }
                     }
                 }
+#endif
+
+                for (int i = 0; i < noc; i++) {
+                    if (gelu) {
+                        wsp_ggml_vec_gelu_f32(nt, y[i] + t, tile[i]);
+                    } else {
+                        memcpy(y[i] + t, tile[i], nt*sizeof(float));
+                    }
+                }
             }
         }
     }
 }
 
-static void wsp_ggml_compute_forward_im2col(
+static void wsp_ggml_compute_forward_conv_1d_k3(
         const struct wsp_ggml_compute_params * params,
         const struct wsp_ggml_tensor * src0,
         const struct wsp_ggml_tensor * src1,
+        const struct wsp_ggml_tensor * src2,
               struct wsp_ggml_tensor * dst) {
-    switch (src0->type) {
-        case WSP_GGML_TYPE_F16:
-            {
-                wsp_ggml_compute_forward_im2col_f16(params, src0, src1, dst);
-            } break;
+    switch (src1->type) {
         case WSP_GGML_TYPE_F32:
             {
-                WSP_GGML_ASSERT(false);
+                wsp_ggml_compute_forward_conv_1d_k3_f32(params, src0, src1, src2, dst);
             } break;
         default:
             {
@@ -12438,7 +13738,8 @@ static void wsp_ggml_compute_forward_flash_attn_f32(
     const int ir0 = dr*ith;
     const int ir1 = MIN(ir0 + dr, nr);
 
-    const float scale = 1.0f/sqrtf(D);
+    float scale;
+    memcpy(&scale, (float *) dst->op_params + 1, sizeof(float));
 
     //printf("P=%d N=%d D=%d ir0=%d ir1=%d scale = %f\n", P, N, D, ir0, ir1, scale);
 
@@ -12510,6 +13811,7 @@ static void wsp_ggml_compute_forward_flash_attn_f32(
 #ifndef WSP_GGML_FLASH_ATTN_EXP_FP16
                             const float val = expf(SS[j] - max);
 #else
+                            wsp_ggml_table_require(WSP_GGML_TABLE_EXP);
                             wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(SS[j] - max);
                             memcpy(&scvt[j], &s, sizeof(uint16_t));
                             const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt[j]]);
@@ -12557,6 +13859,85 @@ static void wsp_ggml_compute_forward_flash_attn_f32(
     }
 }
 
+// S[r][0:bc] = Q[r][0:D] * Kt[0:D][0:bc] for the nq rows of a tile, bc is a multiple of WSP_GGML_F32_STEP
+// kt - Kt row stride
+static void wsp_ggml_flash_attn_tile_qk(const int nq, const int D, const int bc, const int kt, const float * restrict Q, const float * restrict Kt, float * restrict S) {
+    for (int r = 0; r < nq; ++r) {
+        const float * restrict qr = Q + r*D;
+        float * restrict sr = S + r*bc;
+
+#if defined(WSP_GGML_SIMD)
+        for (int c = 0; c < bc; c += WSP_GGML_F32_STEP) {
+            WSP_GGML_F32_VEC sum[WSP_GGML_F32_ARR] = { WSP_GGML_F32_VEC_ZERO };
+
+            for (int d = 0; d < D; ++d) {
+                const WSP_GGML_F32_VEC qd = WSP_GGML_F32_VEC_SET1(qr[d]);
+                for (int j = 0; j < WSP_GGML_F32_ARR; j++) {
+                    sum[j] = WSP_GGML_F32_VEC_FMA(sum[j], WSP_GGML_F32_VEC_LOAD(Kt + d*kt + c + j*WSP_GGML_F32_EPR), qd);
+                }
+            }
+
+            for (int j = 0; j < WSP_GGML_F32_ARR; j++) {
+                WSP_GGML_F32_VEC_STORE(sr + c + j*WSP_GGML_F32_EPR, sum[j]);
+            }
+        }
+#else
+        for (int c = 0; c < bc; ++c) {
+            sr[c] = 0.0f;
+        }
+        for (int d = 0; d < D; ++d) {
+            for (int c = 0; c < bc; ++c) {
+                sr[c] += qr[d]*Kt[d*kt + c];
+            }
+        }
+#endif
+    }
+}
+
+// O[r][0:D] += P[r][0:nc] * V[0:nc][0:D] for the nq rows of a tile
+static void wsp_ggml_flash_attn_tile_pv(const int nq, const int nc, const int D, const int bc, const float * restrict P, const float * restrict V, float * restrict O) {
+    for (int r = 0; r < nq; ++r) {
+        const float * restrict pr = P + r*bc;
+        float * restrict or = O + r*D;
+
+        int d0 = 0;
+
+#if defined(WSP_GGML_SIMD)
+        for (; d0 + WSP_GGML_F32_STEP <= D; d0 += WSP_GGML_F32_STEP) {
+            WSP_GGML_F32_VEC sum[WSP_GGML_F32_ARR];
+
+            for (int j = 0; j < WSP_GGML_F32_ARR; j++) {
+                sum[j] = WSP_GGML_F32_VEC_LOAD(or + d0 + j*WSP_GGML_F32_EPR);
+            }
+
+            for (int c = 0; c < nc; ++c) {
+                const WSP_GGML_F32_VEC pc = WSP_GGML_F32_VEC_SET1(pr[c]);
+                for (int j = 0; j < WSP_GGML_F32_ARR; j++) {
+                    sum[j] = WSP_GGML_F32_VEC_FMA(sum[j], WSP_GGML_F32_VEC_LOAD(V + c*D + d0 + j*WSP_GGML_F32_EPR), pc);
+                }
+            }
+
+            for (int j = 0; j < WSP_GGML_F32_ARR; j++) {
+                WSP_GGML_F32_VEC_STORE(or + d0 + j*WSP_GGML_F32_EPR, sum[j]);
+            }
+        }
+#endif
+
+        // leftovers
+        for (int c = 0; c < nc; ++c) {
+            for (int d = d0; d < D; ++d) {
+                or[d] += pr[c]*V[c*D + d];
+            }
+        }
+    }
+}
+
+// tiled attention with an online softmax (ref: https://arxiv.org/abs/2205.14135):
+// the k/v of a head are converted to F32 once per thread and visited in blocks of WSP_GGML_FLASH_ATTN_BC rows,
+// each block is used by WSP_GGML_FLASH_ATTN_BR q rows at a time. The running max and sum of each q row rescale
+// its output, so only a BR x BC block of q*k^T ever exists.
+// With less than BR q rows per head (decoder cross-attention) the conversion does not pay off and the F16
+// k/v rows are used directly.
 static void wsp_ggml_compute_forward_flash_attn_f16(
         const struct wsp_ggml_compute_params * params,
         const struct wsp_ggml_tensor * q,
@@ -12584,8 +13965,6 @@ static void wsp_ggml_compute_forward_flash_attn_f16(
     const int64_t P = nek1 - N;
     const int64_t M = P + N;
 
-    const int Mup = wsp_ggml_up(M, WSP_GGML_SOFT_MAX_UNROLL);
-
     WSP_GGML_ASSERT(ne0 == D);
     WSP_GGML_ASSERT(ne1 == N);
     WSP_GGML_ASSERT(P >= 0);
@@ -12596,11 +13975,11 @@ static void wsp_ggml_compute_forward_flash_attn_f16(
 
     WSP_GGML_ASSERT(neq0 == D);
     WSP_GGML_ASSERT(nek0 == D);
+    WSP_GGML_ASSERT(nev0 == M);
     WSP_GGML_ASSERT(nev1 == D);
 
     WSP_GGML_ASSERT(neq1 == N);
     WSP_GGML_ASSERT(nek1 == N + P);
-    WSP_GGML_ASSERT(nev1 == D);
 
     // dst cannot be transposed or permuted
     WSP_GGML_ASSERT(nb0 == sizeof(float));
@@ -12616,7 +13995,10 @@ static void wsp_ggml_compute_forward_flash_attn_f16(
         return;
     }
 
-    // parallelize by q rows using wsp_ggml_vec_dot_f32
+    const int BR = WSP_GGML_FLASH_ATTN_BR;
+    const int BC = WSP_GGML_FLASH_ATTN_BC;
+
+    // parallelize by q rows
 
     // total rows in q
     const int nr = neq1*neq2*neq3;
@@ -12628,158 +14010,152 @@ static void wsp_ggml_compute_forward_flash_attn_f16(
     const int ir0 = dr*ith;
     const int ir1 = MIN(ir0 + dr, nr);
 
-    const float scale = 1.0f/sqrtf(D);
+    float scale;
+    memcpy(&scale, (float *) dst->op_params + 1, sizeof(float));
 
-    //printf("P=%d N=%d D=%d ir0=%d ir1=%d scale = %f\n", P, N, D, ir0, ir1, scale);
+    // k/v rows rounded up to a block
+    const int Mup = wsp_ggml_up(M, BC);
 
-    for (int ir = ir0; ir < ir1; ++ir) {
-        // q indices
+    // per thread: Q [BR][D], S [BR][BC], O [BR][D], running max and sum [BR], K^T [D][Mup], V [Mup][D]
+    float * Q   = (float *) params->wdata + ith*(WSP_GGML_FLASH_ATTN_WSIZE(D, M) + CACHE_LINE_SIZE_F32);
+    float * S   = Q + BR*D;
+    float * O   = S + BR*BC;
+    float * mx  = O + BR*D;
+    float * sum = mx + BR;
+    float * Kt  = sum + BR;
+    float * Vf  = Kt + D*Mup;
+
+    // few q rows per head: F16 dot products on k/v, Kt holds the F16 probabilities
+    const bool direct = neq1 < BR;
+    wsp_ggml_fp16_t * P16 = (wsp_ggml_fp16_t *) Kt;
+
+    // k/v head in Kt and Vf
+    int ik2_cur = -1;
+    int ik3_cur = -1;
+
+    for (int ir = ir0; ir < ir1; ) {
+        // q indices of the first row of the tile, the rows of a tile share iq2 and iq3
         const int iq3 = ir/(neq2*neq1);
         const int iq2 = (ir - iq3*neq2*neq1)/neq1;
         const int iq1 = (ir - iq3*neq2*neq1 - iq2*neq1);
 
-        float * S = (float *) params->wdata + ith*(2*Mup + CACHE_LINE_SIZE_F32);
-
-        for (int i = M; i < Mup; ++i) {
-            S[i] = -INFINITY;
-        }
-
-        if (WSP_GGML_VEC_DOT_UNROLL > 2 || nek1 % WSP_GGML_VEC_DOT_UNROLL != 0) {
-            for (int64_t ic = 0; ic < nek1; ++ic) {
-                // k indices
-                const int ik3 = iq3;
-                const int ik2 = iq2 % nek2;
-                const int ik1 = ic;
+        const int nq = MIN(MIN(BR, ir1 - ir), neq1 - iq1);
 
-                // S indices
-                const int i1 = ik1;
+        // k and v indices
+        const int ik2 = iq2 % nek2;
+        const int iv2 = iq2 % nev2;
 
-                wsp_ggml_vec_dot_f16(neq0,
-                        S + i1,
-                        (wsp_ggml_fp16_t *) ((char *) k->data + (ik1*nbk1 + ik2*nbk2 + ik3*nbk3)),
-                        (wsp_ggml_fp16_t *) ((char *) q->data + (iq1*nbq1 + iq2*nbq2 + iq3*nbq3)));
+        if (!direct && (ik2 != ik2_cur || iq3 != ik3_cur)) {
+            // K^T and V of the head in F32, the padding columns of K^T are zero
+            for (int64_t c = 0; c < M; ++c) {
+                const wsp_ggml_fp16_t * kc = (const wsp_ggml_fp16_t *) ((const char *) k->data + (c*nbk1 + ik2*nbk2 + iq3*nbk3));
+                for (int64_t d = 0; d < D; ++d) {
+                    Kt[d*Mup + c] = WSP_GGML_FP16_TO_FP32(kc[d]);
+                }
             }
-        } else {
-            for (int64_t ic = 0; ic < nek1; ic += WSP_GGML_VEC_DOT_UNROLL) {
-                // k indices
-                const int ik3 = iq3;
-                const int ik2 = iq2 % nek2;
-                const int ik1 = ic;
-
-                // S indices
-                const int i1 = ik1;
-
-                wsp_ggml_vec_dot_f16_unroll(neq0, nbk1,
-                        S + i1,
-                        ((char *) k->data + (ik1*nbk1 + ik2*nbk2 + ik3*nbk3)),
-                        (wsp_ggml_fp16_t *) ((char *) q->data + (iq1*nbq1 + iq2*nbq2 + iq3*nbq3)));
+            for (int64_t d = 0; d < D; ++d) {
+                for (int64_t c = M; c < Mup; ++c) {
+                    Kt[d*Mup + c] = 0.0f;
+                }
+            }
+            for (int64_t d = 0; d < D; ++d) {
+                const wsp_ggml_fp16_t * vd = (const wsp_ggml_fp16_t *) ((const char *) v->data + (d*nbv1 + iv2*nbv2 + iq3*nbv3));
+                for (int64_t c = 0; c < M; ++c) {
+                    Vf[c*D + d] = WSP_GGML_FP16_TO_FP32(vd[c]);
+                }
             }
-        }
 
-        // scale
-        wsp_ggml_vec_scale_f32(nek1, S, scale);
+            ik2_cur = ik2;
+            ik3_cur = iq3;
+        }
 
-        if (masked) {
-            for (int64_t i = P; i < M; i++) {
-                if (i > P + iq1) {
-                    S[i] = -INFINITY;
-                }
+        for (int r = 0; r < nq; ++r) {
+            const wsp_ggml_fp16_t * qr = (const wsp_ggml_fp16_t *) ((const char *) q->data + ((iq1 + r)*nbq1 + iq2*nbq2 + iq3*nbq3));
+            for (int64_t d = 0; d < D; ++d) {
+                Q[r*D + d] = WSP_GGML_FP16_TO_FP32(qr[d])*scale;
             }
+
+            mx[r]  = -INFINITY;
+            sum[r] = 0.0f;
+            wsp_ggml_vec_set_f32(D, O + r*D, 0.0f);
         }
 
-        // softmax
-        // todo: exclude known -INF S[..] values from max and loop, assuming their results to be zero.
-        // dont forget to set their S values to zero
-        {
-            float max = -INFINITY;
-            wsp_ggml_vec_max_f32(M, &max, S);
+        // causal mask: row iq1 + r sees the first P + iq1 + r + 1 k rows
+        const int64_t nk = masked ? MIN(M, P + iq1 + nq) : M;
 
-            wsp_ggml_float sum = 0.0;
-            {
-#ifdef WSP_GGML_SOFT_MAX_ACCELERATE
-                max = -max;
-                vDSP_vsadd(S, 1, &max, S, 1, Mup);
-                vvexpf(S, S, &Mup);
-                wsp_ggml_vec_sum_f32(Mup, &sum, S);
-#else
-                uint16_t   scvt[WSP_GGML_SOFT_MAX_UNROLL];
-                wsp_ggml_float sump[WSP_GGML_SOFT_MAX_UNROLL] = { 0.0 };
+        for (int64_t ic0 = 0; ic0 < nk; ic0 += BC) {
+            const int nc = MIN(BC, nk - ic0);
 
-                for (int i = 0; i < Mup; i += WSP_GGML_SOFT_MAX_UNROLL) {
-                    float * SS = S + i;
+            if (direct) {
+                for (int r = 0; r < nq; ++r) {
+                    wsp_ggml_fp16_t * qr = (wsp_ggml_fp16_t *) ((char *) q->data + ((iq1 + r)*nbq1 + iq2*nbq2 + iq3*nbq3));
+                    for (int i = 0; i < nc; ++i) {
+                        wsp_ggml_fp16_t * kc = (wsp_ggml_fp16_t *) ((char *) k->data + ((ic0 + i)*nbk1 + ik2*nbk2 + iq3*nbk3));
+                        wsp_ggml_vec_dot_f16(D, S + r*BC + i, kc, qr);
+                    }
+                    wsp_ggml_vec_scale_f32(nc, S + r*BC, scale);
+                }
+            } else {
+                wsp_ggml_flash_attn_tile_qk(nq, D, BC, Mup, Q, Kt + ic0, S);
+            }
 
-                    for (int j = 0; j < WSP_GGML_SOFT_MAX_UNROLL; ++j) {
-                        if (SS[j] == -INFINITY) {
-                            SS[j] = 0.0f;
-                        } else {
-                            wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(SS[j] - max);
-                            memcpy(&scvt[j], &s, sizeof(uint16_t));
-                            const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt[j]]);
-                            sump[j] += (wsp_ggml_float)val;
-                            SS[j] = val;
+            for (int r = 0; r < nq; ++r) {
+                float * SS = S + r*BC;
+
+                if (masked) {
+                    for (int i = 0; i < nc; ++i) {
+                        if (ic0 + i > P + iq1 + r) {
+                            SS[i] = -INFINITY;
                         }
                     }
                 }
 
-                for (int i = 0; i < WSP_GGML_SOFT_MAX_UNROLL; i++) {
-                    sum += sump[i];
-                }
-#endif
-            }
+                float m_new = -INFINITY;
+                wsp_ggml_vec_max_f32(nc, &m_new, SS);
+                m_new = MAX(m_new, mx[r]);
 
-            assert(sum > 0.0);
+                if (m_new == -INFINITY) {
+                    // fully masked so far
+                    wsp_ggml_vec_set_f32(nc, SS, 0.0f);
+                    continue;
+                }
 
-            sum = 1.0/sum;
-            wsp_ggml_vec_scale_f32(M, S, sum);
+                // rescale the previous blocks to the new max
+                if (m_new > mx[r]) {
+                    const float c = mx[r] == -INFINITY ? 0.0f : expf(mx[r] - m_new);
+                    wsp_ggml_vec_scale_f32(D, O + r*D, c);
+                    sum[r] *= c;
+                    mx[r] = m_new;
+                }
 
-#ifndef NDEBUG
-            for (int i = 0; i < M; ++i) {
-                assert(!isnan(S[i]));
-                assert(!isinf(S[i]));
+                sum[r] += wsp_ggml_vec_soft_max_f32(nc, SS, SS, m_new);
             }
-#endif
-        }
 
-        wsp_ggml_fp16_t * S16 = (wsp_ggml_fp16_t *) ((float *) params->wdata + ith*(2*Mup + CACHE_LINE_SIZE_F32) + Mup);
-
-        for (int64_t i = 0; i < M; i++) {
-            S16[i] = WSP_GGML_FP32_TO_FP16(S[i]);
+            if (direct) {
+                for (int r = 0; r < nq; ++r) {
+                    wsp_ggml_fp32_to_fp16_row(S + r*BC, P16, nc);
+                    for (int64_t d = 0; d < D; ++d) {
+                        wsp_ggml_fp16_t * vd = (wsp_ggml_fp16_t *) ((char *) v->data + (d*nbv1 + iv2*nbv2 + iq3*nbv3));
+                        float pv = 0.0f;
+                        wsp_ggml_vec_dot_f16(nc, &pv, vd + ic0, P16);
+                        O[r*D + d] += pv;
+                    }
+                }
+            } else {
+                wsp_ggml_flash_attn_tile_pv(nq, nc, D, BC, S, Vf + ic0*D, O);
+            }
         }
 
-        // todo: exclude known zero S[..] values from dot (reducing nev0 and increasing begin of v and S16).
-        if (WSP_GGML_VEC_DOT_UNROLL == 1 || (nev1 % WSP_GGML_VEC_DOT_UNROLL != 0)) {
-            for (int64_t ic = 0; ic < nev1; ++ic) {
-                // dst indices
-                const int i1 = iq1;
-                const int i2 = iq2;
-                const int i3 = iq3;
-
-                // v indices
-                const int iv2 = iq2 % nev2;
-                const int iv3 = iq3;
-
-                wsp_ggml_vec_dot_f16(nev0,
-                        (float *)       ((char *) dst->data + (ic*nb0 + i1*nb1  + i2*nb2   + i3*nb3)),
-                        (wsp_ggml_fp16_t *) ((char *) v->data   + (         ic*nbv1 + iv2*nbv2 + iv3*nbv3)),
-                        S16);
-            }
-        } else {
-            for (int64_t ic = 0; ic < nev1; ic += WSP_GGML_VEC_DOT_UNROLL) {
-                // dst indices
-                const int i1 = iq1;
-                const int i2 = iq2;
-                const int i3 = iq3;
+        for (int r = 0; r < nq; ++r) {
+            assert(sum[r] > 0.0f);
 
-                // v indices
-                const int iv2 = iq2 % nev2;
-                const int iv3 = iq3;
+            float * dst_row = (float *) ((char *) dst->data + ((iq1 + r)*nb1 + iq2*nb2 + iq3*nb3));
 
-                wsp_ggml_vec_dot_f16_unroll(nev0, nbv1,
-                        (float *) ((char *) dst->data + (ic*nb0 + i1*nb1  + i2*nb2   + i3*nb3)),
-                        ((char *)             v->data + (         ic*nbv1 + iv2*nbv2 + iv3*nbv3)),
-                        S16);
-            }
+            wsp_ggml_vec_cpy_f32(D, dst_row, O + r*D);
+            wsp_ggml_vec_scale_f32(D, dst_row, 1.0f/sum[r]);
         }
+
+        ir += nq;
     }
 }
 
@@ -13163,6 +14539,7 @@ static void wsp_ggml_compute_forward_flash_attn_back_f32(
 #ifndef WSP_GGML_FLASH_ATTN_EXP_FP16
                                     const float val = expf(SR[j] - max);
 #else
+                                    wsp_ggml_table_require(WSP_GGML_TABLE_EXP);
                                     wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(SR[j] - max);
                                     memcpy(&scvt[j], &s, sizeof(uint16_t));
                                     const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt[j]]);
@@ -13913,6 +15290,7 @@ static void wsp_ggml_compute_forward_cross_entropy_loss_f32(
                     const float s = s0[i] - max;
                     const float val = expf(s);
 #else
+                    wsp_ggml_table_require(WSP_GGML_TABLE_EXP);
                     wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(s0[i] - max);
                     memcpy(&scvt, &s, sizeof(scvt));
                     const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt]);
@@ -14027,6 +15405,7 @@ static void wsp_ggml_compute_forward_cross_entropy_loss_back_f32(
                     const float s = s0[i] - max;
                     const float val = expf(s);
 #else
+                    wsp_ggml_table_require(WSP_GGML_TABLE_EXP);
                     wsp_ggml_fp16_t s = WSP_GGML_FP32_TO_FP16(s0[i] - max);
                     memcpy(&scvt, &s, sizeof(scvt));
                     const float val = WSP_GGML_FP16_TO_FP32(wsp_ggml_table_exp_f16[scvt]);
@@ -14180,7 +15559,12 @@ static void wsp_ggml_compute_forward(struct wsp_ggml_compute_params * params, st
             {
                 wsp_ggml_compute_forward_group_norm(params, tensor->src[0], tensor);
             } break;
+        case WSP_GGML_OP_NORM_AFFINE:
+            {
+                wsp_ggml_compute_forward_norm_affine(params, tensor->src[0], tensor->src[1], tensor->src[2], tensor);
+            } break;
         case WSP_GGML_OP_MUL_MAT:
+        case WSP_GGML_OP_MUL_MAT_BIAS:
             {
                 wsp_ggml_compute_forward_mul_mat(params, tensor->src[0], tensor->src[1], tensor, 0, tensor->ne[1]);
             } break;
@@ -14276,6 +15660,10 @@ static void wsp_ggml_compute_forward(struct wsp_ggml_compute_params * params, st
             {
                 wsp_ggml_compute_forward_im2col(params, tensor->src[0], tensor->src[1], tensor);
             } break;
+        case WSP_GGML_OP_CONV_1D_K3:
+            {
+                wsp_ggml_compute_forward_conv_1d_k3(params, tensor->src[0], tensor->src[1], tensor->src[2], tensor);
+            } break;
         case WSP_GGML_OP_CONV_TRANSPOSE_2D:
             {
                 wsp_ggml_compute_forward_conv_transpose_2d(params, tensor->src[0], tensor->src[1], tensor);
@@ -14896,6 +16284,14 @@ static void wsp_ggml_compute_backward(struct wsp_ggml_context * ctx, struct wsp_
             {
                 WSP_GGML_ASSERT(false); // TODO: not implemented
             } break;
+        case WSP_GGML_OP_NORM_AFFINE:
+            {
+                WSP_GGML_ASSERT(false); // TODO: not implemented
+            } break;
+        case WSP_GGML_OP_MUL_MAT_BIAS:
+            {
+                WSP_GGML_ASSERT(false); // TODO: not implemented
+            } break;
         case WSP_GGML_OP_MUL_MAT:
             {
                 // https://cs231n.github.io/optimization-2/#staged
@@ -15280,6 +16676,10 @@ static void wsp_ggml_compute_backward(struct wsp_ggml_context * ctx, struct wsp_
             {
                 WSP_GGML_ASSERT(false); // TODO: not implemented
             } break;
+        case WSP_GGML_OP_CONV_1D_K3:
+            {
+                WSP_GGML_ASSERT(false); // TODO: not implemented
+            } break;
         case WSP_GGML_OP_CONV_TRANSPOSE_2D:
             {
                 WSP_GGML_ASSERT(false); // TODO: not implemented
@@ -15741,6 +17141,107 @@ void wsp_ggml_graph_clear(struct wsp_ggml_cgraph * cgraph) {
     memset(cgraph->visited_hash_table.keys, 0, cgraph->visited_hash_table.size * sizeof(struct wsp_ggml_tensor *));
 }
 
+// wsp_ggml_graph_fuse
+
+// F32 vector [ne0, 1, 1, 1] added to (or multiplying) every row of a, a [1, ne0] one broadcasts per column instead
+static bool wsp_ggml_is_row_vector_of(const struct wsp_ggml_tensor * v, const struct wsp_ggml_tensor * a) {
+    return v->type == WSP_GGML_TYPE_F32 && wsp_ggml_is_contiguous(v) &&
+        v->ne[0] == a->ne[0] && v->ne[1] == 1 && v->ne[2] == 1 && v->ne[3] == 1;
+}
+
+void wsp_ggml_graph_fuse(struct wsp_ggml_cgraph * cgraph) {
+    WSP_GGML_ASSERT(cgraph->grads == NULL);
+
+    const struct wsp_ggml_hash_set hs = cgraph->visited_hash_table;
+
+    // number of uses of each tensor, -1: fused into its consumer
+    int * n_uses = calloc(hs.size, sizeof(int));
+    WSP_GGML_ASSERT(n_uses);
+
+    for (int i = 0; i < cgraph->n_nodes; i++) {
+        struct wsp_ggml_tensor * node = cgraph->nodes[i];
+        for (int j = 0; j < WSP_GGML_MAX_SRC; j++) {
+            if (node->src[j] && wsp_ggml_hash_contains(hs, node->src[j])) {
+                n_uses[wsp_ggml_hash_find(hs, node->src[j])]++;
+            }
+        }
+        if (node->view_src && wsp_ggml_hash_contains(hs, node->view_src)) {
+            n_uses[wsp_ggml_hash_find(hs, node->view_src)]++;
+        }
+    }
+
+// intermediate result only used by its consumer
+#define WSP_GGML_FUSABLE(t, o) \
+    ((t)->op == (o) && (t)->view_src == NULL && wsp_ggml_hash_contains(hs, (t)) && n_uses[wsp_ggml_hash_find(hs, (t))] == 1)
+#define WSP_GGML_FUSED(t) n_uses[wsp_ggml_hash_find(hs, (t))] = -1
+
+    bool fused = false;
+
+    for (int i = 0; i < cgraph->n_nodes; i++) {
+        struct wsp_ggml_tensor * node = cgraph->nodes[i];
+
+        if (node->view_src != NULL || node->type != WSP_GGML_TYPE_F32) {
+            continue;
+        }
+
+        if (node->op == WSP_GGML_OP_ADD) {
+            struct wsp_ggml_tensor * a = node->src[0];
+            struct wsp_ggml_tensor * b = node->src[1];
+
+            if (WSP_GGML_FUSABLE(a, WSP_GGML_OP_MUL_MAT) && wsp_ggml_is_row_vector_of(b, a)) {
+                // add(mul_mat(a0, a1), b) -> mul_mat_bias(a0, a1, b, false)
+                node->op     = WSP_GGML_OP_MUL_MAT_BIAS;
+                node->src[0] = a->src[0];
+                node->src[1] = a->src[1];
+                node->src[2] = b;
+                wsp_ggml_set_op_params_i32(node, 0, 0);
+                WSP_GGML_FUSED(a);
+                fused = true;
+            } else if (WSP_GGML_FUSABLE(a, WSP_GGML_OP_MUL) && wsp_ggml_is_row_vector_of(b, a) &&
+                       WSP_GGML_FUSABLE(a->src[0], WSP_GGML_OP_NORM) && wsp_ggml_is_row_vector_of(a->src[1], a)) {
+                // add(mul(norm(x), w), b) -> norm_affine(x, w, b)
+                struct wsp_ggml_tensor * norm = a->src[0];
+                node->op     = WSP_GGML_OP_NORM_AFFINE;
+                node->src[0] = norm->src[0];
+                node->src[1] = a->src[1];
+                node->src[2] = b;
+                memcpy(node->op_params, norm->op_params, sizeof(float)); // eps
+                WSP_GGML_FUSED(a);
+                WSP_GGML_FUSED(norm);
+                fused = true;
+            }
+        } else if (node->op == WSP_GGML_OP_UNARY && wsp_ggml_get_unary_op(node) == WSP_GGML_UNARY_OP_GELU) {
+            struct wsp_ggml_tensor * a = node->src[0];
+
+            if (WSP_GGML_FUSABLE(a, WSP_GGML_OP_MUL_MAT_BIAS) && wsp_ggml_get_op_params_i32(a, 0) == 0) {
+                // gelu(mul_mat_bias(a0, a1, b, false)) -> mul_mat_bias(a0, a1, b, true)
+                node->op     = WSP_GGML_OP_MUL_MAT_BIAS;
+                node->src[0] = a->src[0];
+                node->src[1] = a->src[1];
+                node->src[2] = a->src[2];
+                wsp_ggml_set_op_params_i32(node, 0, 1);
+                WSP_GGML_FUSED(a);
+                fused = true;
+            }
+        }
+    }
+
+#undef WSP_GGML_FUSABLE
+#undef WSP_GGML_FUSED
+
+    if (fused) {
+        int n_nodes = 0;
+        for (int i = 0; i < cgraph->n_nodes; i++) {
+            if (n_uses[wsp_ggml_hash_find(hs, cgraph->nodes[i])] >= 0) {
+                cgraph->nodes[n_nodes++] = cgraph->nodes[i];
+            }
+        }
+        cgraph->n_nodes = n_nodes;
+    }
+
+    free(n_uses);
+}
+
 //
 // thread data
 //
@@ -15947,11 +17448,13 @@ static int wsp_ggml_get_n_tasks(struct wsp_ggml_tensor * node, int n_threads) {
         case WSP_GGML_OP_RMS_NORM:
         case WSP_GGML_OP_RMS_NORM_BACK:
         case WSP_GGML_OP_GROUP_NORM:
+        case WSP_GGML_OP_NORM_AFFINE:
         case WSP_GGML_OP_CONCAT:
             {
                 n_tasks = n_threads;
             } break;
         case WSP_GGML_OP_MUL_MAT:
+        case WSP_GGML_OP_MUL_MAT_BIAS:
             {
                 n_tasks = n_threads;
 
@@ -16031,6 +17534,10 @@ static int wsp_ggml_get_n_tasks(struct wsp_ggml_tensor * node, int n_threads) {
             {
                 n_tasks = n_threads;
             } break;
+        case WSP_GGML_OP_CONV_1D_K3:
+            {
+                n_tasks = n_threads;
+            } break;
         case WSP_GGML_OP_CONV_TRANSPOSE_2D:
             {
                 n_tasks = n_threads;
@@ -16294,6 +17801,7 @@ struct wsp_ggml_cplan wsp_ggml_graph_plan(struct wsp_ggml_cgraph * cgraph, int n
                     }
                 } break;
             case WSP_GGML_OP_MUL_MAT:
+            case WSP_GGML_OP_MUL_MAT_BIAS:
                 {
                     const enum wsp_ggml_type vec_dot_type = type_traits[node->src[0]->type].vec_dot_type;
 
@@ -16366,6 +17874,17 @@ struct wsp_ggml_cplan wsp_ggml_graph_plan(struct wsp_ggml_cgraph * cgraph, int n
                         WSP_GGML_ASSERT(false);
                     }
                 } break;
+            case WSP_GGML_OP_CONV_1D_K3:
+                {
+                    const int64_t ne01 = node->src[0]->ne[1]; // IC
+                    const int64_t ne02 = node->src[0]->ne[2]; // OC
+
+                    const int64_t OL = node->ne[0];
+
+                    // F32 kernel and the input packed in tiles
+                    cur += sizeof(float)*3*ne01*ne02;
+                    cur += sizeof(float)*3*ne01*wsp_ggml_up(OL, WSP_GGML_CONV_1D_K3_T);
+                } break;
             case WSP_GGML_OP_CONV_TRANSPOSE_2D:
                 {
                     const int64_t ne00 = node->src[0]->ne[0]; // W
@@ -16388,8 +17907,10 @@ struct wsp_ggml_cplan wsp_ggml_graph_plan(struct wsp_ggml_cgraph * cgraph, int n
                         cur  = sizeof(float)*ne11*n_tasks; // TODO: this can become (n_tasks-1)
                         cur += sizeof(float)*ne11*n_tasks; // this is overestimated by x2
                     } else if (node->src[1]->type == WSP_GGML_TYPE_F16) {
-                        cur  = sizeof(float)*ne11*n_tasks; // TODO: this can become (n_tasks-1)
-                        cur += sizeof(float)*ne11*n_tasks; // this is overestimated by x2
+                        // one tile and the F32 k/v of one head per thread
+                        const int64_t D = node->src[0]->ne[0];
+                        const int64_t M = node->src[1]->ne[1];
+                        cur = sizeof(float)*(WSP_GGML_FLASH_ATTN_WSIZE(D, M) + CACHE_LINE_SIZE_F32)*n_tasks;
                     }
                 } break;
             case WSP_GGML_OP_FLASH_FF:
@@ -19521,6 +21042,34 @@ int wsp_ggml_cpu_has_arm_fma(void) {
 #endif
 }
 
+int wsp_ggml_cpu_has_dotprod(void) {
+    struct wsp_ggml_cpu_features f;
+    wsp_ggml_detect_cpu_features(&f);
+    return f.arm_dotprod;
+}
+
+int wsp_ggml_cpu_has_matmul_int8(void) {
+    struct wsp_ggml_cpu_features f;
+    wsp_ggml_detect_cpu_features(&f);
+    return f.arm_i8mm;
+}
+
+const char * wsp_ggml_cpu_dispatch(void) {
+    struct wsp_ggml_cpu_features f;
+    wsp_ggml_detect_cpu_features(&f);
+
+    const struct wsp_ggml_cpu_kernels * kernels = wsp_ggml_cpu_select_kernels(&f);
+
+    return kernels ? kernels->name : "none";
+}
+
+const char * wsp_ggml_cpu_unsupported(void) {
+    struct wsp_ggml_cpu_features f;
+    wsp_ggml_detect_cpu_features(&f);
+
+    return wsp_ggml_cpu_missing_feature(&f);
+}
+
 int wsp_ggml_cpu_has_metal(void) {
 #if defined(WSP_GGML_USE_METAL)
     return 1;
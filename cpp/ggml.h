@@ -393,9 +393,11 @@ extern "C" {
         WSP_GGML_OP_RMS_NORM,
         WSP_GGML_OP_RMS_NORM_BACK,
         WSP_GGML_OP_GROUP_NORM,
+        WSP_GGML_OP_NORM_AFFINE,
 
         WSP_GGML_OP_MUL_MAT,
         WSP_GGML_OP_MUL_MAT_ID,
+        WSP_GGML_OP_MUL_MAT_BIAS,
         WSP_GGML_OP_OUT_PROD,
 
         WSP_GGML_OP_SCALE,
@@ -419,6 +421,7 @@ extern "C" {
         WSP_GGML_OP_CLAMP,
         WSP_GGML_OP_CONV_TRANSPOSE_1D,
         WSP_GGML_OP_IM2COL,
+        WSP_GGML_OP_CONV_1D_K3,
         WSP_GGML_OP_CONV_TRANSPOSE_2D,
         WSP_GGML_OP_POOL_1D,
         WSP_GGML_OP_POOL_2D,
@@ -1034,6 +1037,15 @@ extern "C" {
             struct wsp_ggml_tensor  * a,
             int                   n_groups);
 
+    // normalize along rows, then scale by w and add b (w, b: vectors of a->ne[0] elements)
+    // same as wsp_ggml_add(wsp_ggml_mul(wsp_ggml_norm(a, eps), w), b) in one pass
+    WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_norm_affine(
+            struct wsp_ggml_context * ctx,
+            struct wsp_ggml_tensor  * a,
+            struct wsp_ggml_tensor  * w,
+            struct wsp_ggml_tensor  * b,
+            float                 eps);
+
     // a - x
     // b - dy
     WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_rms_norm_back(
@@ -1050,6 +1062,15 @@ extern "C" {
             struct wsp_ggml_tensor  * a,
             struct wsp_ggml_tensor  * b);
 
+    // wsp_ggml_mul_mat(a, b) + c, followed by gelu if gelu is true (c: vector of a->ne[1] elements)
+    // the bias and the gelu are applied as the result is computed
+    WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_mul_mat_bias(
+            struct wsp_ggml_context * ctx,
+            struct wsp_ggml_tensor  * a,
+            struct wsp_ggml_tensor  * b,
+            struct wsp_ggml_tensor  * c,
+            bool                  gelu);
+
     // indirect matrix multiplication
     //  wsp_ggml_mul_mat_id(ctx, as, ids, id, b) ~= wsp_ggml_mul_mat(as[ids[id]], b)
     WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_mul_mat_id(
@@ -1468,6 +1489,20 @@ extern "C" {
             int                   s,
             int                   d);
 
+    // conv_1d with a kernel of size 3 and padding = 1, bias c added to the result, optionally followed by gelu
+    // computed directly (no im2col), F32 result
+    // a: [OC, IC, 3]
+    // b: [IC, L]
+    // c: [OC, 1]
+    // result: [OC, OL]
+    WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_conv_1d_k3(
+            struct wsp_ggml_context * ctx,
+            struct wsp_ggml_tensor  * a,
+            struct wsp_ggml_tensor  * b,
+            struct wsp_ggml_tensor  * c,
+            int                   s,
+            bool                  gelu);
+
     WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_conv_transpose_1d(
             struct wsp_ggml_context * ctx,
             struct wsp_ggml_tensor  * a,
@@ -1587,6 +1622,15 @@ extern "C" {
             struct wsp_ggml_tensor  * v,
             bool                  masked);
 
+    // same as wsp_ggml_flash_attn, with q*k^T scaled by scale instead of 1/sqrt(D)
+    WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_flash_attn_scaled(
+            struct wsp_ggml_context * ctx,
+            struct wsp_ggml_tensor  * q,
+            struct wsp_ggml_tensor  * k,
+            struct wsp_ggml_tensor  * v,
+            bool                  masked,
+            float                 scale);
+
     WSP_GGML_API struct wsp_ggml_tensor * wsp_ggml_flash_attn_back(
            struct wsp_ggml_context * ctx,
            struct wsp_ggml_tensor  * q,
@@ -1820,6 +1864,14 @@ extern "C" {
     WSP_GGML_API void                 wsp_ggml_graph_reset       (struct wsp_ggml_cgraph * cgraph);  // zero grads
     WSP_GGML_API void                 wsp_ggml_graph_clear       (struct wsp_ggml_cgraph * cgraph);
 
+    // rewrite the graph with fused ops (CPU backend only):
+    //   add(mul(norm(x), w), b)        -> norm_affine(x, w, b)
+    //   add(mul_mat(a, x), c)          -> mul_mat_bias(a, x, c, false)
+    //   gelu(mul_mat_bias(a, x, c, 0)) -> mul_mat_bias(a, x, c, true)
+    // the fused intermediate tensors must have no other use, they are removed from the graph
+    // call it once the graph is built, before allocating it
+    WSP_GGML_API void                 wsp_ggml_graph_fuse        (struct wsp_ggml_cgraph * cgraph);
+
     WSP_GGML_API size_t wsp_ggml_graph_overhead(void);
     WSP_GGML_API size_t wsp_ggml_graph_overhead_custom(size_t size, bool grads);
 
@@ -2182,6 +2234,8 @@ extern "C" {
     WSP_GGML_API int wsp_ggml_cpu_has_fma        (void);
     WSP_GGML_API int wsp_ggml_cpu_has_neon       (void);
     WSP_GGML_API int wsp_ggml_cpu_has_arm_fma    (void);
+    WSP_GGML_API int wsp_ggml_cpu_has_dotprod    (void);
+    WSP_GGML_API int wsp_ggml_cpu_has_matmul_int8(void);
     WSP_GGML_API int wsp_ggml_cpu_has_metal      (void);
     WSP_GGML_API int wsp_ggml_cpu_has_f16c       (void);
     WSP_GGML_API int wsp_ggml_cpu_has_fp16_va    (void);
@@ -2194,6 +2248,13 @@ extern "C" {
     WSP_GGML_API int wsp_ggml_cpu_has_ssse3      (void);
     WSP_GGML_API int wsp_ggml_cpu_has_vsx        (void);
 
+    // name of the kernel set selected at runtime above the compile-time baseline ("none" if there is none)
+    WSP_GGML_API const char * wsp_ggml_cpu_dispatch(void);
+
+    // instruction set the library was compiled for that this CPU lacks (NULL if it can run the build),
+    // wsp_ggml_init() returns NULL instead of crashing on an illegal instruction later
+    WSP_GGML_API const char * wsp_ggml_cpu_unsupported(void);
+
     //
     // Internal types and functions exposed for tests and benchmarks
     //
@@ -2207,6 +2268,9 @@ extern "C" {
     typedef void (*wsp_ggml_to_float_t)  (const void  * WSP_GGML_RESTRICT x, float * WSP_GGML_RESTRICT y, int k);
     typedef void (*wsp_ggml_from_float_t)(const float * WSP_GGML_RESTRICT x, void  * WSP_GGML_RESTRICT y, int k);
     typedef void (*wsp_ggml_vec_dot_t)   (const int n, float * WSP_GGML_RESTRICT s, const void * WSP_GGML_RESTRICT x, const void * WSP_GGML_RESTRICT y);
+    // tiled dot products of nr0 rows of x with nr1 rows of y: s[j*bs + i] = dot(x_i, y_j), bx/by are row strides in bytes
+    typedef void (*wsp_ggml_gemm_t)      (const int n, const int nr0, const int nr1, float * WSP_GGML_RESTRICT s, size_t bs,
+                                          const void * WSP_GGML_RESTRICT x, size_t bx, const void * WSP_GGML_RESTRICT y, size_t by);
 
     typedef struct {
         const char      * type_name;
@@ -2218,6 +2282,7 @@ extern "C" {
         wsp_ggml_from_float_t from_float_reference;
         wsp_ggml_vec_dot_t    vec_dot;
         enum wsp_ggml_type    vec_dot_type;
+        wsp_ggml_gemm_t       gemm; // optional, used by mul_mat when src1 has many rows
     } wsp_ggml_type_traits_t;
 
     WSP_GGML_API wsp_ggml_type_traits_t wsp_ggml_internal_get_type_traits(enum wsp_ggml_type type);
@@ -0,0 +1,497 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <vector>
+#include "rn-quantize.h"
+#include "rn-whisper-log.h"
+#include "whisper.h"
+
+namespace rnwhisper {
+
+struct tensor_header {
+    int32_t n_dims;
+    int32_t ttype;
+    int32_t ne[4];
+    std::string name;
+    std::streampos type_pos; // position of the type in the type table of the output
+};
+
+static bool is_writable(wsp_ggml_type type) {
+    switch (type) {
+        case WSP_GGML_TYPE_F32:
+        case WSP_GGML_TYPE_F16:
+        case WSP_GGML_TYPE_Q4_0:
+        case WSP_GGML_TYPE_Q4_1:
+        case WSP_GGML_TYPE_Q5_0:
+        case WSP_GGML_TYPE_Q5_1:
+        case WSP_GGML_TYPE_Q8_0:
+        case WSP_GGML_TYPE_Q2_K:
+        case WSP_GGML_TYPE_Q3_K:
+        case WSP_GGML_TYPE_Q4_K:
+        case WSP_GGML_TYPE_Q5_K:
+        case WSP_GGML_TYPE_Q6_K:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static wsp_ggml_ftype type_to_ftype(wsp_ggml_type type) {
+    switch (type) {
+        case WSP_GGML_TYPE_F32:  return WSP_GGML_FTYPE_ALL_F32;
+        case WSP_GGML_TYPE_F16:  return WSP_GGML_FTYPE_MOSTLY_F16;
+        case WSP_GGML_TYPE_Q4_0: return WSP_GGML_FTYPE_MOSTLY_Q4_0;
+        case WSP_GGML_TYPE_Q4_1: return WSP_GGML_FTYPE_MOSTLY_Q4_1;
+        case WSP_GGML_TYPE_Q5_0: return WSP_GGML_FTYPE_MOSTLY_Q5_0;
+        case WSP_GGML_TYPE_Q5_1: return WSP_GGML_FTYPE_MOSTLY_Q5_1;
+        case WSP_GGML_TYPE_Q8_0: return WSP_GGML_FTYPE_MOSTLY_Q8_0;
+        case WSP_GGML_TYPE_Q2_K: return WSP_GGML_FTYPE_MOSTLY_Q2_K;
+        case WSP_GGML_TYPE_Q3_K: return WSP_GGML_FTYPE_MOSTLY_Q3_K;
+        case WSP_GGML_TYPE_Q4_K: return WSP_GGML_FTYPE_MOSTLY_Q4_K;
+        case WSP_GGML_TYPE_Q5_K: return WSP_GGML_FTYPE_MOSTLY_Q5_K;
+        case WSP_GGML_TYPE_Q6_K: return WSP_GGML_FTYPE_MOSTLY_Q6_K;
+        default:                 return WSP_GGML_FTYPE_UNKNOWN;
+    }
+}
+
+// next type with more precision, type itself at the end of the ladder
+static wsp_ggml_type promote_type(wsp_ggml_type type) {
+    switch (type) {
+        case WSP_GGML_TYPE_Q2_K: return WSP_GGML_TYPE_Q3_K;
+        case WSP_GGML_TYPE_Q3_K: return WSP_GGML_TYPE_Q4_K;
+        case WSP_GGML_TYPE_Q4_K: return WSP_GGML_TYPE_Q5_K;
+        case WSP_GGML_TYPE_Q5_K: return WSP_GGML_TYPE_Q6_K;
+        case WSP_GGML_TYPE_Q6_K: return WSP_GGML_TYPE_Q8_0;
+        case WSP_GGML_TYPE_Q4_0: return WSP_GGML_TYPE_Q5_0;
+        case WSP_GGML_TYPE_Q4_1: return WSP_GGML_TYPE_Q5_1;
+        case WSP_GGML_TYPE_Q5_0:
+        case WSP_GGML_TYPE_Q5_1: return WSP_GGML_TYPE_Q8_0;
+        case WSP_GGML_TYPE_Q8_0: return WSP_GGML_TYPE_F16;
+        default:                 return type;
+    }
+}
+
+// type of about the same size for rows that are not a multiple of the block size of type
+// (the k-quants need 256, n_state = 384 for tiny)
+static wsp_ggml_type fallback_type(wsp_ggml_type type) {
+    switch (type) {
+        case WSP_GGML_TYPE_Q2_K:
+        case WSP_GGML_TYPE_Q3_K:
+        case WSP_GGML_TYPE_Q4_K: return WSP_GGML_TYPE_Q4_0;
+        case WSP_GGML_TYPE_Q5_K: return WSP_GGML_TYPE_Q5_0;
+        case WSP_GGML_TYPE_Q6_K: return WSP_GGML_TYPE_Q8_0;
+        default:                 return WSP_GGML_TYPE_F16;
+    }
+}
+
+bool quantize_type_from_name(const std::string & name, wsp_ggml_type & type) {
+    for (int i = 0; i < WSP_GGML_TYPE_COUNT; i++) {
+        const wsp_ggml_type t = (wsp_ggml_type) i;
+        if (!is_writable(t)) {
+            continue;
+        }
+        const char * tname = wsp_ggml_type_name(t);
+        if (tname == nullptr || strlen(tname) != name.size()) {
+            continue;
+        }
+        bool same = true;
+        for (size_t j = 0; j < name.size(); j++) {
+            same = same && tolower((unsigned char) name[j]) == tolower((unsigned char) tname[j]);
+        }
+        if (same) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool quantize_rule_parse(const std::string & spec, quantize_rule & rule) {
+    const size_t eq = spec.rfind('=');
+    if (eq == std::string::npos || eq == 0) {
+        return false;
+    }
+    std::string type_name = spec.substr(eq + 1);
+    float max_rel_err = 0.0f;
+    const size_t at = type_name.find('@');
+    if (at != std::string::npos) {
+        char * end = nullptr;
+        max_rel_err = strtof(type_name.c_str() + at + 1, &end);
+        if (end == type_name.c_str() + at + 1 || *end != '\0' || max_rel_err < 0.0f) {
+            return false;
+        }
+        type_name.resize(at);
+    }
+    if (!quantize_type_from_name(type_name, rule.type)) {
+        return false;
+    }
+    rule.pattern = spec.substr(0, eq);
+    rule.max_rel_err = max_rel_err;
+    return true;
+}
+
+bool quantize_policy_preset(const std::string & name, quantize_policy & policy) {
+    if (name == "mixed") {
+        policy.default_type = WSP_GGML_TYPE_Q5_0;
+        policy.max_rel_err = 0.0f;
+        policy.rules = {
+            { "decoder\\.token_embedding\\.weight",                   WSP_GGML_TYPE_Q8_0 },
+            { "decoder\\.blocks\\.[0-9]+\\.cross_attn\\.[a-z]+\\.weight", WSP_GGML_TYPE_Q8_0 },
+            { "encoder\\.blocks\\.[0-9]+\\.mlp\\.[0-9]+\\.weight",       WSP_GGML_TYPE_Q4_K, 0.06f },
+            { "encoder\\.conv[12]\\.weight",                          WSP_GGML_TYPE_F16 },
+        };
+        return true;
+    }
+    if (name == "mobile") {
+        policy.default_type = WSP_GGML_TYPE_Q4_K;
+        policy.max_rel_err = 0.08f;
+        policy.rules = {
+            { "decoder\\.token_embedding\\.weight",                   WSP_GGML_TYPE_Q5_K },
+            { "decoder\\.blocks\\.[0-9]+\\.cross_attn\\.[a-z]+\\.weight", WSP_GGML_TYPE_Q5_K },
+            { "encoder\\.conv[12]\\.weight",                          WSP_GGML_TYPE_F16 },
+        };
+        return true;
+    }
+    return false;
+}
+
+// relative RMS error of data stored as type
+static float quantize_error(const std::vector<float> & data, const std::vector<uint8_t> & q, wsp_ggml_type type) {
+    std::vector<float> deq(data.size());
+    if (type == WSP_GGML_TYPE_F16) {
+        wsp_ggml_fp16_to_fp32_row((const wsp_ggml_fp16_t *) q.data(), deq.data(), (int) data.size());
+    } else {
+        wsp_ggml_internal_get_type_traits(type).to_float(q.data(), deq.data(), (int) data.size());
+    }
+    double err = 0.0;
+    double ref = 0.0;
+    for (size_t i = 0; i < data.size(); i++) {
+        const double d = (double) data[i] - (double) deq[i];
+        err += d*d;
+        ref += (double) data[i]*data[i];
+    }
+    return ref > 0.0 ? (float) sqrt(err/ref) : 0.0f;
+}
+
+static void quantize_data(const std::vector<float> & data, wsp_ggml_type type, std::vector<uint8_t> & out) {
+    const int n = (int) data.size();
+    out.resize((size_t) n/wsp_ggml_blck_size(type)*wsp_ggml_type_size(type));
+    if (type == WSP_GGML_TYPE_F32) {
+        memcpy(out.data(), data.data(), out.size());
+    } else if (type == WSP_GGML_TYPE_F16) {
+        wsp_ggml_fp32_to_fp16_row(data.data(), (wsp_ggml_fp16_t *) out.data(), n);
+    } else {
+        std::vector<int64_t> hist(1 << 4, 0);
+        wsp_ggml_wsp_quantize_chunk(type, data.data(), out.data(), 0, n, hist.data());
+    }
+}
+
+// type of a tensor according to the policy, max_rel_err of the matching rule
+static wsp_ggml_type policy_type(const quantize_policy & policy, const std::vector<std::regex> & patterns,
+                                 const std::string & name, float & max_rel_err) {
+    for (size_t i = 0; i < policy.rules.size(); i++) {
+        if (std::regex_match(name, patterns[i])) {
+            max_rel_err = policy.rules[i].max_rel_err;
+            return policy.rules[i].type;
+        }
+    }
+    max_rel_err = policy.max_rel_err;
+    return policy.default_type;
+}
+
+template <typename T>
+static bool read_value(std::ifstream & fin, T & value) {
+    fin.read((char *) &value, sizeof(value));
+    return !fin.fail();
+}
+
+template <typename T>
+static void write_value(std::ofstream & fout, const T & value) {
+    fout.write((const char *) &value, sizeof(value));
+}
+
+static bool read_tensor_header(std::ifstream & fin, tensor_header & header) {
+    int32_t length;
+    if (!read_value(fin, header.n_dims) || !read_value(fin, length) || !read_value(fin, header.ttype)) {
+        return false;
+    }
+    if (header.n_dims < 1 || header.n_dims > 4 || length <= 0 || header.ttype < 0 || header.ttype >= WSP_GGML_TYPE_COUNT) {
+        fin.setstate(std::ios::failbit);
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        header.ne[i] = 1;
+    }
+    for (int i = 0; i < header.n_dims; i++) {
+        read_value(fin, header.ne[i]);
+    }
+    header.name.resize(length);
+    fin.read(&header.name[0], length);
+    return !fin.fail();
+}
+
+static size_t tensor_nbytes(const tensor_header & header, wsp_ggml_type type) {
+    size_t n = 1;
+    for (int i = 0; i < 4; i++) {
+        n *= header.ne[i];
+    }
+    return n/wsp_ggml_blck_size(type)*wsp_ggml_type_size(type);
+}
+
+// copies the model of fin to fout with the tensors quantized by the policy
+static bool write_quantized(std::ifstream & fin, std::ofstream & fout, const std::string & fname_inp,
+                            const quantize_policy & policy, const std::vector<std::regex> & patterns,
+                            std::vector<quantize_tensor_info> * info) {
+    // magic and hparams: n_vocab, n_audio_ctx, n_audio_state, n_audio_head, n_audio_layer,
+    // n_text_ctx, n_text_state, n_text_head, n_text_layer, n_mels, ftype
+    uint32_t magic = 0;
+    int32_t hparams[11];
+    read_value(fin, magic);
+    fin.read((char *) hparams, sizeof(hparams));
+    if (fin.fail() || magic != WSP_GGML_FILE_MAGIC) {
+        RNWHISPER_LOG_ERROR("%s: '%s' is not a whisper model\n", __func__, fname_inp.c_str());
+        return false;
+    }
+
+    const int32_t ftype_inp = hparams[10] % WSP_GGML_QNT_VERSION_FACTOR;
+    if (ftype_inp != WSP_GGML_FTYPE_ALL_F32 && ftype_inp != WSP_GGML_FTYPE_MOSTLY_F16) {
+        RNWHISPER_LOG_ERROR("%s: the input model must be F32 or F16 (ftype %d)\n", __func__, ftype_inp);
+        return false;
+    }
+
+    // mel filters and vocab are copied as they are
+    std::vector<char> filters_vocab;
+    {
+        int32_t n_mel = 0;
+        int32_t n_fft = 0;
+        read_value(fin, n_mel);
+        read_value(fin, n_fft);
+        fin.seekg((std::streamoff) n_mel*n_fft*sizeof(float), std::ios::cur);
+
+        int32_t n_vocab = 0;
+        read_value(fin, n_vocab);
+        for (int32_t i = 0; i < n_vocab && fin; i++) {
+            uint32_t len = 0;
+            read_value(fin, len);
+            fin.seekg(len, std::ios::cur);
+        }
+        if (fin.fail()) {
+            RNWHISPER_LOG_ERROR("%s: failed to read the mel filters and vocab\n", __func__);
+            return false;
+        }
+
+        const std::streampos end = fin.tellg();
+        const std::streampos beg = (std::streamoff) (sizeof(magic) + sizeof(hparams));
+        filters_vocab.resize((size_t) (end - beg));
+        fin.seekg(beg);
+        fin.read(filters_vocab.data(), filters_vocab.size());
+    }
+
+    // tensor headers, to write the type table before the tensors
+    const std::streampos tensors_pos = fin.tellg();
+    std::vector<tensor_header> headers;
+    while (true) {
+        tensor_header header;
+        if (!read_tensor_header(fin, header)) {
+            break;
+        }
+        fin.seekg((std::streamoff) tensor_nbytes(header, (wsp_ggml_type) header.ttype), std::ios::cur);
+        headers.push_back(header);
+    }
+    if (!fin.eof() || headers.empty()) {
+        RNWHISPER_LOG_ERROR("%s: failed to read the tensors of '%s'\n", __func__, fname_inp.c_str());
+        return false;
+    }
+
+    hparams[10] = WSP_GGML_QNT_VERSION*WSP_GGML_QNT_VERSION_FACTOR + (type_to_ftype(policy.default_type) | WHISPER_FTYPE_MIXED);
+
+    write_value(fout, magic);
+    fout.write((const char *) hparams, sizeof(hparams));
+
+    // every tensor is in the table, its type is written once it is quantized
+    write_value(fout, (int32_t) headers.size());
+    for (auto & header : headers) {
+        write_value(fout, (int32_t) header.name.size());
+        fout.write(header.name.data(), header.name.size());
+        header.type_pos = fout.tellp();
+        write_value(fout, header.ttype);
+    }
+
+    fout.write(filters_vocab.data(), filters_vocab.size());
+
+    fin.clear();
+    fin.seekg(tensors_pos);
+
+    std::vector<char> raw;
+    std::vector<float> data;
+    std::vector<uint8_t> out;
+
+    size_t total_in = 0;
+    size_t total_out = 0;
+
+    for (auto & header : headers) {
+        tensor_header h;
+        if (!read_tensor_header(fin, h) || h.name != header.name) {
+            RNWHISPER_LOG_ERROR("%s: failed to read tensor '%s'\n", __func__, header.name.c_str());
+            return false;
+        }
+
+        const wsp_ggml_type type_in = (wsp_ggml_type) h.ttype;
+        raw.resize(tensor_nbytes(h, type_in));
+        fin.read(raw.data(), raw.size());
+        if (fin.fail()) {
+            RNWHISPER_LOG_ERROR("%s: failed to read tensor '%s'\n", __func__, h.name.c_str());
+            return false;
+        }
+
+        const bool is_weight = h.name.size() > 7 && h.name.compare(h.name.size() - 7, 7, ".weight") == 0;
+        const bool is_float  = type_in == WSP_GGML_TYPE_F32 || type_in == WSP_GGML_TYPE_F16;
+
+        wsp_ggml_type type_out = type_in;
+        float max_rel_err = 0.0f;
+        float rel_err = 0.0f;
+
+        if (is_weight && is_float && h.n_dims == 2) {
+            type_out = policy_type(policy, patterns, h.name, max_rel_err);
+            while (h.ne[0] % wsp_ggml_blck_size(type_out) != 0) {
+                type_out = fallback_type(type_out);
+            }
+        } else if (is_weight && is_float && h.n_dims == 3) {
+            // conv: only F16 and F32 kernels
+            type_out = policy_type(policy, patterns, h.name, max_rel_err);
+            if (type_out != WSP_GGML_TYPE_F32 && type_out != WSP_GGML_TYPE_F16) {
+                RNWHISPER_LOG_WARN("%s: '%s' cannot be %s, using f16\n", __func__, h.name.c_str(), wsp_ggml_type_name(type_out));
+                type_out = WSP_GGML_TYPE_F16;
+            }
+            max_rel_err = 0.0f;
+        }
+
+        if (type_out == type_in) {
+            out.assign(raw.begin(), raw.end());
+        } else {
+            const size_t n = raw.size()/wsp_ggml_type_size(type_in);
+            data.resize(n);
+            if (type_in == WSP_GGML_TYPE_F16) {
+                wsp_ggml_fp16_to_fp32_row((const wsp_ggml_fp16_t *) raw.data(), data.data(), (int) n);
+            } else {
+                memcpy(data.data(), raw.data(), raw.size());
+            }
+
+            quantize_data(data, type_out, out);
+            if (type_out != WSP_GGML_TYPE_F32) {
+                rel_err = quantize_error(data, out, type_out);
+            }
+
+            // importance: more precision while the error is too large
+            while (max_rel_err > 0.0f && rel_err > max_rel_err && promote_type(type_out) != type_out) {
+                type_out = promote_type(type_out);
+                if (type_out == type_in) {
+                    out.assign(raw.begin(), raw.end());
+                    rel_err = 0.0f;
+                    break;
+                }
+                quantize_data(data, type_out, out);
+                rel_err = quantize_error(data, out, type_out);
+            }
+        }
+
+        const int32_t ttype = type_out;
+        write_value(fout, h.n_dims);
+        write_value(fout, (int32_t) h.name.size());
+        write_value(fout, ttype);
+        for (int i = 0; i < h.n_dims; i++) {
+            write_value(fout, h.ne[i]);
+        }
+        fout.write(h.name.data(), h.name.size());
+        fout.write((const char *) out.data(), out.size());
+
+        header.ttype = ttype;
+
+        total_in  += raw.size();
+        total_out += out.size();
+
+        if (info) {
+            info->push_back({ h.name, type_in, type_out, raw.size(), out.size(), rel_err });
+        }
+    }
+
+    // types of the table
+    for (const auto & header : headers) {
+        fout.seekp(header.type_pos);
+        write_value(fout, header.ttype);
+    }
+
+    RNWHISPER_LOG_INFO("%s: %zu tensors, %.2f MB -> %.2f MB\n", __func__, headers.size(), total_in/1e6, total_out/1e6);
+
+    return true;
+}
+
+bool quantize_model(const std::string & fname_inp, const std::string & fname_out,
+                    const quantize_policy & policy, std::vector<quantize_tensor_info> * info) {
+    if (!is_writable(policy.default_type)) {
+        RNWHISPER_LOG_ERROR("%s: bad default type %d\n", __func__, policy.default_type);
+        return false;
+    }
+
+    std::vector<std::regex> patterns;
+    for (const auto & rule : policy.rules) {
+        if (!is_writable(rule.type)) {
+            RNWHISPER_LOG_ERROR("%s: bad type %d for '%s'\n", __func__, rule.type, rule.pattern.c_str());
+            return false;
+        }
+        try {
+            patterns.emplace_back(rule.pattern);
+        } catch (const std::regex_error &) {
+            RNWHISPER_LOG_ERROR("%s: bad pattern '%s'\n", __func__, rule.pattern.c_str());
+            return false;
+        }
+    }
+
+    // the F16 conversions need the tables of ggml
+    {
+        struct wsp_ggml_init_params params = { 0, NULL, false };
+        struct wsp_ggml_context * ctx = wsp_ggml_init(params);
+        if (ctx == NULL) {
+            RNWHISPER_LOG_ERROR("%s: failed to initialize ggml\n", __func__);
+            return false;
+        }
+        wsp_ggml_free(ctx);
+    }
+
+    std::ifstream fin(fname_inp, std::ios::binary);
+    if (!fin) {
+        RNWHISPER_LOG_ERROR("%s: failed to open '%s' for reading\n", __func__, fname_inp.c_str());
+        return false;
+    }
+
+    // written next to the output and renamed on success, so a failure never leaves a truncated model behind
+    const std::string fname_tmp = fname_out + ".tmp";
+    std::ofstream fout(fname_tmp, std::ios::binary);
+    if (!fout) {
+        RNWHISPER_LOG_ERROR("%s: failed to open '%s' for writing\n", __func__, fname_tmp.c_str());
+        return false;
+    }
+
+    bool ok = write_quantized(fin, fout, fname_inp, policy, patterns, info);
+
+    fout.close();
+    if (ok && fout.fail()) {
+        RNWHISPER_LOG_ERROR("%s: failed to write '%s'\n", __func__, fname_tmp.c_str());
+        ok = false;
+    }
+    if (ok && std::rename(fname_tmp.c_str(), fname_out.c_str()) != 0) {
+        RNWHISPER_LOG_ERROR("%s: failed to rename '%s' to '%s'\n", __func__, fname_tmp.c_str(), fname_out.c_str());
+        ok = false;
+    }
+    if (!ok) {
+        std::remove(fname_tmp.c_str());
+    }
+
+    return ok;
+}
+
+} // namespace rnwhisper
@@ -0,0 +1,58 @@
+#ifndef RNWHISPER_QUANTIZE_H
+#define RNWHISPER_QUANTIZE_H
+
+#include <string>
+#include <vector>
+#include "ggml.h"
+
+namespace rnwhisper {
+
+// Type of the tensors whose name fully matches pattern (ECMAScript regex).
+// With max_rel_err > 0 the type is promoted (Q4_K -> Q5_K -> Q6_K -> Q8_0 -> F16, ...) while the
+// relative RMS error of the quantized weights is above it, so the sensitive tensors keep more precision.
+struct quantize_rule {
+    std::string pattern;
+    wsp_ggml_type type;
+    float max_rel_err;
+
+    quantize_rule() : type(WSP_GGML_TYPE_F16), max_rel_err(0.0f) {}
+    quantize_rule(const std::string & pattern, wsp_ggml_type type, float max_rel_err = 0.0f)
+        : pattern(pattern), type(type), max_rel_err(max_rel_err) {}
+};
+
+// Per-tensor policy: the first matching rule decides, the 2D weights matching no rule get default_type.
+// 1D tensors, biases and positional embeddings are always copied, 3D (conv) weights can only be F16 or F32.
+struct quantize_policy {
+    wsp_ggml_type default_type = WSP_GGML_TYPE_Q8_0;
+    float max_rel_err = 0.0f; // for default_type
+    std::vector<quantize_rule> rules;
+};
+
+struct quantize_tensor_info {
+    std::string name;
+    wsp_ggml_type type_in;
+    wsp_ggml_type type_out;
+    size_t size_in;
+    size_t size_out;
+    float rel_err; // relative RMS error of the stored weights, 0 when copied
+};
+
+// Policy of a named preset, false if the name is unknown:
+// "mixed"   Q8_0 token embedding and cross-attention, Q4_K encoder FFN (promoted above 6% error), F16 conv stem, Q5_0 elsewhere
+// "mobile"  Q5_K token embedding and cross-attention, Q4_K elsewhere (promoted above 8% error), F16 conv stem
+bool quantize_policy_preset(const std::string & name, quantize_policy & policy);
+
+// "q4_0", "Q5_K", "f16", ... -> type, false if the name is unknown or the type cannot be written
+bool quantize_type_from_name(const std::string & name, wsp_ggml_type & type);
+
+// "pattern=type" or "pattern=type@max_rel_err", false on syntax errors
+bool quantize_rule_parse(const std::string & spec, quantize_rule & rule);
+
+// Read an F32/F16 whisper model and write a mixed precision one (WHISPER_FTYPE_MIXED),
+// info gets one entry per tensor if not NULL, fname_out is only replaced once the whole model is written
+bool quantize_model(const std::string & fname_inp, const std::string & fname_out,
+                    const quantize_policy & policy, std::vector<quantize_tensor_info> * info = nullptr);
+
+} // namespace rnwhisper
+
+#endif // RNWHISPER_QUANTIZE_H
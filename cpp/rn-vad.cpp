@@ -0,0 +1,264 @@
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "rn-vad.h"
+#include "rn-whisper-log.h"
+
+namespace rnwhisper {
+
+bool vad_detector::process(const short * pcm, int index, int n, bool final) {
+    if (slice_index != index || n_samples > n) {
+        slice_index = index;
+        n_samples = 0;
+        segments.clear();
+        reset();
+    }
+
+    // feed the samples not seen yet (also catches up the ones received while transcribing)
+    if (n > n_samples) {
+        feed(pcm + n_samples, n - n_samples);
+        n_samples = n;
+    }
+
+    return detect(final);
+}
+
+void vad_detector::add_segment(int start, int end) {
+    if ((int) segments.size() == max_segments) {
+        segments.erase(segments.begin());
+    }
+    segments.push_back({ start, end });
+}
+
+vad_energy::vad_energy(const vad_params & params, int sample_rate) : params(params) {
+    // at least one sample each, vad_ms = 0 would divide by zero in feed()
+    n_window = std::max(1, (sample_rate * params.vad_ms) / 1000);
+    n_last = std::max(1, (sample_rate * params.last_ms) / 1000);
+
+    if (params.freq_thold > 0.0f) {
+        const float rc = 1.0f / (2.0f * M_PI * params.freq_thold);
+        const float dt = 1.0f / sample_rate;
+        hp_alpha = rc / (rc + dt);
+    }
+
+    // allocated once here, so the audio callback never allocates
+    energy.assign(n_window, 0.0f);
+    reset();
+}
+
+void vad_energy::reset() {
+    hp_x = 0.0f;
+    hp_y = 0.0f;
+    energy_all = 0.0;
+    energy_last = 0.0;
+}
+
+void vad_energy::feed(const short * pcm, int n) {
+    for (int i = 0; i < n; i++) {
+        const int idx = n_samples + i;
+        const float x = (float)pcm[i] / 32768.0f;
+
+        // running high-pass filter, the first sample of the slice passes through
+        float y = x;
+        if (hp_alpha > 0.0f && idx > 0) {
+            y = hp_alpha * (hp_y + x - hp_x);
+        }
+        hp_x = x;
+        hp_y = y;
+
+        const float e = fabsf(y);
+        const int pos = idx % n_window;
+
+        if (idx >= n_window) {
+            energy_all -= energy[pos];
+        }
+        if (n_last < n_window && idx >= n_last) {
+            energy_last -= energy[(idx - n_last) % n_window];
+        }
+
+        energy[pos] = e;
+        energy_all += e;
+        energy_last += e;
+
+        // recompute the sums once per window to drop the accumulated rounding error (O(1) amortized)
+        if ((idx + 1) % n_window == 0) {
+            energy_all = 0.0;
+            energy_last = 0.0;
+            for (int j = 0; j < n_window; j++) {
+                energy_all += energy[j];
+            }
+            for (int j = idx + 1 - std::min(n_last, n_window); j <= idx; j++) {
+                energy_last += energy[j % n_window];
+            }
+        }
+    }
+}
+
+bool vad_energy::detect(bool) {
+    if (n_samples <= n_window || n_last >= n_window) {
+        // not enough samples - assume no speech
+        return false;
+    }
+
+    const float e_all = energy_all / n_window;
+    const float e_last = energy_last / n_last;
+
+    if (params.verbose) {
+        RNWHISPER_LOG_INFO("%s: energy_all: %f, energy_last: %f, vad_thold: %f, freq_thold: %f\n", __func__, e_all, e_last, params.vad_thold, params.freq_thold);
+    }
+
+    if (e_last > params.vad_thold * e_all) {
+        return false;
+    }
+
+    return true;
+}
+
+// speech band
+static const float SPECTRAL_BAND_LOW_HZ = 300.0f;
+static const float SPECTRAL_BAND_HIGH_HZ = 3400.0f;
+// minimum speech band power of a speech frame (~ -70 dBFS)
+static const float SPECTRAL_MIN_ENERGY = 1e-7f;
+// speech band power over the noise floor of a speech frame (~ 6 dB)
+static const float SPECTRAL_SNR = 4.0f;
+// above this zero-crossing rate the frame is noise-like and needs twice the SNR
+static const float SPECTRAL_ZCR_NOISY = 0.25f;
+static const int SPECTRAL_ONSET_MS = 30;
+
+vad_spectral::vad_spectral(const vad_params & params, int sample_rate) : params(params) {
+    n_frame = sample_rate / 100;
+    n_onset = std::max(1, SPECTRAL_ONSET_MS * sample_rate / 1000 / n_frame);
+    n_hangover = std::max(1, params.last_ms * sample_rate / 1000 / n_frame);
+
+    const float dt = 1.0f / sample_rate;
+    const float rc_hp = 1.0f / (2.0f * M_PI * SPECTRAL_BAND_LOW_HZ);
+    const float rc_lp = 1.0f / (2.0f * M_PI * SPECTRAL_BAND_HIGH_HZ);
+    hp_alpha = rc_hp / (rc_hp + dt);
+    lp_alpha = dt / (rc_lp + dt);
+
+    reset();
+}
+
+void vad_spectral::reset() {
+    hp_x = 0.0f;
+    hp_y = 0.0f;
+    lp_y = 0.0f;
+
+    frame_pos = 0;
+    frame_band = 0.0;
+    frame_zc = 0;
+    frame_prev = 0.0f;
+
+    // the noise floor is kept across slices
+    in_speech = false;
+    n_speech = 0;
+    n_silence = 0;
+    speech_start = 0;
+    speech_end = 0;
+    pending = false;
+}
+
+bool vad_spectral::classify_frame() {
+    const float e_band = frame_band / n_frame;
+    const float zcr = (float)frame_zc / n_frame;
+
+    if (noise < 0.0f) {
+        noise = std::max(e_band, SPECTRAL_MIN_ENERGY);
+    }
+
+    const float snr = zcr > SPECTRAL_ZCR_NOISY ? 2.0f * SPECTRAL_SNR : SPECTRAL_SNR;
+    const bool is_speech =
+        e_band > SPECTRAL_MIN_ENERGY &&
+        e_band > snr * noise;
+
+    // noise floor: follows quieter frames fast, non-speech frames in ~0.5s, and creeps up during speech
+    if (e_band < noise) {
+        noise += 0.2f * (e_band - noise);
+    } else if (!is_speech) {
+        noise += 0.02f * (e_band - noise);
+    } else {
+        noise *= 1.001f;
+    }
+    noise = std::max(noise, SPECTRAL_MIN_ENERGY);
+
+    return is_speech;
+}
+
+void vad_spectral::on_frame(int frame_end) {
+    if (classify_frame()) {
+        n_speech++;
+        n_silence = 0;
+        if (!in_speech && n_speech >= n_onset) {
+            in_speech = true;
+            speech_start = std::max(0, frame_end - n_speech * n_frame);
+        }
+        if (in_speech) {
+            speech_end = frame_end;
+        }
+    } else {
+        n_speech = 0;
+        if (in_speech && ++n_silence >= n_hangover) {
+            in_speech = false;
+            n_silence = 0;
+            add_segment(speech_start, speech_end);
+            pending = true;
+        }
+    }
+}
+
+void vad_spectral::feed(const short * pcm, int n) {
+    for (int i = 0; i < n; i++) {
+        const float x = (float)pcm[i] / 32768.0f;
+
+        // one-pole high-pass + low-pass = speech band
+        float y = 0.0f;
+        if (n_samples + i > 0) {
+            y = hp_alpha * (hp_y + x - hp_x);
+        }
+        hp_x = x;
+        hp_y = y;
+        lp_y += lp_alpha * (y - lp_y);
+
+        const float b = lp_y;
+        frame_band += b * b;
+        if ((b >= 0.0f) != (frame_prev >= 0.0f)) {
+            frame_zc++;
+        }
+        frame_prev = b;
+
+        if (++frame_pos == n_frame) {
+            on_frame(n_samples + i + 1);
+            frame_pos = 0;
+            frame_band = 0.0;
+            frame_zc = 0;
+        }
+    }
+}
+
+bool vad_spectral::detect(bool final) {
+    if (final && in_speech) {
+        // no more audio for the slice, close the running segment
+        in_speech = false;
+        n_silence = 0;
+        add_segment(speech_start, speech_end);
+        pending = true;
+    }
+
+    if (params.verbose) {
+        RNWHISPER_LOG_INFO("%s: noise: %e, in_speech: %d, segments: %d, pending: %d\n", __func__, noise, in_speech, (int) segments.size(), pending);
+    }
+
+    // report each closed segment once
+    const bool ret = pending;
+    pending = false;
+    return ret;
+}
+
+vad_detector * vad_new(const vad_params & params, int sample_rate) {
+    if (params.mode == VAD_MODE_SPECTRAL) {
+        return new vad_spectral(params, sample_rate);
+    }
+    return new vad_energy(params, sample_rate);
+}
+
+} // namespace rnwhisper
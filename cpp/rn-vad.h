@@ -0,0 +1,131 @@
+#ifndef RNWHISPER_VAD_H
+#define RNWHISPER_VAD_H
+
+#include <vector>
+#include <cstdint>
+
+namespace rnwhisper {
+
+enum vad_mode {
+    VAD_MODE_ENERGY = 0,   // last_ms energy compared with the whole vad_ms window
+    VAD_MODE_SPECTRAL = 1, // speech band energy + zero-crossing rate + hangover
+};
+
+struct vad_params {
+    bool use_vad = false;
+    float vad_thold = 0.6f;
+    float freq_thold = 100.0f;
+    int vad_ms = 2000;
+    int last_ms = 1000;
+    bool verbose = false;
+    int mode = VAD_MODE_ENERGY;
+};
+
+// Speech segment of a slice, in samples from the start of the slice
+struct vad_segment {
+    int start;
+    int end;
+};
+
+// Voice activity detector fed with the PCM of the realtime slices.
+// Implementations only see the new samples of each call and must not allocate in feed().
+class vad_detector {
+public:
+    virtual ~vad_detector() {}
+
+    // Feed the samples of the slice up to n_samples (only the ones not seen yet are processed)
+    // and return true if the slice should be transcribed now.
+    // final = true when no more audio will come for the slice.
+    bool process(const short * pcm, int slice_index, int n_samples, bool final);
+
+    // Speech segments detected in the current slice, the last max_segments ones
+    // (empty if the detector doesn't emit segments)
+    const std::vector<vad_segment> & get_segments() const { return segments; }
+    int get_slice_index() const { return slice_index; }
+
+    static const int max_segments = 64;
+
+protected:
+    int slice_index = -1;
+    int n_samples = 0; // samples of the slice fed so far
+    std::vector<vad_segment> segments;
+
+    vad_detector() { segments.reserve(max_segments); }
+    // append a segment without allocating, dropping the oldest one when full
+    void add_segment(int start, int end);
+
+    virtual void reset() = 0;
+    virtual void feed(const short * pcm, int n) = 0;
+    virtual bool detect(bool final) = 0;
+};
+
+// Energy of the last last_ms compared with the whole vad_ms window, with running sums
+class vad_energy : public vad_detector {
+public:
+    vad_energy(const vad_params & params, int sample_rate);
+
+protected:
+    void reset() override;
+    void feed(const short * pcm, int n) override;
+    bool detect(bool final) override;
+
+private:
+    vad_params params;
+    int n_window = 0;           // samples in vad_ms
+    int n_last = 0;             // samples in last_ms
+    float hp_alpha = 0.0f;      // high-pass filter coefficient (0 = disabled)
+    float hp_x = 0.0f;          // last input of the high-pass filter
+    float hp_y = 0.0f;          // last output of the high-pass filter
+    double energy_all = 0.0;    // sum of the energy of the last n_window samples
+    double energy_last = 0.0;   // sum of the energy of the last n_last samples
+    std::vector<float> energy;  // ring buffer of the energy of the last n_window samples
+};
+
+// 10 ms frames classified on the 300-3400 Hz band (energy over an adaptive noise floor,
+// stricter for noise-like zero-crossing rates) with an onset / hangover state machine.
+// A segment is closed after last_ms without speech, which triggers the transcription once.
+class vad_spectral : public vad_detector {
+public:
+    vad_spectral(const vad_params & params, int sample_rate);
+
+protected:
+    void reset() override;
+    void feed(const short * pcm, int n) override;
+    bool detect(bool final) override;
+
+private:
+    vad_params params;
+    int n_frame = 0;            // samples per frame (10 ms)
+    int n_onset = 0;            // speech frames needed to open a segment
+    int n_hangover = 0;         // non-speech frames needed to close a segment
+
+    // band filters state
+    float hp_alpha = 0.0f;
+    float lp_alpha = 0.0f;
+    float hp_x = 0.0f;
+    float hp_y = 0.0f;
+    float lp_y = 0.0f;
+
+    // current frame accumulators
+    int frame_pos = 0;
+    double frame_band = 0.0;    // speech band energy
+    int frame_zc = 0;           // zero crossings of the speech band
+    float frame_prev = 0.0f;
+
+    float noise = -1.0f;        // speech band noise floor (< 0 = not initialized)
+    bool in_speech = false;
+    int n_speech = 0;           // consecutive speech frames
+    int n_silence = 0;          // consecutive non-speech frames while in speech
+    int speech_start = 0;
+    int speech_end = 0;
+    bool pending = false;       // a segment was closed and not reported yet
+
+    bool classify_frame();
+    void on_frame(int frame_end);
+};
+
+vad_detector * vad_new(const vad_params & params, int sample_rate);
+
+} // namespace rnwhisper
+
+#endif // RNWHISPER_VAD_H
@@ -1,4 +1,6 @@
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -8,57 +10,6 @@
 
 namespace rnwhisper {
 
-void high_pass_filter(std::vector<float> & data, float cutoff, float sample_rate) {
-    const float rc = 1.0f / (2.0f * M_PI * cutoff);
-    const float dt = 1.0f / sample_rate;
-    const float alpha = dt / (rc + dt);
-
-    float y = data[0];
-
-    for (size_t i = 1; i < data.size(); i++) {
-        y = alpha * (y + data[i] - data[i - 1]);
-        data[i] = y;
-    }
-}
-
-bool vad_simple_impl(std::vector<float> & pcmf32, int sample_rate, int last_ms, float vad_thold, float freq_thold, bool verbose) {
-    const int n_samples      = pcmf32.size();
-    const int n_samples_last = (sample_rate * last_ms) / 1000;
-
-    if (n_samples_last >= n_samples) {
-        // not enough samples - assume no speech
-        return false;
-    }
-
-    if (freq_thold > 0.0f) {
-        high_pass_filter(pcmf32, freq_thold, sample_rate);
-    }
-
-    float energy_all  = 0.0f;
-    float energy_last = 0.0f;
-
-    for (int i = 0; i < n_samples; i++) {
-        energy_all += fabsf(pcmf32[i]);
-
-        if (i >= n_samples - n_samples_last) {
-        energy_last += fabsf(pcmf32[i]);
-        }
-    }
-
-    energy_all  /= n_samples;
-    energy_last /= n_samples_last;
-
-    if (verbose) {
-        RNWHISPER_LOG_INFO("%s: energy_all: %f, energy_last: %f, vad_thold: %f, freq_thold: %f\n", __func__, energy_all, energy_last, vad_thold, freq_thold);
-    }
-
-    if (energy_last > vad_thold*energy_all) {
-        return false;
-    }
-
-    return true;
-}
-
 void job::set_realtime_params(
     vad_params params,
     int sec,
@@ -72,22 +23,31 @@ void job::set_realtime_params(
     audio_slice_sec = slice_sec > 0 && slice_sec < audio_sec ? slice_sec : audio_sec;
     audio_min_sec = min_sec >= 0.5 && min_sec <= audio_slice_sec ? min_sec : 1.0f;
     audio_output_path = output_path;
+    if (vad_instance != nullptr) delete vad_instance;
+    vad_instance = vad_new(vad, WHISPER_SAMPLE_RATE);
+}
+
+void job::set_hotwords(const std::vector<std::string> & words, float boost) {
+    hotwords = words;
+    hotword_ptrs.clear();
+    for (size_t i = 0; i < hotwords.size(); i++) {
+        hotword_ptrs.push_back(hotwords[i].c_str());
+    }
+    params.hotwords = hotword_ptrs.data();
+    params.n_hotwords = (int) hotword_ptrs.size();
+    params.hotword_boost = boost;
 }
 
-bool job::vad_simple(int slice_index, int n_samples, int n) {
-    if (!vad.use_vad) return true;
+bool job::vad_detect(int slice_index, int n_samples, int n) {
+    if (!vad.use_vad || vad_instance == nullptr) return true;
+    return vad_instance->process(pcm_slices[slice_index], slice_index, n_samples + n, n == 0);
+}
 
-    short* pcm = pcm_slices[slice_index];
-    int sample_size = (int) (WHISPER_SAMPLE_RATE * vad.vad_ms / 1000);
-    if (n_samples + n > sample_size) {
-        int start = n_samples + n - sample_size;
-        std::vector<float> pcmf32(sample_size);
-        for (int i = 0; i < sample_size; i++) {
-            pcmf32[i] = (float)pcm[i + start] / 32768.0f;
-        }
-        return vad_simple_impl(pcmf32, WHISPER_SAMPLE_RATE, vad.last_ms, vad.vad_thold, vad.freq_thold, vad.verbose);
+std::vector<vad_segment> job::vad_segments(int slice_index) {
+    if (!vad.use_vad || vad_instance == nullptr || vad_instance->get_slice_index() != slice_index) {
+        return std::vector<vad_segment>();
     }
-    return false;
+    return vad_instance->get_segments();
 }
 
 void job::put_pcm_data(short* data, int slice_index, int n_samples, int n) {
@@ -101,15 +61,151 @@ void job::put_pcm_data(short* data, int slice_index, int n_samples, int n) {
     }
 }
 
-float* job::pcm_slice_to_f32(int slice_index, int size) {
-    if (pcm_slices.size() > slice_index) {
-        float* pcmf32 = new float[size];
-        for (int i = 0; i < size; i++) {
-            pcmf32[i] = (float)pcm_slices[slice_index][i] / 32768.0f;
+void agreement_state::reset(int index) {
+    slice_index = index;
+    offset_ms = 0;
+    prompt.clear();
+    window.clear();
+    pending.clear();
+    committed.clear();
+    tentative.clear();
+}
+
+// number of bytes at the end of the text that are not a complete UTF-8 character
+static int utf8_incomplete_len(const std::string & text) {
+    const int n = (int) text.size();
+    for (int i = 1; i <= 4 && i <= n; i++) {
+        const unsigned char c = text[n - i];
+        if ((c & 0xC0) == 0x80) continue;
+        int len = 1;
+        if ((c & 0xE0) == 0xC0) len = 2;
+        else if ((c & 0xF0) == 0xE0) len = 3;
+        else if ((c & 0xF8) == 0xF0) len = 4;
+        return len > i ? i : 0;
+    }
+    return 0;
+}
+
+int job::full_realtime(struct whisper_context * ctx, int slice_index, int n_samples) {
+    if (!use_agreement) {
+        return whisper_full_s16(ctx, params, pcm_slices[slice_index], n_samples);
+    }
+
+    agreement_state & st = agreement;
+    if (st.slice_index != slice_index) {
+        st.reset(slice_index);
+        if (params.initial_prompt != nullptr) {
+            st.prompt.resize(whisper_n_text_ctx(ctx));
+            const int n = whisper_tokenize(ctx, params.initial_prompt, st.prompt.data(), st.prompt.size());
+            st.prompt.resize(n > 0 ? n : 0);
         }
-        return pcmf32;
     }
-    return nullptr;
+
+    // whisper_full only uses the last n_text_ctx/2 tokens of the prompt
+    const int n_prompt_max = whisper_n_text_ctx(ctx) / 2;
+    if ((int) st.prompt.size() > n_prompt_max) {
+        st.prompt.erase(st.prompt.begin(), st.prompt.end() - n_prompt_max);
+    }
+
+    whisper_full_params p = params;
+    p.offset_ms = st.offset_ms;
+    p.prompt_tokens = st.prompt.empty() ? nullptr : st.prompt.data();
+    p.prompt_n_tokens = (int) st.prompt.size();
+
+    const int code = whisper_full_s16(ctx, p, pcm_slices[slice_index], n_samples);
+    if (code != 0) return code;
+
+    // text tokens of the transcription and their segment
+    const whisper_token token_eot = whisper_token_eot(ctx);
+    const int n_segments = whisper_full_n_segments(ctx);
+    std::vector<whisper_token> tokens;
+    std::vector<int> token_segments;
+    for (int i = 0; i < n_segments; i++) {
+        const int n_tokens = whisper_full_n_tokens(ctx, i);
+        for (int j = 0; j < n_tokens; j++) {
+            const whisper_token id = whisper_full_get_token_id(ctx, i, j);
+            if (id < token_eot) {
+                tokens.push_back(id);
+                token_segments.push_back(i);
+            }
+        }
+    }
+
+    // the transcription starts with the committed tokens after offset_ms, they are kept as committed,
+    // the re-decode may merge or split them differently so they are matched on their text
+    size_t n_window = 0;
+    std::string text_window;
+    std::string text_tokens;
+    for (size_t i = 0; i < st.window.size(); i++) {
+        text_window += whisper_token_to_str(ctx, st.window[i]);
+    }
+    while (n_window < tokens.size() && text_tokens.size() < text_window.size()) {
+        text_tokens += whisper_token_to_str(ctx, tokens[n_window++]);
+    }
+    if (text_tokens != text_window) {
+        // the committed text was transcribed differently: the pending tokens are not compared with
+        // shifted tokens, and the window moves to the new tokens covering the committed text
+        st.pending.clear();
+        if (text_tokens.size() < text_window.size()) {
+            // shorter than the committed text, nothing to add to it
+            st.tentative.clear();
+            return code;
+        }
+        st.window.assign(tokens.begin(), tokens.begin() + n_window);
+    } else if (n_window != st.window.size()) {
+        st.window.assign(tokens.begin(), tokens.begin() + n_window);
+    }
+
+    // commit the prefix agreed with the previous transcription
+    size_t n_agreed = 0;
+    while (
+        n_window + n_agreed < tokens.size() &&
+        n_agreed < st.pending.size() &&
+        tokens[n_window + n_agreed] == st.pending[n_agreed]
+    ) {
+        n_agreed++;
+    }
+
+    std::string text;
+    for (size_t i = 0; i < n_agreed; i++) {
+        text += whisper_token_to_str(ctx, tokens[n_window + i]);
+    }
+    // a character split over tokens is committed with its last token
+    while (n_agreed > 0 && utf8_incomplete_len(text) > 0) {
+        text.resize(text.size() - strlen(whisper_token_to_str(ctx, tokens[n_window + n_agreed - 1])));
+        n_agreed--;
+    }
+
+    st.window.insert(st.window.end(), tokens.begin() + n_window, tokens.begin() + n_window + n_agreed);
+    st.committed += text;
+    st.pending.assign(tokens.begin() + n_window + n_agreed, tokens.end());
+    st.tentative.clear();
+    for (size_t i = 0; i < st.pending.size(); i++) {
+        st.tentative += whisper_token_to_str(ctx, st.pending[i]);
+    }
+    // the last pending token may end inside a character, it's shown once complete
+    st.tentative.resize(st.tentative.size() - utf8_incomplete_len(st.tentative));
+
+    // skip the audio of the segments with only committed tokens on the next transcription,
+    // the last segment may still grow
+    const size_t n_committed = n_window + n_agreed;
+    int i_segment = -1;
+    size_t n_skip = 0;
+    for (size_t i = 0; i < n_committed; i++) {
+        const int seg = token_segments[i];
+        if (seg == n_segments - 1) break;
+        if (i + 1 == tokens.size() || token_segments[i + 1] != seg) {
+            i_segment = seg;
+            n_skip = i + 1;
+        }
+    }
+    if (i_segment >= 0) {
+        st.offset_ms = (int) (whisper_full_get_segment_t1(ctx, i_segment) * 10);
+        st.prompt.insert(st.prompt.end(), st.window.begin(), st.window.begin() + n_skip);
+        st.window.erase(st.window.begin(), st.window.begin() + n_skip);
+    }
+
+    return code;
 }
 
 bool job::is_aborted() {
@@ -127,6 +223,90 @@ job::~job() {
         delete[] pcm_slices[i];
     }
     pcm_slices.clear();
+
+    if (vad_instance != nullptr) {
+        delete vad_instance;
+        vad_instance = nullptr;
+    }
+}
+
+template <typename T>
+static void put_value(std::vector<uint8_t> & out, T value) {
+    const size_t n = out.size();
+    out.resize(n + sizeof(T));
+    memcpy(out.data() + n, &value, sizeof(T));
+}
+
+static void put_text(std::vector<uint8_t> & out, const char * text) {
+    const int32_t len = (int32_t) strlen(text);
+    put_value(out, len);
+    out.insert(out.end(), text, text + len);
+}
+
+bool set_dtw_params(struct whisper_context_params & cparams, const char * preset, int n_top) {
+    static const struct {
+        const char * name;
+        whisper_alignment_heads_preset preset;
+    } presets[] = {
+        { "top-most",  WHISPER_AHEADS_N_TOP_MOST },
+        { "tiny.en",   WHISPER_AHEADS_TINY_EN },
+        { "tiny",      WHISPER_AHEADS_TINY },
+        { "base.en",   WHISPER_AHEADS_BASE_EN },
+        { "base",      WHISPER_AHEADS_BASE },
+        { "small.en",  WHISPER_AHEADS_SMALL_EN },
+        { "small",     WHISPER_AHEADS_SMALL },
+        { "medium.en", WHISPER_AHEADS_MEDIUM_EN },
+        { "medium",    WHISPER_AHEADS_MEDIUM },
+        { "large-v1",  WHISPER_AHEADS_LARGE_V1 },
+        { "large-v2",  WHISPER_AHEADS_LARGE_V2 },
+        { "large-v3",  WHISPER_AHEADS_LARGE_V3 },
+    };
+
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        if (strcmp(preset, presets[i].name) == 0) {
+            cparams.dtw_token_timestamps = true;
+            cparams.dtw_aheads_preset = presets[i].preset;
+            cparams.dtw_n_top = n_top;
+            return true;
+        }
+    }
+    RNWHISPER_LOG_WARN("rnwhisper::%s: unknown DTW preset '%s', DTW disabled\n", __func__, preset);
+    return false;
+}
+
+void serialize_segments(struct whisper_context * ctx, int i_start, int i_end, bool with_tokens, std::vector<uint8_t> & out) {
+    i_start = std::max(0, i_start);
+    i_end = std::min(i_end, whisper_full_n_segments(ctx));
+
+    out.clear();
+    put_value(out, (int32_t) std::max(0, i_end - i_start));
+
+    const whisper_token token_eot = whisper_token_eot(ctx);
+    for (int i = i_start; i < i_end; i++) {
+        put_value(out, (int64_t) whisper_full_get_segment_t0(ctx, i));
+        put_value(out, (int64_t) whisper_full_get_segment_t1(ctx, i));
+        put_text(out, whisper_full_get_segment_text(ctx, i));
+
+        // the token count is patched once the special tokens are skipped
+        const size_t pos_n_tokens = out.size();
+        put_value(out, (int32_t) 0);
+        if (!with_tokens) continue;
+
+        int32_t n_tokens = 0;
+        const int n = whisper_full_n_tokens(ctx, i);
+        for (int j = 0; j < n; j++) {
+            const whisper_token_data token = whisper_full_get_token_data(ctx, i, j);
+            if (token.id >= token_eot) continue;
+            put_value(out, (int32_t) token.id);
+            put_value(out, (float) token.p);
+            put_value(out, (int64_t) token.t0);
+            put_value(out, (int64_t) token.t1);
+            put_value(out, (int64_t) token.t_dtw);
+            put_text(out, whisper_token_to_str(ctx, token.id));
+            n_tokens++;
+        }
+        memcpy(out.data() + pos_n_tokens, &n_tokens, sizeof(n_tokens));
+    }
 }
 
 std::unordered_map<int, job*> job_map;
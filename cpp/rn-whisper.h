@@ -1,21 +1,29 @@
 #ifndef RNWHISPER_H
 #define RNWHISPER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "whisper.h"
 #include "rn-whisper-log.h"
 #include "rn-audioutils.h"
+#include "rn-vad.h"
 
 namespace rnwhisper {
 
-struct vad_params {
-    bool use_vad = false;
-    float vad_thold = 0.6f;
-    float freq_thold = 100.0f;
-    int vad_ms = 2000;
-    int last_ms = 1000;
-    bool verbose = false;
+// Local agreement of the realtime transcriptions of a slice:
+// the tokens that two consecutive transcriptions agree on are committed and never change,
+// the audio of the fully committed segments is not transcribed again and their text is fed back as prompt
+struct agreement_state {
+    int slice_index = -1;
+    int offset_ms = 0;                     // start of the audio still transcribed in the slice
+    std::vector<whisper_token> prompt;     // initial prompt + committed tokens before offset_ms
+    std::vector<whisper_token> window;     // committed tokens after offset_ms
+    std::vector<whisper_token> pending;    // tokens of the last transcription after the committed ones
+    std::string committed;                 // committed text of the slice
+    std::string tentative;                 // text after the committed one, may change on the next transcription
+
+    void reset(int slice_index);
 };
 
 struct job {
@@ -27,19 +35,50 @@ struct job {
     bool is_aborted();
     void abort();
 
+    // Hotwords, params.hotwords points to the strings owned by the job
+    std::vector<std::string> hotwords;
+    std::vector<const char*> hotword_ptrs;
+    void set_hotwords(const std::vector<std::string> & words, float boost);
+
+    // File transcription only:
+    // number of chunks transcribed concurrently by whisper_full_parallel (1 = sequential whisper_full)
+    int n_processors = 1;
+
     // Realtime transcription only:
     vad_params vad;
+    vad_detector* vad_instance = nullptr;
     int audio_sec = 0;
     int audio_slice_sec = 0;
     float audio_min_sec = 0;
     const char* audio_output_path = nullptr;
     std::vector<short *> pcm_slices;
+    bool use_agreement = false;
+    agreement_state agreement;
     void set_realtime_params(vad_params vad, int sec, int slice_sec, float min_sec, const char* output_path);
-    bool vad_simple(int slice_index, int n_samples, int n);
+    // transcribe the first n_samples of the slice, past the committed segments with use_agreement
+    int full_realtime(struct whisper_context * ctx, int slice_index, int n_samples);
+    // n = 0: no more audio for the slice
+    bool vad_detect(int slice_index, int n_samples, int n);
+    // speech segments of the slice detected by the VAD (empty without segments or for another slice),
+    // called while transcribing, when the bridges don't feed the detector
+    std::vector<vad_segment> vad_segments(int slice_index);
     void put_pcm_data(short* pcm, int slice_index, int n_samples, int n);
-    float* pcm_slice_to_f32(int slice_index, int size);
 };
 
+// Pack the segments [i_start, i_end) of the last transcription into one buffer, so the bridges
+// fetch them in a single call. Fields are in native byte order, times in 10 ms:
+//   int32 n_segments
+//   per segment: int64 t0, int64 t1, int32 text length, UTF-8 text, int32 n_tokens (0 without tokens)
+//   per token:   int32 id, float p, int64 t0, int64 t1, int64 t_dtw, int32 text length, UTF-8 text
+// The tokens are the text tokens of the segment (special tokens are skipped).
+void serialize_segments(struct whisper_context * ctx, int i_start, int i_end, bool with_tokens, std::vector<uint8_t> & out);
+
+// Enable the DTW token timestamps of the context params with the alignment heads of a model:
+// "tiny.en", "tiny", "base.en", "base", "small.en", "small", "medium.en", "medium", "large-v1", "large-v2",
+// "large-v3", or "top-most" for all heads of the n_top top-most text layers (n_top <= 0 - all).
+// false (and DTW left disabled) if the name is unknown.
+bool set_dtw_params(struct whisper_context_params & cparams, const char * preset, int n_top);
+
 void job_abort_all();
 job* job_new(int job_id, struct whisper_full_params params);
 void job_remove(int job_id);
@@ -30,11 +30,12 @@
 #include <cstring>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <thread>
 #include <vector>
-#include <regex>
 #include <random>
 #include <functional>
 
@@ -146,11 +147,13 @@ static void whisper_log_callback_default(wsp_ggml_log_level level, const char *
 #define WHISPER_PRINT_DEBUG(...)
 #endif
 
-//#define WHISPER_USE_FLASH_ATTN
 //#define WHISPER_USE_FLASH_FF
 #define WHISPER_MAX_DECODERS 8
 #define WHISPER_MAX_NODES 4096
 
+// max number of grammar stacks with a cached set of rejected tokens (~6.5 KB each)
+#define WHISPER_GRAMMAR_CACHE_MAX 1024
+
 //
 // ggml helpers
 //
@@ -371,8 +374,24 @@ struct whisper_vocab {
 
     int n_vocab = 51864;
 
-    std::map<token, id> token_to_id;
-    std::map<id, token> id_to_token;
+    // token texts stored back to back in a single arena, each one followed by a '\0'
+    // the text of token i starts at text[offsets[i]] and ends before text[offsets[i + 1] - 1]
+    std::vector<char>     text;
+    std::vector<uint32_t> offsets = { 0 };
+
+    // open addressing hash table of the token ids by text (-1 = empty slot), see whisper_vocab_build_index()
+    std::vector<id> index;
+
+    // byte trie over the token texts, used for the longest token match in tokenize()
+    // the children of a node are stored next to each other, sorted by byte
+    struct trie_node {
+        id      token   = -1; // token ending at this node (-1 if none)
+        int32_t child   = 0;  // index of the first child
+        int32_t n_child = 0;
+        uint8_t byte    = 0;  // byte leading to this node
+    };
+
+    std::vector<trie_node> trie;
 
     // reference: https://github.com/openai/whisper/blob/248b6cb124225dd263bb9bd32d060b6517e067f8/whisper/tokenizer.py#L334-L349
     id token_eot        = 50256;
@@ -394,8 +413,189 @@ struct whisper_vocab {
     int num_languages() const {
         return n_vocab - 51765 - (is_multilingual() ? 1 : 0);
     }
+
+    int n_tokens() const {
+        return (int) offsets.size() - 1;
+    }
+
+    const char * token_text(id i) const {
+        return text.data() + offsets[i];
+    }
+
+    int token_len(id i) const {
+        return offsets[i + 1] - offsets[i] - 1;
+    }
+
+    // append the next token id
+    void add_token(const char * str, size_t len) {
+        text.insert(text.end(), str, str + len);
+        text.push_back('\0');
+        offsets.push_back(text.size());
+    }
+
+    // id of the token with the given text, or -1 if there is none
+    id find(const char * str, size_t len) const;
+
+    id find(const std::string & str) const {
+        return find(str.data(), str.size());
+    }
 };
 
+// FNV-1a
+static uint32_t whisper_vocab_hash(const char * str, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t) str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+whisper_vocab::id whisper_vocab::find(const char * str, size_t len) const {
+    if (index.empty()) {
+        return -1;
+    }
+
+    const uint32_t mask = index.size() - 1;
+    for (uint32_t slot = whisper_vocab_hash(str, len) & mask; ; slot = (slot + 1) & mask) {
+        const id i = index[slot];
+        if (i < 0) {
+            return -1;
+        }
+        if ((size_t) token_len(i) == len && memcmp(token_text(i), str, len) == 0) {
+            return i;
+        }
+    }
+}
+
+// build vocab.index from the token texts, at most half full
+// a text shared by several tokens maps to the last one of them
+static void whisper_vocab_build_index(whisper_vocab & vocab) {
+    const int n = vocab.n_tokens();
+
+    size_t n_slots = 16;
+    while (n_slots < 2*(size_t) n) {
+        n_slots *= 2;
+    }
+
+    auto & index = vocab.index;
+    index.assign(n_slots, -1);
+
+    const uint32_t mask = n_slots - 1;
+    for (whisper_vocab::id i = 0; i < n; ++i) {
+        const char * str = vocab.token_text(i);
+        const int    len = vocab.token_len(i);
+
+        uint32_t slot = whisper_vocab_hash(str, len) & mask;
+        while (index[slot] >= 0 && !(vocab.token_len(index[slot]) == len && memcmp(vocab.token_text(index[slot]), str, len) == 0)) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = i;
+    }
+}
+
+// build vocab.trie from the token texts, with the same token for a shared text as vocab.find()
+static void whisper_vocab_build_trie(whisper_vocab & vocab) {
+    std::vector<whisper_vocab::id> keys;
+    keys.reserve(vocab.n_tokens());
+    for (whisper_vocab::id i = 0; i < vocab.n_tokens(); ++i) {
+        if (vocab.token_len(i) > 0 && vocab.find(vocab.token_text(i), vocab.token_len(i)) == i) {
+            keys.push_back(i);
+        }
+    }
+
+    // byte order
+    std::sort(keys.begin(), keys.end(), [&vocab](whisper_vocab::id a, whisper_vocab::id b) {
+        const int len_a = vocab.token_len(a);
+        const int len_b = vocab.token_len(b);
+        const int cmp = memcmp(vocab.token_text(a), vocab.token_text(b), std::min(len_a, len_b));
+        return cmp < 0 || (cmp == 0 && len_a < len_b);
+    });
+
+    // range of keys sharing the prefix of the node, breadth-first so that siblings are contiguous
+    struct trie_range {
+        int32_t node;
+        size_t  lo;
+        size_t  hi;
+        size_t  depth;
+    };
+
+    auto & trie = vocab.trie;
+    trie.clear();
+    trie.emplace_back();
+
+    std::vector<trie_range> queue;
+    queue.push_back({ 0, 0, keys.size(), 0 });
+
+    for (size_t iq = 0; iq < queue.size(); ++iq) {
+        const trie_range r = queue[iq];
+        size_t lo = r.lo;
+
+        // the key equal to the prefix sorts first
+        if (lo < r.hi && (size_t) vocab.token_len(keys[lo]) == r.depth) {
+            trie[r.node].token = keys[lo];
+            ++lo;
+        }
+
+        trie[r.node].child = trie.size();
+
+        while (lo < r.hi) {
+            const uint8_t b = vocab.token_text(keys[lo])[r.depth];
+
+            size_t hi = lo + 1;
+            while (hi < r.hi && (uint8_t) vocab.token_text(keys[hi])[r.depth] == b) {
+                ++hi;
+            }
+
+            whisper_vocab::trie_node node;
+            node.byte = b;
+            trie.push_back(node);
+            queue.push_back({ (int32_t) trie.size() - 1, lo, hi, r.depth + 1 });
+
+            trie[r.node].n_child++;
+            lo = hi;
+        }
+    }
+}
+
+// longest token that is a prefix of text[0, n)
+// returns its length and sets token, or returns 0 if there is none
+static int whisper_vocab_longest_match(const whisper_vocab & vocab, const char * text, int n, whisper_vocab::id & token) {
+    const auto & trie = vocab.trie;
+
+    int len = 0;
+    int32_t cur = 0;
+
+    for (int i = 0; i < n; ++i) {
+        const auto & node = trie[cur];
+        const uint8_t b = text[i];
+
+        // binary search in the sorted children
+        int32_t lo = node.child;
+        int32_t hi = node.child + node.n_child;
+        while (lo < hi) {
+            const int32_t mid = (lo + hi)/2;
+            if (trie[mid].byte < b) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == node.child + node.n_child || trie[lo].byte != b) {
+            break;
+        }
+
+        cur = lo;
+        if (trie[cur].token >= 0) {
+            token = trie[cur].token;
+            len = i + 1;
+        }
+    }
+
+    return len;
+}
+
 struct whisper_segment {
     int64_t t0;
     int64_t t1;
@@ -709,6 +909,9 @@ struct whisper_model {
     // tensors
     int n_loaded;
     std::map<std::string, struct wsp_ggml_tensor *> tensors;
+
+    // mixed precision files: type of the tensors that are not stored in the type of the ftype
+    std::map<std::string, wsp_ggml_type> tensor_types;
 };
 
 struct whisper_partial_utf8 {
@@ -716,14 +919,32 @@ struct whisper_partial_utf8 {
     int      n_remain; // num bytes remaining; -1 indicates invalid sequence
 };
 
+// grammar rules compiled once per whisper_full call and shared by the grammars of all the decoders
+struct whisper_grammar_compiled {
+    std::vector<std::vector<whisper_grammar_element>>         rules;
+    std::vector<std::vector<const whisper_grammar_element *>> stacks; // initial stacks
+
+    // bitset of the tokens rejected by a stack when no partial UTF-8 sequence is pending
+    // the entries are never modified once inserted, the map is guarded by the mutex
+    std::mutex mutex;
+    std::map<std::vector<const whisper_grammar_element *>, std::vector<uint64_t>> rejects;
+};
+
 struct whisper_grammar {
-    /*const*/ std::vector<std::vector<whisper_grammar_element>> rules;
-    std::vector<std::vector<const whisper_grammar_element *>>   stacks;
+    std::shared_ptr<whisper_grammar_compiled>                 compiled;
+    std::vector<std::vector<const whisper_grammar_element *>> stacks;
 
     // buffer for partially generated UTF-8 sequence from accepted tokens
     whisper_partial_utf8 partial_utf8;
 };
 
+// code points of the text of every token (decoded without a pending UTF-8 sequence)
+struct whisper_token_code_points {
+    std::vector<uint32_t>             data;    // 0-terminated code points of the tokens, back to back
+    std::vector<uint32_t>             offsets; // start of each token in data
+    std::vector<whisper_partial_utf8> partial; // incomplete UTF-8 sequence at the end of each token
+};
+
 struct whisper_grammar_candidate {
     whisper_token          id;
     const uint32_t       * code_points;
@@ -769,6 +990,19 @@ struct whisper_decoder {
     mutable std::mt19937 rng; // used for sampling at t > 0.0
 };
 
+// token trie of the hotword phrases, see whisper_hotwords_init()
+struct whisper_hotwords {
+    struct node {
+        std::vector<std::pair<whisper_token, int32_t>> next; // child nodes by token, sorted by token
+    };
+
+    std::vector<std::string> phrases; // trimmed phrases the trie was built from
+    std::vector<node> nodes;          // nodes[0] is the root, empty if there are no hotwords
+    int depth = 0;                    // number of tokens of the longest phrase
+
+    std::vector<uint8_t> word_start;  // by token: starts a new word (leading space) or is not text
+};
+
 struct whisper_state {
     int64_t t_sample_us = 0;
     int64_t t_encode_us = 0;
@@ -794,6 +1028,11 @@ struct whisper_state {
 
     whisper_mel mel;
 
+    // speed_up: 2x time-compressed audio, the buffers are reused by the next calls
+    std::vector<float> tsm_in;
+    std::vector<float> tsm_out;
+    std::vector<float> tsm_window;
+
     whisper_batch batch;
 
     whisper_decoder decoders[WHISPER_MAX_DECODERS];
@@ -822,6 +1061,15 @@ struct whisper_state {
     std::vector<whisper_segment> result_all;
     std::vector<whisper_token>   prompt_past;
 
+    // contextual biasing of the current whisper_full call
+    whisper_hotwords hotwords;
+
+    // [EXPERIMENTAL] DTW token timestamps
+    // alignment heads resolved from the context params and the cross-attention weights of the
+    // last decoder call with save_alignment_heads_QKs: [n_audio_ctx, n_tokens, n_aheads]
+    std::vector<whisper_ahead> aheads;
+    struct wsp_ggml_tensor * aheads_cross_QKs = nullptr;
+
     int lang_id = 0; // english by default
 
     std::string path_model; // populated by whisper_init_from_file_with_params()
@@ -844,6 +1092,10 @@ struct whisper_state {
 
     // [EXPERIMENTAL] speed-up techniques
     int32_t exp_n_audio_ctx = 0; // 0 - use default
+
+    // input of the encoder output in kv_cross, an encode with the same input is skipped
+    int32_t enc_seek  = -1; // -1 - no valid encoder output
+    int32_t enc_n_ctx = 0;
 };
 
 struct whisper_context {
@@ -858,6 +1110,10 @@ struct whisper_context {
     whisper_model model;
     whisper_vocab vocab;
 
+    // decoded on the first use of a grammar, see whisper_get_token_code_points()
+    std::once_flag            token_code_points_once;
+    whisper_token_code_points token_code_points;
+
     whisper_state * state = nullptr;
 
     wsp_ggml_backend_t backend = nullptr;
@@ -1091,6 +1347,27 @@ static wsp_ggml_backend_t whisper_backend_init(const whisper_context_params & pa
     return wsp_ggml_backend_cpu_init();
 }
 
+// types a mixed model may use for a tensor, the ones the quantizer writes (rn-quantize.cpp is_writable)
+static bool whisper_is_mixed_type(int32_t ttype) {
+    switch (ttype) {
+        case WSP_GGML_TYPE_F32:
+        case WSP_GGML_TYPE_F16:
+        case WSP_GGML_TYPE_Q4_0:
+        case WSP_GGML_TYPE_Q4_1:
+        case WSP_GGML_TYPE_Q5_0:
+        case WSP_GGML_TYPE_Q5_1:
+        case WSP_GGML_TYPE_Q8_0:
+        case WSP_GGML_TYPE_Q2_K:
+        case WSP_GGML_TYPE_Q3_K:
+        case WSP_GGML_TYPE_Q4_K:
+        case WSP_GGML_TYPE_Q5_K:
+        case WSP_GGML_TYPE_Q6_K:
+            return true;
+        default:
+            return false;
+    }
+}
+
 // load the model from a ggml file
 //
 // file format:
@@ -1170,6 +1447,10 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
 
         hparams.ftype %= WSP_GGML_QNT_VERSION_FACTOR;
 
+        const bool mixed = (hparams.ftype & WHISPER_FTYPE_MIXED) != 0;
+
+        hparams.ftype &= ~WHISPER_FTYPE_MIXED;
+
         // for the big tensors, we have the option to store the data in 16-bit floats or quantized
         // in order to save memory and also to speed up the computation
         wctx.wtype = wsp_ggml_ftype_to_wsp_ggml_type((wsp_ggml_ftype) (model.hparams.ftype));
@@ -1178,6 +1459,38 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
             return false;
         }
 
+        if (mixed) {
+            int32_t n_types = 0;
+            read_safe(loader, n_types);
+
+            for (int32_t i = 0; i < n_types; ++i) {
+                int32_t length;
+                int32_t ttype;
+
+                read_safe(loader, length);
+                if (length <= 0 || length >= WSP_GGML_MAX_NAME) {
+                    WHISPER_LOG_ERROR("%s: invalid model (bad tensor name length %d in the type table)\n", __func__, length);
+                    return false;
+                }
+
+                std::string name(length, 0);
+                loader->read(loader->context, &name[0], length);
+                read_safe(loader, ttype);
+
+                if (loader->eof(loader->context)) {
+                    WHISPER_LOG_ERROR("%s: invalid model (truncated type table, %d of %d entries)\n", __func__, i, n_types);
+                    return false;
+                }
+
+                if (!whisper_is_mixed_type(ttype)) {
+                    WHISPER_LOG_ERROR("%s: invalid model (bad type %d for tensor '%s')\n", __func__, ttype, name.c_str());
+                    return false;
+                }
+
+                model.tensor_types[name] = (wsp_ggml_type) ttype;
+            }
+        }
+
         WHISPER_LOG_INFO("%s: n_vocab       = %d\n", __func__, hparams.n_vocab);
         WHISPER_LOG_INFO("%s: n_audio_ctx   = %d\n", __func__, hparams.n_audio_ctx);
         WHISPER_LOG_INFO("%s: n_audio_state = %d\n", __func__, hparams.n_audio_state);
@@ -1190,6 +1503,9 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
         WHISPER_LOG_INFO("%s: n_mels        = %d\n", __func__, hparams.n_mels);
         WHISPER_LOG_INFO("%s: ftype         = %d\n", __func__, model.hparams.ftype);
         WHISPER_LOG_INFO("%s: qntvr         = %d\n", __func__, qntvr);
+        if (mixed) {
+            WHISPER_LOG_INFO("%s: mixed         = %d tensors\n", __func__, (int) model.tensor_types.size());
+        }
         WHISPER_LOG_INFO("%s: type          = %d (%s%s)\n", __func__, model.type, g_model_name.at(model.type).c_str(), mver.c_str());
     }
 
@@ -1217,28 +1533,27 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
         //}
 
         std::string word;
-        std::vector<char> tmp;
 
-        tmp.reserve(128);
+        vocab.text.clear();
+        vocab.text.reserve(8*std::max(n_vocab, model.hparams.n_vocab));
+        vocab.offsets.assign(1, 0);
+        vocab.offsets.reserve(std::max(n_vocab, model.hparams.n_vocab) + 1);
 
         for (int i = 0; i < n_vocab; i++) {
             uint32_t len;
             read_safe(loader, len);
 
+            // read straight into the arena
+            // seems like we have an empty-string token in multi-language models (i = 50256)
+            const size_t pos = vocab.text.size();
+            vocab.text.resize(pos + len + 1);
             if (len > 0) {
-                tmp.resize(len);
-                loader->read(loader->context, &tmp[0], tmp.size()); // read to buffer
-                word.assign(&tmp[0], tmp.size());
-            } else {
-                // seems like we have an empty-string token in multi-language models (i = 50256)
-                //WHISPER_LOG_WARN("%s: warning: empty-string token in vocab, i = %d\n", __func__, i);
-                word = "";
+                loader->read(loader->context, &vocab.text[pos], len);
             }
+            vocab.text[pos + len] = '\0';
+            vocab.offsets.push_back(vocab.text.size());
 
-            vocab.token_to_id[word] = i;
-            vocab.id_to_token[i] = word;
-
-            //printf("%s: vocab[%d] = '%s'\n", __func__, i, word.c_str());
+            //printf("%s: vocab[%d] = '%s'\n", __func__, i, vocab.token_text(i));
         }
 
         vocab.n_vocab = model.hparams.n_vocab;
@@ -1286,12 +1601,14 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
                 } else {
                     word = "[_extra_token_" + std::to_string(i) + "]";
                 }
-                vocab.token_to_id[word] = i;
-                vocab.id_to_token[i] = word;
+                vocab.add_token(word.data(), word.size());
             }
         }
 
         WHISPER_LOG_INFO("%s: n_langs       = %d\n", __func__, vocab.num_languages());
+
+        whisper_vocab_build_index(vocab);
+        whisper_vocab_build_trie(vocab);
     }
 
     const wsp_ggml_type wtype = wctx.wtype;
@@ -1515,6 +1832,30 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
         }
     }
 
+    // mixed precision: the tensors are not allocated yet, give them the type of the file
+    for (const auto & tt : model.tensor_types) {
+        if (model.tensors.find(tt.first) == model.tensors.end()) {
+            WHISPER_LOG_ERROR("%s: unknown tensor '%s' in the type table\n", __func__, tt.first.c_str());
+            return false;
+        }
+
+        struct wsp_ggml_tensor * tensor = model.tensors[tt.first];
+
+        const wsp_ggml_type type = tt.second;
+
+        if (tensor->ne[0] % wsp_ggml_blck_size(type) != 0) {
+            WHISPER_LOG_ERROR("%s: tensor '%s' cannot be stored as %s\n", __func__, tt.first.c_str(), wsp_ggml_type_name(type));
+            return false;
+        }
+
+        tensor->type  = type;
+        tensor->nb[0] = wsp_ggml_type_size(type);
+        tensor->nb[1] = tensor->nb[0]*(tensor->ne[0]/wsp_ggml_blck_size(type));
+        for (int i = 2; i < WSP_GGML_MAX_DIMS; i++) {
+            tensor->nb[i] = tensor->nb[i - 1]*tensor->ne[i - 1];
+        }
+    }
+
     wctx.backend = whisper_backend_init(wctx.params);
 
     {
@@ -1566,6 +1907,11 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
                 nelements *= ne[i];
             }
 
+            if (length <= 0 || length >= WSP_GGML_MAX_NAME) {
+                WHISPER_LOG_ERROR("%s: invalid model (bad tensor name length %d)\n", __func__, length);
+                return false;
+            }
+
             std::string name;
             std::vector<char> tmp(length); // create a buffer
             loader->read(loader->context, &tmp[0], tmp.size()); // read to buffer
@@ -1660,6 +2006,11 @@ static bool whisper_encode_external(const whisper_state & wstate) {
     return use_coreml || use_openvino;
 }
 
+// the fused kernels (wsp_ggml_flash_attn, wsp_ggml_conv_1d_k3, wsp_ggml_graph_fuse) are only implemented by the CPU backend
+static bool whisper_use_fused_ops(const whisper_state & wstate) {
+    return wsp_ggml_backend_is_cpu(wstate.backend);
+}
+
 static struct wsp_ggml_cgraph * whisper_build_graph_conv(
         whisper_context & wctx,
           whisper_state & wstate,
@@ -1713,7 +2064,10 @@ static struct wsp_ggml_cgraph * whisper_build_graph_conv(
 
     if (!whisper_encode_external(wstate)) {
         // convolution + gelu
-        {
+        if (whisper_use_fused_ops(wstate)) {
+            cur = wsp_ggml_conv_1d_k3(ctx0, model.e_conv_1_w, mel, model.e_conv_1_b, 1, true);
+            cur = wsp_ggml_conv_1d_k3(ctx0, model.e_conv_2_w, cur, model.e_conv_2_b, 2, true);
+        } else {
             cur = wsp_ggml_conv_1d_ph(ctx0, model.e_conv_1_w, mel, 1, 1);
             cur = wsp_ggml_add(ctx0, cur, model.e_conv_1_b);
 
@@ -1860,65 +2214,69 @@ static struct wsp_ggml_cgraph * whisper_build_graph_encoder(
 
             // ------
 
-#ifdef WHISPER_USE_FLASH_ATTN
-            struct wsp_ggml_tensor * Q =
-                wsp_ggml_permute(ctx0,
-                        wsp_ggml_cpy(ctx0,
-                            Qcur,
-                            wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_ctx)),
-                        0, 2, 1, 3);
-
-            struct wsp_ggml_tensor * K =
-                wsp_ggml_permute(ctx0,
-                        wsp_ggml_cpy(ctx0,
-                            Kcur,
-                            wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_ctx)),
-                        0, 2, 1, 3);
-
-            struct wsp_ggml_tensor * V =
-                wsp_ggml_cpy(ctx0,
-                        wsp_ggml_permute(ctx0,
-                            wsp_ggml_reshape_3d(ctx0,
-                                Vcur,
-                                n_state/n_head, n_head, n_ctx),
-                            1, 2, 0, 3),
-                        wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_ctx, n_state/n_head, n_head));
-
-            struct wsp_ggml_tensor * KQV = wsp_ggml_flash_attn(ctx0, Q, K, V, false);
-#else
-            struct wsp_ggml_tensor * Q =
-                wsp_ggml_permute(ctx0,
-                        wsp_ggml_cpy(ctx0,
-                            Qcur,
-                            wsp_ggml_new_tensor_3d(ctx0, WSP_GGML_TYPE_F32, n_state/n_head, n_head, n_ctx)),
-                        0, 2, 1, 3);
-
-            struct wsp_ggml_tensor * K =
-                wsp_ggml_permute(ctx0,
-                        wsp_ggml_cpy(ctx0,
-                            Kcur,
-                            wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_ctx)),
-                        0, 2, 1, 3);
-
-            // K * Q
-            struct wsp_ggml_tensor * KQ = wsp_ggml_mul_mat(ctx0, K, Q);
-
-            struct wsp_ggml_tensor * KQ_scaled = wsp_ggml_scale(ctx0, KQ, KQscale);
-
-            struct wsp_ggml_tensor * KQ_soft_max = wsp_ggml_soft_max(ctx0, KQ_scaled);
-
-            struct wsp_ggml_tensor * V =
-                wsp_ggml_cpy(ctx0,
-                        wsp_ggml_permute(ctx0,
-                            wsp_ggml_reshape_3d(ctx0,
-                                Vcur,
-                                n_state/n_head, n_head, n_ctx),
-                            1, 2, 0, 3),
-                        wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_ctx, n_state/n_head, n_head)
-                        );
+            struct wsp_ggml_tensor * KQV = nullptr;
+
+            if (whisper_use_fused_ops(wstate)) {
+                // scale + softmax + V in one op, the n_ctx x n_ctx KQ matrix is never stored
+                struct wsp_ggml_tensor * Q =
+                    wsp_ggml_permute(ctx0,
+                            wsp_ggml_cpy(ctx0,
+                                Qcur,
+                                wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_ctx)),
+                            0, 2, 1, 3);
+
+                struct wsp_ggml_tensor * K =
+                    wsp_ggml_permute(ctx0,
+                            wsp_ggml_cpy(ctx0,
+                                Kcur,
+                                wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_ctx)),
+                            0, 2, 1, 3);
+
+                struct wsp_ggml_tensor * V =
+                    wsp_ggml_cpy(ctx0,
+                            wsp_ggml_permute(ctx0,
+                                wsp_ggml_reshape_3d(ctx0,
+                                    Vcur,
+                                    n_state/n_head, n_head, n_ctx),
+                                1, 2, 0, 3),
+                            wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_ctx, n_state/n_head, n_head));
+
+                KQV = wsp_ggml_flash_attn(ctx0, Q, K, V, false);
+            } else {
+                struct wsp_ggml_tensor * Q =
+                    wsp_ggml_permute(ctx0,
+                            wsp_ggml_cpy(ctx0,
+                                Qcur,
+                                wsp_ggml_new_tensor_3d(ctx0, WSP_GGML_TYPE_F32, n_state/n_head, n_head, n_ctx)),
+                            0, 2, 1, 3);
+
+                struct wsp_ggml_tensor * K =
+                    wsp_ggml_permute(ctx0,
+                            wsp_ggml_cpy(ctx0,
+                                Kcur,
+                                wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_ctx)),
+                            0, 2, 1, 3);
+
+                // K * Q
+                struct wsp_ggml_tensor * KQ = wsp_ggml_mul_mat(ctx0, K, Q);
+
+                struct wsp_ggml_tensor * KQ_scaled = wsp_ggml_scale(ctx0, KQ, KQscale);
+
+                struct wsp_ggml_tensor * KQ_soft_max = wsp_ggml_soft_max(ctx0, KQ_scaled);
+
+                struct wsp_ggml_tensor * V =
+                    wsp_ggml_cpy(ctx0,
+                            wsp_ggml_permute(ctx0,
+                                wsp_ggml_reshape_3d(ctx0,
+                                    Vcur,
+                                    n_state/n_head, n_head, n_ctx),
+                                1, 2, 0, 3),
+                            wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_ctx, n_state/n_head, n_head)
+                            );
+
+                KQV = wsp_ggml_mul_mat(ctx0, V, KQ_soft_max);
+            }
 
-            struct wsp_ggml_tensor * KQV = wsp_ggml_mul_mat(ctx0, V, KQ_soft_max);
-#endif
             struct wsp_ggml_tensor * KQV_merged = wsp_ggml_permute(ctx0, KQV, 0, 2, 1, 3);
 
             cur = wsp_ggml_cpy(ctx0,
@@ -1995,6 +2353,10 @@ static struct wsp_ggml_cgraph * whisper_build_graph_encoder(
 
     wstate.embd_enc = cur;
 
+    if (whisper_use_fused_ops(wstate)) {
+        wsp_ggml_graph_fuse(gf);
+    }
+
     //wsp_ggml_graph_print(gf);
 
     ////////////////////////////////////////////////////////////////////////////
@@ -2081,6 +2443,10 @@ static struct wsp_ggml_cgraph * whisper_build_graph_cross(
         wsp_ggml_build_forward_expand(gf, wsp_ggml_cpy(ctx0, Vcross, v));
     }
 
+    if (whisper_use_fused_ops(wstate)) {
+        wsp_ggml_graph_fuse(gf);
+    }
+
     //wsp_ggml_graph_print(gf);
 
     wsp_ggml_free(ctx0);
@@ -2105,6 +2471,15 @@ static bool whisper_encode_internal(
               const int   n_threads,
  whisper_abort_callback   abort_callback,
                    void * abort_callback_data) {
+    const int n_ctx = wstate.exp_n_audio_ctx > 0 ? wstate.exp_n_audio_ctx : wctx.model.hparams.n_audio_ctx;
+
+    // e.g. the language detection already encoded the first window of whisper_full
+    if (wstate.enc_seek == mel_offset && wstate.enc_n_ctx == n_ctx) {
+        return !(abort_callback && abort_callback(abort_callback_data));
+    }
+
+    wstate.enc_seek = -1;
+
     const int64_t t_start_us = wsp_ggml_time_us();
 
     // conv
@@ -2151,13 +2526,21 @@ static bool whisper_encode_internal(
     wstate.t_encode_us += wsp_ggml_time_us() - t_start_us;
     wstate.n_encode++;
 
-    return !(abort_callback && abort_callback(abort_callback_data));
+    if (abort_callback && abort_callback(abort_callback_data)) {
+        return false;
+    }
+
+    wstate.enc_seek  = mel_offset;
+    wstate.enc_n_ctx = n_ctx;
+
+    return true;
 }
 
 static struct wsp_ggml_cgraph * whisper_build_graph_decoder(
          whisper_context & wctx,
          whisper_state   & wstate,
-     const whisper_batch & batch) {
+     const whisper_batch & batch,
+                    bool   save_alignment_heads_QKs) {
     const auto & model   = wctx.model;
     const auto & hparams = model.hparams;
 
@@ -2218,6 +2601,15 @@ static struct wsp_ggml_cgraph * whisper_build_graph_decoder(
     struct wsp_ggml_tensor * KQ_mask = wsp_ggml_new_tensor_3d(ctx0, WSP_GGML_TYPE_F32, n_kv, n_tokens, 1);
     wsp_ggml_allocr_alloc(alloc, KQ_mask);
 
+    // the cross-attention weights of the alignment heads are copied here
+    // nothing reads this tensor in the graph, so the allocator keeps it until the next reset
+    struct wsp_ggml_tensor * aheads_cross_QKs = nullptr;
+    if (save_alignment_heads_QKs && !wstate.aheads.empty()) {
+        aheads_cross_QKs = wsp_ggml_new_tensor_3d(ctx0, WSP_GGML_TYPE_F32, n_audio_ctx, n_tokens, wstate.aheads.size());
+        wsp_ggml_allocr_alloc(alloc, aheads_cross_QKs);
+    }
+    wstate.aheads_cross_QKs = aheads_cross_QKs;
+
     if (!wsp_ggml_allocr_is_measure(alloc)) {
         wstate.inp_mask.resize(n_kv*n_tokens);
 
@@ -2408,26 +2800,61 @@ static struct wsp_ggml_cgraph * whisper_build_graph_decoder(
 
             // ------
 
-            struct wsp_ggml_tensor * Q =
-                wsp_ggml_permute(ctx0,
-                        wsp_ggml_reshape_3d(ctx0, Qcur, n_state/n_head, n_head, n_tokens),
-                        0, 2, 1, 3);
+            struct wsp_ggml_tensor * KQV = nullptr;
 
-            // K * Q
-            struct wsp_ggml_tensor * KQ = wsp_ggml_mul_mat(ctx0, Kcross, Q);
+            // the alignment heads need the softmax of KQ
+            if (whisper_use_fused_ops(wstate) && !aheads_cross_QKs) {
+                // Q and Kcross are already scaled
+                struct wsp_ggml_tensor * Q =
+                    wsp_ggml_permute(ctx0,
+                            wsp_ggml_cpy(ctx0,
+                                Qcur,
+                                wsp_ggml_new_tensor_3d(ctx0, wctx.itype, n_state/n_head, n_head, n_tokens)),
+                            0, 2, 1, 3);
+
+                KQV = wsp_ggml_flash_attn_scaled(ctx0, Q, Kcross, V, false, 1.0f);
+            } else {
+                struct wsp_ggml_tensor * Q =
+                    wsp_ggml_permute(ctx0,
+                            wsp_ggml_reshape_3d(ctx0, Qcur, n_state/n_head, n_head, n_tokens),
+                            0, 2, 1, 3);
 
-            //struct wsp_ggml_tensor * KQ_scaled =
-            //    wsp_ggml_scale(ctx0,
-            //            KQ,
-            //            wsp_ggml_new_f32(ctx0, 1.0f/sqrt(float(n_state)/n_head))
-            //            );
+                // K * Q
+                struct wsp_ggml_tensor * KQ = wsp_ggml_mul_mat(ctx0, Kcross, Q);
 
-            // no masking for cross-attention
-            //struct wsp_ggml_tensor * KQ_masked = wsp_ggml_diag_mask_inf(ctx0, KQ_scaled, n_past);
+                //struct wsp_ggml_tensor * KQ_scaled =
+                //    wsp_ggml_scale(ctx0,
+                //            KQ,
+                //            wsp_ggml_new_f32(ctx0, 1.0f/sqrt(float(n_state)/n_head))
+                //            );
 
-            struct wsp_ggml_tensor * KQ_soft_max = wsp_ggml_soft_max(ctx0, KQ);
+                // no masking for cross-attention
+                //struct wsp_ggml_tensor * KQ_masked = wsp_ggml_diag_mask_inf(ctx0, KQ_scaled, n_past);
 
-            struct wsp_ggml_tensor * KQV = wsp_ggml_mul_mat(ctx0, V, KQ_soft_max);
+                struct wsp_ggml_tensor * KQ_soft_max = wsp_ggml_soft_max(ctx0, KQ);
+
+                if (aheads_cross_QKs) {
+                    for (int ih = 0; ih < (int) wstate.aheads.size(); ++ih) {
+                        if (wstate.aheads[ih].n_text_layer != il) {
+                            continue;
+                        }
+
+                        struct wsp_ggml_tensor * src = wsp_ggml_view_2d(ctx0, KQ_soft_max,
+                                n_audio_ctx, n_tokens,
+                                KQ_soft_max->nb[1],
+                                wstate.aheads[ih].n_head*KQ_soft_max->nb[2]);
+
+                        struct wsp_ggml_tensor * dst = wsp_ggml_view_2d(ctx0, aheads_cross_QKs,
+                                n_audio_ctx, n_tokens,
+                                aheads_cross_QKs->nb[1],
+                                ih*aheads_cross_QKs->nb[2]);
+
+                        wsp_ggml_build_forward_expand(gf, wsp_ggml_cpy(ctx0, src, dst));
+                    }
+                }
+
+                KQV = wsp_ggml_mul_mat(ctx0, V, KQ_soft_max);
+            }
 
             struct wsp_ggml_tensor * KQV_merged = wsp_ggml_permute(ctx0, KQV, 0, 2, 1, 3);
 
@@ -2514,6 +2941,10 @@ static struct wsp_ggml_cgraph * whisper_build_graph_decoder(
 
     wsp_ggml_build_forward_expand(gf, logits);
 
+    if (whisper_use_fused_ops(wstate)) {
+        wsp_ggml_graph_fuse(gf);
+    }
+
     wsp_ggml_free(ctx0);
 
     return gf;
@@ -2528,12 +2959,14 @@ static struct wsp_ggml_cgraph * whisper_build_graph_decoder(
 //   - tokens:     text prompt
 //   - n_tokens:   number of tokens in the prompt
 //   - n_past:     number of past tokens to prefix the prompt with
+//   - save_alignment_heads_QKs: keep the cross-attention weights of the alignment heads in wstate.aheads_cross_QKs
 //
 static bool whisper_decode_internal(
         whisper_context & wctx,
           whisper_state & wstate,
     const whisper_batch & batch,
               const int   n_threads,
+                   bool   save_alignment_heads_QKs,
  whisper_abort_callback   abort_callback,
                    void * abort_callback_data) {
     const int64_t t_start_us = wsp_ggml_time_us();
@@ -2567,7 +3000,7 @@ static bool whisper_decode_internal(
 
         wsp_ggml_allocr_reset(alloc);
 
-        wsp_ggml_cgraph * gf = whisper_build_graph_decoder(wctx, wstate, batch);
+        wsp_ggml_cgraph * gf = whisper_build_graph_decoder(wctx, wstate, batch, save_alignment_heads_QKs);
 
         wsp_ggml_allocr_alloc_graph(alloc, gf);
 
@@ -2737,6 +3170,26 @@ static bool hann_window(int length, bool periodic, std::vector<float> & output)
     return true;
 }
 
+// PCM input samples as float in [-1, 1]
+static inline float whisper_sample_to_f32(float x) {
+    return x;
+}
+
+static inline float whisper_sample_to_f32(int16_t x) {
+    return (float) x * (1.0f/32768.0f);
+}
+
+static void whisper_samples_to_f32(const float * src, int n, float * dst) {
+    std::copy(src, src + n, dst);
+}
+
+// plain loop so that the compiler vectorizes the int16 -> float conversion
+static void whisper_samples_to_f32(const int16_t * src, int n, float * dst) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = (float) src[i] * (1.0f/32768.0f);
+    }
+}
+
 static void log_mel_spectrogram_worker_thread(int ith, const std::vector<float> & hann, const std::vector<float> & samples,
                                               int n_samples, int frame_size, int frame_step, int n_threads,
                                               const whisper_filters & filters, whisper_mel & mel) {
@@ -2803,9 +3256,11 @@ static void log_mel_spectrogram_worker_thread(int ith, const std::vector<float>
 }
 
 // ref: https://github.com/openai/whisper/blob/main/whisper/audio.py#L110-L157
+// samples: float or int16 PCM, converted to float while padding
+template <typename T>
 static bool log_mel_spectrogram(
               whisper_state & wstate,
-              const float * samples,
+              const T * samples,
               const int   n_samples,
               const int   /*sample_rate*/,
               const int   frame_size,
@@ -2817,6 +3272,8 @@ static bool log_mel_spectrogram(
               whisper_mel & mel) {
     const int64_t t_start_us = wsp_ggml_time_us();
 
+    wstate.enc_seek = -1;
+
     // Hanning window (Use cosf to eliminate difference)
     // ref: https://pytorch.org/docs/stable/generated/torch.hann_window.html
     // ref: https://github.com/openai/whisper/blob/main/whisper/audio.py#L147
@@ -2828,16 +3285,16 @@ static bool log_mel_spectrogram(
     int64_t stage_1_pad = WHISPER_SAMPLE_RATE * 30;
     int64_t stage_2_pad = frame_size / 2;
 
-    // Initialize a vector and copy data from C array to it.
+    // Initialize a vector and convert data from C array to it.
     std::vector<float> samples_padded;
     samples_padded.resize(n_samples + stage_1_pad + stage_2_pad * 2);
-    std::copy(samples, samples + n_samples, samples_padded.begin() + stage_2_pad);
+    whisper_samples_to_f32(samples, n_samples, samples_padded.data() + stage_2_pad);
 
     // pad 30 seconds of zeros at the end of audio (480,000 samples) + reflective pad 200 samples at the end of audio
     std::fill(samples_padded.begin() + n_samples + stage_2_pad, samples_padded.begin() + n_samples + stage_1_pad + 2 * stage_2_pad, 0);
 
-    // reflective pad 200 samples at the beginning of audio
-    std::reverse_copy(samples + 1, samples + 1 + stage_2_pad, samples_padded.begin());
+    // reflective pad 200 samples at the beginning of audio (from the converted samples)
+    std::reverse_copy(samples_padded.begin() + stage_2_pad + 1, samples_padded.begin() + 2 * stage_2_pad + 1, samples_padded.begin());
 
     mel.n_mel     = n_mel;
     // https://github.com/pytorch/pytorch/blob/main/aten/src/ATen/native/SpectralOps.cpp#L936
@@ -2852,7 +3309,7 @@ static bool log_mel_spectrogram(
         std::vector<std::thread> workers(n_threads - 1);
         for (int iw = 0; iw < n_threads - 1; ++iw) {
             workers[iw] = std::thread(
-                    log_mel_spectrogram_worker_thread, iw + 1, std::cref(hann), samples_padded,
+                    log_mel_spectrogram_worker_thread, iw + 1, std::cref(hann), std::cref(samples_padded),
                     n_samples + stage_2_pad, frame_size, frame_step, n_threads,
                     std::cref(filters), std::ref(mel));
         }
@@ -2899,88 +3356,228 @@ static bool log_mel_spectrogram(
     return true;
 }
 
-// split text into tokens
-//
-// ref: https://github.com/openai/gpt-2/blob/a74da5d99abaaba920de8131d64da2862a8f213b/src/encoder.py#L53
-//
-// Regex (Python):
-// r"""'s|'t|'re|'ve|'m|'ll|'d| ?\p{L}+| ?\p{N}+| ?[^\s\p{L}\p{N}]+|\s+(?!\S)|\s+"""
+// WSOLA (Waveform Similarity Overlap-Add) time-scale compression by 2x
+// ref: W. Verhelst, M. Roelands, "An overlap-add technique based on waveform similarity (WSOLA)", ICASSP 1993
 //
-// Regex (C++):
-// R"('s|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s[:alpha:][:digit:]]+|\s+(?!\S)|\s+)"
-//
-static std::vector<whisper_vocab::id> tokenize(const whisper_vocab & vocab, const std::string & text) {
-    std::vector<std::string> words;
+// Frames of WHISPER_TSM_FRAME samples are taken every 2*hop input samples and overlap-added every hop output
+// samples with a Hann window. Each frame is shifted by up to WHISPER_TSM_DELTA samples to the position that best
+// continues the previous frame, which keeps the pitch periods intact (no phasiness like the plain Phase Vocoder).
+#define WHISPER_TSM_FRAME 640 // 40 ms
+#define WHISPER_TSM_DELTA 160 // 10 ms, covers a pitch period down to 100 Hz
 
-    // first split the text into words
-    {
-        std::string str = text;
-        std::string pat = R"('s|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s[:alpha:][:digit:]]+|\s+(?!\S)|\s+)";
+// returns the number of output samples in wstate.tsm_out
+static int whisper_time_compress(whisper_state & wstate, const float * x, int n) {
+    const int n_frame = WHISPER_TSM_FRAME;
+    const int hop     = n_frame/2;
+    const int delta   = WHISPER_TSM_DELTA;
 
-        std::regex re(pat);
-        std::smatch m;
+    auto & out    = wstate.tsm_out;
+    auto & window = wstate.tsm_window;
 
-        while (std::regex_search(str, m, re)) {
-            for (auto x : m) {
-                words.push_back(x);
-            }
-            str = m.suffix();
-        }
+    if ((int) window.size() != n_frame) {
+        hann_window(n_frame, true, window);
     }
 
-    // find the longest tokens that form the words:
-    std::vector<whisper_vocab::id> tokens;
-    for (const auto & word : words) {
-        if (word.empty()) continue;
+    const int n_out = (n + 1)/2;
 
-        int i = 0;
-        int n = word.size();
-        while (i < n) {
-            int j = n;
-            bool found = false;
-            while (j > i) {
-                auto sub = word.substr(i, j-i);
-                auto it = vocab.token_to_id.find(sub);
-                if (it != vocab.token_to_id.end()) {
-                    tokens.push_back(it->second);
-                    i = j;
-                    found = true;
-                    break;
-                }
-                --j;
+    out.assign(n_out + n_frame, 0.0f);
+
+    int prev = 0;
+    for (int k = 0; k*2*hop < n; ++k) {
+        int pos = k*2*hop;
+
+        // natural continuation of the previous frame, the overlapping half of the new frame should match it
+        const int target = prev + hop;
+        const int pos0   = std::max(0, pos - delta);
+        const int pos1   = std::min(pos + delta, n - hop);
+
+        // near the end the search range can be empty (pos0 > pos1), the frame then stays at its nominal position
+        if (k > 0 && target + hop <= n && pos0 <= pos1) {
+            // normalized cross-correlation, compared as corr*|corr|/energy to avoid the sqrt
+            double energy = 0.0;
+            for (int i = 0; i < hop; ++i) {
+                energy += x[pos0 + i]*x[pos0 + i];
             }
-            if (!found) {
-                WHISPER_LOG_ERROR("unknown token\n");
-                ++i;
+
+            double best = -INFINITY;
+            for (int p = pos0; p <= pos1; ++p) {
+                if (p > pos0) {
+                    energy += x[p + hop - 1]*x[p + hop - 1] - x[p - 1]*x[p - 1];
+                }
+
+                // 4 partial sums, hop is a multiple of 4
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for (int i = 0; i < hop; i += 4) {
+                    sum[0] += x[target + i + 0]*x[p + i + 0];
+                    sum[1] += x[target + i + 1]*x[p + i + 1];
+                    sum[2] += x[target + i + 2]*x[p + i + 2];
+                    sum[3] += x[target + i + 3]*x[p + i + 3];
+                }
+                const float corr = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+
+                const double score = corr*std::fabs(corr)/std::max(energy, 1e-12);
+                if (score > best) {
+                    best = score;
+                    pos  = p;
+                }
             }
         }
+
+        float * dst = out.data() + k*hop;
+        const int n_cur = std::min(n_frame, n - pos);
+
+        // the first frame has no previous one to fade in from
+        const int i_fade = k == 0 ? hop : 0;
+        for (int i = 0; i < std::min(i_fade, n_cur); ++i) {
+            dst[i] += x[pos + i];
+        }
+        for (int i = i_fade; i < n_cur; ++i) {
+            dst[i] += window[i]*x[pos + i];
+        }
+
+        prev = pos;
     }
 
-    return tokens;
+    return n_out;
 }
 
-//
-// interface implementation
-//
+// mel spectrogram of the audio sped up x2, a mel frame covers 20 ms of the input
+template <typename T>
+static int whisper_pcm_to_mel_speed_up(whisper_context & ctx, whisper_state & state, const T * samples, int n_samples, int n_threads) {
+    const int64_t t_start_us = wsp_ggml_time_us();
 
-#ifdef WHISPER_USE_COREML
-// replace .bin with -encoder.mlmodelc
-static std::string whisper_get_coreml_path_encoder(std::string path_bin) {
-    auto pos = path_bin.rfind('.');
-    if (pos != std::string::npos) {
-        path_bin = path_bin.substr(0, pos);
-    }
+    state.tsm_in.resize(n_samples);
+    whisper_samples_to_f32(samples, n_samples, state.tsm_in.data());
 
-    // match "-qx_x"
-    pos = path_bin.rfind('-');
-    if (pos != std::string::npos) {
-        auto sub = path_bin.substr(pos);
-        if (sub.size() == 5 && sub[1] == 'q' && sub[3] == '_') {
-            path_bin = path_bin.substr(0, pos);
-        }
-    }
+    const int n_out = whisper_time_compress(state, state.tsm_in.data(), n_samples);
 
-    path_bin += "-encoder.mlmodelc";
+    state.t_mel_us += wsp_ggml_time_us() - t_start_us;
+
+    if (!log_mel_spectrogram(state, state.tsm_out.data(), n_out, WHISPER_SAMPLE_RATE, WHISPER_N_FFT, WHISPER_HOP_LENGTH, ctx.model.filters.n_mel, n_threads, ctx.model.filters, false, state.mel)) {
+        WHISPER_LOG_ERROR("%s: failed to compute mel spectrogram\n", __func__);
+        return -1;
+    }
+
+    return 0;
+}
+
+// split text into tokens
+//
+// ref: https://github.com/openai/gpt-2/blob/a74da5d99abaaba920de8131d64da2862a8f213b/src/encoder.py#L53
+//
+// Regex (Python):
+// r"""'s|'t|'re|'ve|'m|'ll|'d| ?\p{L}+| ?\p{N}+| ?[^\s\p{L}\p{N}]+|\s+(?!\S)|\s+"""
+//
+// Regex (C++):
+// R"('s|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s[:alpha:][:digit:]]+|\s+(?!\S)|\s+)"
+//
+// The split is hand-written below. As with std::regex in the "C" locale, the character classes are ASCII:
+// UTF-8 bytes are neither letters nor digits.
+//
+
+enum whisper_pretok_class {
+    WHISPER_PRETOK_SPACE,
+    WHISPER_PRETOK_ALPHA,
+    WHISPER_PRETOK_DIGIT,
+    WHISPER_PRETOK_OTHER,
+};
+
+static whisper_pretok_class whisper_pretok_class_of(char c) {
+    if (c == ' ' || (c >= '\t' && c <= '\r')) {
+        return WHISPER_PRETOK_SPACE;
+    }
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+        return WHISPER_PRETOK_ALPHA;
+    }
+    if (c >= '0' && c <= '9') {
+        return WHISPER_PRETOK_DIGIT;
+    }
+    return WHISPER_PRETOK_OTHER;
+}
+
+// length of the word starting at text[p], following the alternatives of the regex in order
+static size_t whisper_pretok_word_len(const std::string & text, size_t p) {
+    const size_t n = text.size();
+
+    // 's|'t|'re|'ve|'m|'ll|'d
+    if (text[p] == '\'' && p + 1 < n) {
+        const char c1 = text[p + 1];
+        if (c1 == 's' || c1 == 't' || c1 == 'm' || c1 == 'd') {
+            return 2;
+        }
+        if (p + 2 < n) {
+            const char c2 = text[p + 2];
+            if ((c1 == 'r' && c2 == 'e') || (c1 == 'v' && c2 == 'e') || (c1 == 'l' && c2 == 'l')) {
+                return 3;
+            }
+        }
+    }
+
+    // ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s[:alpha:][:digit:]]+
+    const size_t q = text[p] == ' ' && p + 1 < n && whisper_pretok_class_of(text[p + 1]) != WHISPER_PRETOK_SPACE ? p + 1 : p;
+    const whisper_pretok_class cls = whisper_pretok_class_of(text[q]);
+
+    size_t e = q + 1;
+    while (e < n && whisper_pretok_class_of(text[e]) == cls) {
+        ++e;
+    }
+
+    // \s+(?!\S) leaves the last space of the run for the next word, \s+ takes a single space
+    if (cls == WHISPER_PRETOK_SPACE && e < n && e - p > 1) {
+        --e;
+    }
+
+    return e - p;
+}
+
+static std::vector<whisper_vocab::id> tokenize(const whisper_vocab & vocab, const std::string & text) {
+    std::vector<whisper_vocab::id> tokens;
+
+    for (size_t p = 0; p < text.size(); ) {
+        const size_t n = whisper_pretok_word_len(text, p);
+
+        // find the longest tokens that form the word
+        size_t i = 0;
+        while (i < n) {
+            whisper_vocab::id token = -1;
+            const int len = whisper_vocab_longest_match(vocab, text.data() + p + i, n - i, token);
+            if (len > 0) {
+                tokens.push_back(token);
+                i += len;
+            } else {
+                WHISPER_LOG_ERROR("unknown token\n");
+                ++i;
+            }
+        }
+
+        p += n;
+    }
+
+    return tokens;
+}
+
+//
+// interface implementation
+//
+
+#ifdef WHISPER_USE_COREML
+// replace .bin with -encoder.mlmodelc
+static std::string whisper_get_coreml_path_encoder(std::string path_bin) {
+    auto pos = path_bin.rfind('.');
+    if (pos != std::string::npos) {
+        path_bin = path_bin.substr(0, pos);
+    }
+
+    // match "-qx_x"
+    pos = path_bin.rfind('-');
+    if (pos != std::string::npos) {
+        auto sub = path_bin.substr(pos);
+        if (sub.size() == 5 && sub[1] == 'q' && sub[3] == '_') {
+            path_bin = path_bin.substr(0, pos);
+        }
+    }
+
+    path_bin += "-encoder.mlmodelc";
 
     return path_bin;
 }
@@ -3011,6 +3608,56 @@ static std::string whisper_openvino_get_path_cache(std::string path_bin) {
 }
 #endif
 
+// alignment heads of the official models, from the openai/whisper repository
+static const std::map<whisper_alignment_heads_preset, std::vector<whisper_ahead>> g_aheads = {
+    { WHISPER_AHEADS_TINY_EN,   { {1, 0}, {2, 0}, {2, 5}, {3, 0}, {3, 1}, {3, 2}, {3, 3}, {3, 4} } },
+    { WHISPER_AHEADS_TINY,      { {2, 2}, {3, 0}, {3, 2}, {3, 3}, {3, 4}, {3, 5} } },
+    { WHISPER_AHEADS_BASE_EN,   { {3, 3}, {4, 7}, {5, 1}, {5, 5}, {5, 7} } },
+    { WHISPER_AHEADS_BASE,      { {3, 1}, {4, 2}, {4, 3}, {4, 7}, {5, 1}, {5, 2}, {5, 4}, {5, 6} } },
+    { WHISPER_AHEADS_SMALL_EN,  { {6, 6}, {7, 0}, {7, 3}, {7, 8}, {8, 2}, {8, 5}, {8, 7}, {9, 0}, {9, 4}, {9, 8}, {9, 10}, {10, 0}, {10, 1}, {10, 2}, {10, 3}, {10, 6}, {10, 11}, {11, 2}, {11, 4} } },
+    { WHISPER_AHEADS_SMALL,     { {5, 3}, {5, 9}, {8, 0}, {8, 4}, {8, 7}, {8, 8}, {9, 0}, {9, 7}, {9, 9}, {10, 5} } },
+    { WHISPER_AHEADS_MEDIUM_EN, { {11, 4}, {14, 1}, {14, 12}, {14, 14}, {15, 4}, {16, 0}, {16, 4}, {16, 9}, {17, 12}, {17, 14}, {18, 7}, {18, 10}, {18, 15}, {20, 0}, {20, 3}, {20, 9}, {20, 14}, {21, 12} } },
+    { WHISPER_AHEADS_MEDIUM,    { {13, 15}, {15, 4}, {15, 15}, {16, 1}, {20, 0}, {23, 4} } },
+    { WHISPER_AHEADS_LARGE_V1,  { {9, 19}, {11, 2}, {11, 4}, {11, 17}, {22, 7}, {22, 11}, {22, 17}, {23, 2}, {23, 15} } },
+    { WHISPER_AHEADS_LARGE_V2,  { {10, 12}, {13, 17}, {16, 11}, {16, 12}, {16, 13}, {17, 15}, {17, 16}, {18, 4}, {18, 11}, {18, 19}, {19, 11}, {21, 2}, {21, 3}, {22, 3}, {22, 9}, {22, 12}, {23, 5}, {23, 7}, {23, 13}, {25, 5}, {26, 1}, {26, 12}, {27, 15} } },
+    { WHISPER_AHEADS_LARGE_V3,  { {7, 0}, {10, 17}, {12, 18}, {13, 12}, {16, 1}, {17, 14}, {19, 11}, {21, 4}, {24, 1}, {25, 6} } },
+};
+
+static std::vector<whisper_ahead> whisper_aheads_init(const whisper_context_params & cparams, const whisper_hparams & hparams) {
+    std::vector<whisper_ahead> result;
+
+    if (!cparams.dtw_token_timestamps || cparams.dtw_aheads_preset == WHISPER_AHEADS_NONE) {
+        return result;
+    }
+
+    if (cparams.dtw_aheads_preset == WHISPER_AHEADS_N_TOP_MOST) {
+        const int n_top = cparams.dtw_n_top > 0 ? std::min(cparams.dtw_n_top, (int) hparams.n_text_layer) : hparams.n_text_layer;
+        for (int il = hparams.n_text_layer - n_top; il < hparams.n_text_layer; ++il) {
+            for (int h = 0; h < hparams.n_text_head; ++h) {
+                result.push_back({ il, h });
+            }
+        }
+        return result;
+    }
+
+    const auto it = g_aheads.find(cparams.dtw_aheads_preset);
+    if (it == g_aheads.end()) {
+        WHISPER_LOG_ERROR("%s: unknown alignment heads preset %d\n", __func__, (int) cparams.dtw_aheads_preset);
+        return result;
+    }
+
+    for (const auto & ahead : it->second) {
+        if (ahead.n_text_layer >= hparams.n_text_layer || ahead.n_head >= hparams.n_text_head) {
+            WHISPER_LOG_ERROR("%s: alignment heads preset does not match the model (layer %d, head %d)\n", __func__, ahead.n_text_layer, ahead.n_head);
+            result.clear();
+            return result;
+        }
+        result.push_back(ahead);
+    }
+
+    return result;
+}
+
 struct whisper_state * whisper_init_state(whisper_context * ctx) {
     fill_sin_cos_table();
 
@@ -3069,6 +3716,11 @@ struct whisper_state * whisper_init_state(whisper_context * ctx) {
 
     state->batch = whisper_batch_init(ctx->model.hparams.n_text_ctx, WHISPER_MAX_DECODERS);
 
+    state->aheads = whisper_aheads_init(ctx->params, ctx->model.hparams);
+    if (ctx->params.dtw_token_timestamps) {
+        WHISPER_LOG_INFO("%s: DTW token timestamps with %d alignment heads\n", __func__, (int) state->aheads.size());
+    }
+
     // TAGS: WHISPER_DECODER_INIT
     state->decoders[0].sequence.tokens.reserve(ctx->model.hparams.n_text_ctx);
 
@@ -3121,7 +3773,8 @@ struct whisper_state * whisper_init_state(whisper_context * ctx) {
 
                     whisper_batch_prep_legacy(state->batch, nullptr, n_tokens, n_past, 0);
 
-                    return whisper_build_graph_decoder(*ctx, *state, state->batch);
+                    // reserve room for the alignment heads when the DTW timestamps are enabled
+                    return whisper_build_graph_decoder(*ctx, *state, state->batch, ctx->params.dtw_token_timestamps);
                 });
 
         WHISPER_LOG_INFO("%s: compute buffer (decode) = %7.2f MB\n", __func__, whisper_allocr_size(state->alloc_decode) / 1e6);
@@ -3186,8 +3839,12 @@ int whisper_ctx_init_openvino_encoder(
 
 struct whisper_context_params whisper_context_default_params() {
     struct whisper_context_params result = {
-        /*.use_gpu    =*/ true,
-        /*.use_coreml =*/ false,
+        /*.use_gpu              =*/ true,
+        /*.use_coreml           =*/ false,
+
+        /*.dtw_token_timestamps =*/ false,
+        /*.dtw_aheads_preset    =*/ WHISPER_AHEADS_NONE,
+        /*.dtw_n_top            =*/ -1,
     };
     return result;
 }
@@ -3430,9 +4087,8 @@ int whisper_pcm_to_mel(struct whisper_context * ctx, const float * samples, int
     return whisper_pcm_to_mel_with_state(ctx, ctx->state, samples, n_samples, n_threads);
 }
 
-// same as whisper_pcm_to_mel, but applies a Phase Vocoder to speed up the audio x2 (PV without phase lock is not good)
-int whisper_pcm_to_mel_phase_vocoder_with_state(struct whisper_context * ctx, struct whisper_state * state, const float * samples, int n_samples, int n_threads) {
-    if (!log_mel_spectrogram(*state, samples, n_samples, WHISPER_SAMPLE_RATE, 2 * WHISPER_N_FFT, 2 * WHISPER_HOP_LENGTH, ctx->model.filters.n_mel, n_threads, ctx->model.filters, false, state->mel)) {
+int whisper_pcm_to_mel_s16_with_state(struct whisper_context * ctx, struct whisper_state * state, const int16_t * samples, int n_samples, int n_threads) {
+    if (!log_mel_spectrogram(*state, samples, n_samples, WHISPER_SAMPLE_RATE, WHISPER_N_FFT, WHISPER_HOP_LENGTH, ctx->model.filters.n_mel, n_threads, ctx->model.filters, false, state->mel)) {
         WHISPER_LOG_ERROR("%s: failed to compute mel spectrogram\n", __func__);
         return -1;
     }
@@ -3440,19 +4096,19 @@ int whisper_pcm_to_mel_phase_vocoder_with_state(struct whisper_context * ctx, st
     return 0;
 }
 
-// same as whisper_pcm_to_mel, but applies a Phase Vocoder to speed up the audio x2 (PV without phase lock is not good)
-int whisper_pcm_to_mel_phase_vocoder(struct whisper_context * ctx, const float * samples, int n_samples, int n_threads) {
-    return whisper_pcm_to_mel_phase_vocoder_with_state(ctx, ctx->state, samples, n_samples, n_threads);
+int whisper_pcm_to_mel_s16(struct whisper_context * ctx, const int16_t * samples, int n_samples, int n_threads) {
+    return whisper_pcm_to_mel_s16_with_state(ctx, ctx->state, samples, n_samples, n_threads);
 }
 
-// same as whisper_pcm_to_mel, but applies WSOLA to speed up the audio x2
-// TODO
-
-// same as whisper_pcm_to_mel, but applies HPTSM to speed up the audio x2
-// TODO
+// same as whisper_pcm_to_mel, but speeds up the audio x2 with WSOLA first (the name is kept for compatibility)
+int whisper_pcm_to_mel_phase_vocoder_with_state(struct whisper_context * ctx, struct whisper_state * state, const float * samples, int n_samples, int n_threads) {
+    return whisper_pcm_to_mel_speed_up(*ctx, *state, samples, n_samples, n_threads);
+}
 
-// same as whisper_pcm_to_mel, but applies PV (with phase lock) to speed up the audio x2
-// TODO
+// same as whisper_pcm_to_mel, but speeds up the audio x2 with WSOLA first (the name is kept for compatibility)
+int whisper_pcm_to_mel_phase_vocoder(struct whisper_context * ctx, const float * samples, int n_samples, int n_threads) {
+    return whisper_pcm_to_mel_phase_vocoder_with_state(ctx, ctx->state, samples, n_samples, n_threads);
+}
 
 int whisper_set_mel_with_state(
         struct whisper_context * ctx,
@@ -3465,6 +4121,8 @@ int whisper_set_mel_with_state(
         return -1;
     }
 
+    state->enc_seek = -1;
+
     state->mel.n_len     = n_len;
     state->mel.n_len_org = n_len;
     state->mel.n_mel     = n_mel;
@@ -3506,7 +4164,7 @@ int whisper_decode_with_state(struct whisper_context * ctx, struct whisper_state
 
     whisper_kv_cache_seq_rm(state->kv_self, 0, n_past, -1);
 
-    if (!whisper_decode_internal(*ctx, *state, state->batch, n_threads, nullptr, nullptr)) {
+    if (!whisper_decode_internal(*ctx, *state, state->batch, n_threads, false, nullptr, nullptr)) {
         WHISPER_LOG_ERROR("%s: failed to eval\n", __func__);
         return 1;
     }
@@ -3622,17 +4280,18 @@ int whisper_lang_auto_detect_with_state(
         logits_id.emplace_back(state->logits[token_lang], kv.second.first);
     }
 
-    // sort descending
-    {
-        using pair_type = std::remove_reference<decltype(logits_id)>::type::value_type;
-        std::sort(logits_id.begin(), logits_id.end(), [](const pair_type & a, const pair_type & b) {
-            return a.first > b.first;
-        });
+    // only the top language is returned, no need to sort
+    size_t i_top = 0;
+    for (size_t i = 1; i < logits_id.size(); ++i) {
+        if (logits_id[i].first > logits_id[i_top].first) {
+            i_top = i;
+        }
     }
+    const int top = logits_id[i_top].second;
 
     // softmax
     {
-        const auto max = logits_id[0].first;
+        const auto max = logits_id[i_top].first;
 
         double sum = 0.0f;
         for (auto & kv : logits_id) {
@@ -3655,7 +4314,7 @@ int whisper_lang_auto_detect_with_state(
         }
     }
 
-    return logits_id[0].second;
+    return top;
 }
 
 int whisper_lang_auto_detect(
@@ -3764,7 +4423,11 @@ float * whisper_get_logits_from_state(struct whisper_state * state) {
 }
 
 const char * whisper_token_to_str(struct whisper_context * ctx, whisper_token token) {
-    return ctx->vocab.id_to_token.at(token).c_str();
+    if (token < 0 || token >= ctx->vocab.n_tokens()) {
+        WHISPER_LOG_ERROR("%s: invalid token id %d\n", __func__, token);
+        return "";
+    }
+    return ctx->vocab.token_text(token);
 }
 
 whisper_token whisper_token_eot(struct whisper_context * ctx) {
@@ -3873,6 +4536,8 @@ const char * whisper_print_system_info(void) {
     s += "FMA = "       + std::to_string(wsp_ggml_cpu_has_fma())       + " | ";
     s += "NEON = "      + std::to_string(wsp_ggml_cpu_has_neon())      + " | ";
     s += "ARM_FMA = "   + std::to_string(wsp_ggml_cpu_has_arm_fma())   + " | ";
+    s += "DOTPROD = "   + std::to_string(wsp_ggml_cpu_has_dotprod())   + " | ";
+    s += "MATMUL_INT8 = " + std::to_string(wsp_ggml_cpu_has_matmul_int8()) + " | ";
     s += "METAL = "     + std::to_string(wsp_ggml_cpu_has_metal())     + " | ";
     s += "F16C = "      + std::to_string(wsp_ggml_cpu_has_f16c())      + " | ";
     s += "FP16_VA = "   + std::to_string(wsp_ggml_cpu_has_fp16_va())   + " | ";
@@ -3881,6 +4546,7 @@ const char * whisper_print_system_info(void) {
     s += "SSE3 = "      + std::to_string(wsp_ggml_cpu_has_sse3())      + " | ";
     s += "SSSE3 = "     + std::to_string(wsp_ggml_cpu_has_ssse3())     + " | ";
     s += "VSX = "       + std::to_string(wsp_ggml_cpu_has_vsx())       + " | ";
+    s += "DISPATCH = "  + std::string(wsp_ggml_cpu_dispatch())         + " | ";
     s += "CUDA = "      + std::to_string(wsp_ggml_cpu_has_cublas())    + " | ";
     s += "COREML = "    + std::to_string(whisper_has_coreml())     + " | ";
     s += "OPENVINO = "  + std::to_string(whisper_has_openvino())   + " | ";
@@ -3950,6 +4616,30 @@ std::pair<std::vector<uint32_t>, whisper_partial_utf8> decode_utf8(
     return std::make_pair(std::move(code_points), whisper_partial_utf8{ value, n_remain });
 }
 
+// decodes the text of all the tokens once per context
+static const whisper_token_code_points & whisper_get_token_code_points(whisper_context & ctx) {
+    std::call_once(ctx.token_code_points_once, [&ctx]() {
+        auto & cp = ctx.token_code_points;
+
+        const int n_tokens = ctx.vocab.n_tokens();
+
+        cp.data.clear();
+        cp.data.reserve(ctx.vocab.text.size());
+        cp.offsets.resize(n_tokens);
+        cp.partial.resize(n_tokens);
+
+        for (int i = 0; i < n_tokens; ++i) {
+            const auto decoded = decode_utf8(ctx.vocab.token_text(i), { 0, 0 });
+
+            cp.offsets[i] = cp.data.size();
+            cp.data.insert(cp.data.end(), decoded.first.begin(), decoded.first.end());
+            cp.partial[i] = decoded.second;
+        }
+    });
+
+    return ctx.token_code_points;
+}
+
 // returns true iff pos points to the end of one of the definitions of a rule
 static bool whisper_grammar_is_end_of_sequence(const whisper_grammar_element * pos) {
     switch (pos->type) {
@@ -4194,14 +4884,18 @@ static std::vector<whisper_grammar_candidate> whisper_grammar_reject_candidates(
     return rejects;
 }
 
-static struct whisper_grammar whisper_grammar_init(
+static std::shared_ptr<whisper_grammar_compiled> whisper_grammar_compile(
             const whisper_grammar_element ** rules,
                                  size_t      n_rules,
                                  size_t      i_start_rule) {
     const whisper_grammar_element * pos;
 
+    std::shared_ptr<whisper_grammar_compiled> compiled = std::make_shared<whisper_grammar_compiled>();
+
     // copy rule definitions into vectors
-    std::vector<std::vector<whisper_grammar_element>> vec_rules(n_rules);
+    // the stacks point into these vectors, which are not modified anymore
+    auto & vec_rules = compiled->rules;
+    vec_rules.resize(n_rules);
     for (size_t i = 0; i < n_rules; i++) {
         for (pos = rules[i]; pos->type != WHISPER_GRETYPE_END; pos++) {
             vec_rules[i].push_back(*pos);
@@ -4210,7 +4904,7 @@ static struct whisper_grammar whisper_grammar_init(
     }
 
     // loop over alternates of start rule to build initial stacks
-    std::vector<std::vector<const whisper_grammar_element *>> stacks;
+    auto & stacks = compiled->stacks;
     pos = rules[i_start_rule];
     do {
         std::vector<const whisper_grammar_element *> stack;
@@ -4231,7 +4925,46 @@ static struct whisper_grammar whisper_grammar_init(
         }
     } while (true);
 
-    return { std::move(vec_rules), std::move(stacks), {} };
+    return compiled;
+}
+
+static struct whisper_grammar whisper_grammar_init(const std::shared_ptr<whisper_grammar_compiled> & compiled) {
+    return { compiled, compiled->stacks, {} };
+}
+
+// decode the text of the tokens before eot as grammar candidates
+static void whisper_grammar_decode_candidates(
+                                                      whisper_context & ctx,
+                                                 whisper_partial_utf8   partial_utf8,
+    std::vector<std::pair<std::vector<uint32_t>, whisper_partial_utf8>> & candidates_decoded,
+                               std::vector<whisper_grammar_candidate> & candidates_grammar) {
+    const whisper_token eot = whisper_token_eot(&ctx);
+
+    candidates_decoded.clear();
+    candidates_grammar.clear();
+    candidates_grammar.reserve(eot);
+
+    if (partial_utf8.n_remain <= 0) {
+        // the code points do not depend on the previous tokens
+        const auto & cp = whisper_get_token_code_points(ctx);
+
+        for (whisper_token id = 0; id < eot; ++id) {
+            if (ctx.vocab.token_len(id) > 0) {
+                candidates_grammar.push_back({ id, cp.data.data() + cp.offsets[id], cp.partial[id] });
+            }
+        }
+        return;
+    }
+
+    candidates_decoded.reserve(eot);
+
+    for (whisper_token id = 0; id < eot; ++id) {
+        const char * text = ctx.vocab.token_text(id);
+        if (text[0] != '\0') {
+            candidates_decoded.push_back(decode_utf8(text, partial_utf8));
+            candidates_grammar.push_back({ id, candidates_decoded.back().first.data(), candidates_decoded.back().second });
+        }
+    }
 }
 
 static void whisper_suppress_invalid_grammar(
@@ -4240,7 +4973,7 @@ static void whisper_suppress_invalid_grammar(
            std::vector<float> & logits,
     const     whisper_grammar & grammar) {
 
-    if (grammar.rules.empty() || grammar.stacks.empty()) {
+    if (!grammar.compiled || grammar.stacks.empty()) {
         return;
     }
 
@@ -4254,21 +4987,72 @@ static void whisper_suppress_invalid_grammar(
 
     const whisper_token eot = whisper_token_eot(&ctx);
 
+    auto & compiled = *grammar.compiled;
+
     std::vector<std::pair<std::vector<uint32_t>, whisper_partial_utf8>> candidates_decoded;
     std::vector<whisper_grammar_candidate>                              candidates_grammar;
 
-    for (whisper_token id = 0; id < eot; ++id) {
-        const std::string & text = ctx.vocab.id_to_token[id];
-        if (!text.empty()) {
-            candidates_decoded.push_back(decode_utf8(text.c_str(), grammar.partial_utf8));
-            candidates_grammar.push_back({ id, candidates_decoded.back().first.data(), candidates_decoded.back().second });
+    if (grammar.partial_utf8.n_remain > 0) {
+        // the code points of the tokens depend on the pending UTF-8 bytes - walk the stacks
+        whisper_grammar_decode_candidates(ctx, grammar.partial_utf8, candidates_decoded, candidates_grammar);
+
+        const auto rejects = whisper_grammar_reject_candidates(compiled.rules, grammar.stacks, candidates_grammar);
+
+        for (const auto & reject : rejects) {
+            logits[reject.id] -= params.grammar_penalty;
         }
+        return;
     }
 
-    const auto rejects = whisper_grammar_reject_candidates(grammar.rules, grammar.stacks, candidates_grammar);
+    // a token is rejected iff all the stacks reject it
+    const size_t n_words = (eot + 63)/64;
+
+    std::vector<uint64_t> rejected(n_words, ~uint64_t(0));
 
-    for (const auto & reject : rejects) {
-        logits[reject.id] -= params.grammar_penalty;
+    for (const auto & stack : grammar.stacks) {
+        const std::vector<uint64_t> * cached = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(compiled.mutex);
+            const auto it = compiled.rejects.find(stack);
+            if (it != compiled.rejects.end()) {
+                cached = &it->second;
+            }
+        }
+
+        std::vector<uint64_t> rejected_stack;
+        if (cached == nullptr) {
+            if (candidates_grammar.empty()) {
+                whisper_grammar_decode_candidates(ctx, grammar.partial_utf8, candidates_decoded, candidates_grammar);
+            }
+
+            rejected_stack.assign(n_words, 0);
+            for (const auto & reject : whisper_grammar_reject_candidates_for_stack(compiled.rules, stack, candidates_grammar)) {
+                rejected_stack[reject.id/64] |= uint64_t(1) << (reject.id%64);
+            }
+
+            std::lock_guard<std::mutex> lock(compiled.mutex);
+            if (compiled.rejects.size() < WHISPER_GRAMMAR_CACHE_MAX) {
+                cached = &compiled.rejects.emplace(stack, std::move(rejected_stack)).first->second;
+            } else {
+                cached = &rejected_stack;
+            }
+        }
+
+        for (size_t i = 0; i < n_words; ++i) {
+            rejected[i] &= (*cached)[i];
+        }
+    }
+
+    for (size_t i = 0; i < n_words; ++i) {
+        if (rejected[i] == 0) {
+            continue;
+        }
+        for (int j = 0; j < 64; ++j) {
+            const whisper_token id = 64*i + j;
+            if (id < eot && (rejected[i] >> j) & 1) {
+                logits[id] -= params.grammar_penalty;
+            }
+        }
     }
 
     // when the grammar allows a continuation, we penalize the end-of-text token
@@ -4279,25 +5063,35 @@ static void whisper_suppress_invalid_grammar(
 }
 
 static void whisper_grammar_accept_token(whisper_context & ctx, whisper_grammar & grammar, whisper_token token) {
-    if (grammar.rules.empty() || grammar.stacks.empty()) {
+    if (!grammar.compiled || grammar.stacks.empty()) {
         return;
     }
 
-    //fprintf(stderr, "Accept: '%s'\n", ctx.vocab.id_to_token[token].c_str());
+    //fprintf(stderr, "Accept: '%s'\n", ctx.vocab.token_text(token));
 
-    const std::string & text = ctx.vocab.id_to_token[token];
+    const char * text = ctx.vocab.token_text(token);
 
-    if (text.rfind("[_", 0) == 0) {
+    if (strncmp(text, "[_", 2) == 0) {
         // fprintf(stderr, " (skipped)\n");
         return;
     }
     // fprintf(stderr, "\n");
 
+    if (grammar.partial_utf8.n_remain <= 0) {
+        const auto & cp = whisper_get_token_code_points(ctx);
+
+        for (const uint32_t * it = cp.data.data() + cp.offsets[token]; *it != 0; ++it) {
+            grammar.stacks = whisper_grammar_accept(grammar.compiled->rules, grammar.stacks, *it);
+        }
+        grammar.partial_utf8 = cp.partial[token];
+        return;
+    }
+
     // Note terminating 0 in decoded string
-    const auto   decoded     = decode_utf8(text.c_str(), grammar.partial_utf8);
+    const auto   decoded     = decode_utf8(text, grammar.partial_utf8);
     const auto & code_points = decoded.first;
     for (auto it = code_points.begin(), end = code_points.end() - 1; it != end; ++it) {
-        grammar.stacks = whisper_grammar_accept(grammar.rules, grammar.stacks, *it);
+        grammar.stacks = whisper_grammar_accept(grammar.compiled->rules, grammar.stacks, *it);
     }
     grammar.partial_utf8 = decoded.second;
 }
@@ -4353,6 +5147,10 @@ struct whisper_full_params whisper_full_default_params(enum whisper_sampling_str
         /*.debug_mode        =*/ false,
         /*.audio_ctx         =*/ 0,
 
+        /*.skip_silence      =*/ false,
+        /*.silence_thold     =*/ 0.005f,
+        /*.silence_min_ms    =*/ 1000,
+
         /*.tdrz_enable       =*/ false,
 
         /*.initial_prompt    =*/ nullptr,
@@ -4361,6 +5159,7 @@ struct whisper_full_params whisper_full_default_params(enum whisper_sampling_str
 
         /*.language          =*/ "en",
         /*.detect_language   =*/ false,
+        /*.lang_detect_ms    =*/ 0,
 
         /*.suppress_blank    =*/ true,
         /*.suppress_non_speech_tokens =*/ false,
@@ -4403,6 +5202,10 @@ struct whisper_full_params whisper_full_default_params(enum whisper_sampling_str
         /*.n_grammar_rules =*/ 0,
         /*.i_start_rule    =*/ 0,
         /*.grammar_penalty =*/ 100.0f,
+
+        /*.hotwords        =*/ nullptr,
+        /*.n_hotwords      =*/ 0,
+        /*.hotword_boost   =*/ 2.0f,
     };
 
     switch (strategy) {
@@ -4426,13 +5229,26 @@ struct whisper_full_params whisper_full_default_params(enum whisper_sampling_str
 }
 
 // forward declarations
-static std::vector<float> get_signal_energy(const float * signal, int n_samples, int n_samples_per_half_window);
+template <typename T>
+static std::vector<float> get_signal_energy(const T * signal, int n_samples, int n_samples_per_half_window);
+template <typename T>
+static int whisper_find_non_silent_frame(const T * samples, int n_samples, int hop, int seek, int seek_end, float thold);
 static void whisper_exp_compute_token_level_timestamps(
         struct whisper_context & ctx,
           struct whisper_state & state,
                            int   i_segment,
                          float   thold_pt,
-                         float   thold_ptsum);
+                         float   thold_ptsum,
+                          bool   speed_up);
+static void whisper_exp_compute_token_level_timestamps_dtw(
+             struct whisper_context & ctx,
+               struct whisper_state & state,
+    std::vector<whisper_token_data> & tokens,
+   const std::vector<whisper_token> & prompt_init,
+                                int   seek,
+                                int   n_frames,
+                                int   n_threads,
+                               bool   speed_up);
 
 static inline bool should_split_on_word(const char * txt, bool split_on_word) {
     if (!split_on_word) return true;
@@ -4502,6 +5318,115 @@ static const std::vector<std::string> non_speech_tokens = {
     "♪♪♪","♩", "♪", "♫", "♬", "♭", "♮", "♯"
 };
 
+// child of the hotword trie node by token, or -1
+static int whisper_hotwords_next(const whisper_hotwords & hotwords, int node, whisper_token token) {
+    const auto & next = hotwords.nodes[node].next;
+
+    const auto it = std::lower_bound(next.begin(), next.end(), token,
+            [](const std::pair<whisper_token, int32_t> & a, whisper_token b) { return a.first < b; });
+
+    return it != next.end() && it->first == token ? it->second : -1;
+}
+
+// (re)build the trie, unless it was already built from the same phrases by a previous whisper_full() call
+static void whisper_hotwords_init(const whisper_vocab & vocab, whisper_hotwords & hotwords, const char ** phrases, int n_phrases) {
+    std::vector<std::string> list;
+    for (int i = 0; i < n_phrases; ++i) {
+        if (phrases[i] == nullptr) {
+            continue;
+        }
+
+        std::string phrase = phrases[i];
+        phrase.erase(0, std::min(phrase.find_first_not_of(" \t\n"), phrase.size()));
+        if (!phrase.empty()) {
+            list.push_back(std::move(phrase));
+        }
+    }
+
+    if ((int) hotwords.word_start.size() != vocab.n_tokens()) {
+        hotwords.word_start.resize(vocab.n_tokens());
+        for (int i = 0; i < vocab.n_tokens(); ++i) {
+            hotwords.word_start[i] = i >= vocab.token_eot || vocab.token_text(i)[0] == ' ';
+        }
+    }
+
+    if (!hotwords.nodes.empty() && hotwords.phrases == list) {
+        return;
+    }
+
+    hotwords.phrases = std::move(list);
+    hotwords.nodes.assign(1, whisper_hotwords::node());
+    hotwords.depth = 0;
+
+    for (const std::string & phrase : hotwords.phrases) {
+        // as a word, with the leading space: the phrases never start inside a word
+        const auto tokens = tokenize(vocab, " " + phrase);
+
+        int cur = 0;
+        for (const whisper_token token : tokens) {
+            int child = whisper_hotwords_next(hotwords, cur, token);
+            if (child < 0) {
+                child = hotwords.nodes.size();
+                hotwords.nodes.emplace_back();
+
+                auto & next = hotwords.nodes[cur].next;
+                next.insert(std::upper_bound(next.begin(), next.end(), std::make_pair(token, child)), std::make_pair(token, child));
+            }
+            cur = child;
+        }
+
+        hotwords.depth = std::max(hotwords.depth, (int) tokens.size());
+    }
+
+    WHISPER_PRINT_DEBUG("%s: %d hotwords, %d trie nodes, depth %d\n", __func__, (int) hotwords.phrases.size(), (int) hotwords.nodes.size(), hotwords.depth);
+}
+
+// boost the tokens that continue a hotword phrase from the end of the sequence
+// the prefixes matched by the last depth - 1 tokens are live, and the root too when the best next token starts a
+// new word, so the first tokens of the phrases are not pushed inside words and the cost is the number of live
+// prefixes and their children, not the number of phrases
+static void whisper_hotwords_boost(
+        const whisper_hotwords & hotwords,
+        const std::vector<whisper_token_data> & tokens,
+        whisper_token token_eot,
+        float boost,
+        std::vector<float> & logits) {
+    const int n = tokens.size();
+
+    std::vector<int> live;
+
+    const int best = std::max_element(logits.begin(), logits.end()) - logits.begin();
+    if (best >= (int) hotwords.word_start.size() || hotwords.word_start[best]) {
+        live.push_back(0);
+    }
+
+    for (int start = std::max(0, n - hotwords.depth + 1); start < n; ++start) {
+        int cur = 0;
+        for (int i = start; i < n && cur >= 0; ++i) {
+            // special and timestamp tokens break the phrases
+            cur = tokens[i].id < token_eot ? whisper_hotwords_next(hotwords, cur, tokens[i].id) : -1;
+        }
+        if (cur > 0) {
+            live.push_back(cur);
+        }
+    }
+
+    std::vector<whisper_token> boosted;
+    for (const int node : live) {
+        for (const auto & next : hotwords.nodes[node].next) {
+            boosted.push_back(next.first);
+        }
+    }
+
+    // a token continuing several prefixes is boosted once
+    std::sort(boosted.begin(), boosted.end());
+    boosted.erase(std::unique(boosted.begin(), boosted.end()), boosted.end());
+
+    for (const whisper_token token : boosted) {
+        logits[token] += boost;
+    }
+}
+
 // process the logits for the selected decoder
 // - applies logit filters
 // - computes logprobs and probs
@@ -4516,7 +5441,7 @@ static void whisper_process_logits(
     const auto & tokens_cur = decoder.sequence.tokens;
 
     const bool is_initial = tokens_cur.size() == 0;
-    const int  n_logits   = vocab.id_to_token.size();
+    const int  n_logits   = vocab.n_tokens();
 
     WHISPER_ASSERT(n_logits == ctx.vocab.n_vocab);
 
@@ -4547,8 +5472,12 @@ static void whisper_process_logits(
         // https://github.com/openai/whisper/blob/0b1ba3d46ebf7fe6f953acfd8cad62a4f851b49f/whisper/decoding.py#L388-L390
         if (params.suppress_blank) {
             if (is_initial) {
-                logits[vocab.token_eot]           = -INFINITY;
-                logits[vocab.token_to_id.at(" ")] = -INFINITY;
+                logits[vocab.token_eot] = -INFINITY;
+
+                const whisper_token token_space = vocab.find(" ", 1);
+                if (token_space >= 0) {
+                    logits[token_space] = -INFINITY;
+                }
             }
         }
 
@@ -4587,24 +5516,30 @@ static void whisper_process_logits(
             params.logits_filter_callback(&ctx, &state, tokens_cur.data(), tokens_cur.size(), logits.data(), params.logits_filter_callback_user_data);
         }
 
+        // contextual biasing
+        if (params.n_hotwords > 0 && params.hotword_boost != 0.0f && !state.hotwords.nodes.empty()) {
+            whisper_hotwords_boost(state.hotwords, tokens_cur, vocab.token_eot, params.hotword_boost, logits);
+        }
+
         // suppress non-speech tokens
         // ref: https://github.com/openai/whisper/blob/7858aa9c08d98f75575035ecd6481f462d66ca27/whisper/tokenizer.py#L224-L253
         if (params.suppress_non_speech_tokens) {
             for (const std::string & token : non_speech_tokens) {
                 const std::string suppress_tokens[] = {token, " " + token};
                 for (const std::string & suppress_token : suppress_tokens) {
-                    if (vocab.token_to_id.find(suppress_token) != vocab.token_to_id.end()) {
-                        logits[vocab.token_to_id.at(suppress_token)] = -INFINITY;
+                    const whisper_token id = vocab.find(suppress_token);
+                    if (id >= 0) {
+                        logits[id] = -INFINITY;
                     }
                 }
             }
 
             // allow hyphens "-" and single quotes "'" between words, but not at the beginning of a word
-            if (vocab.token_to_id.find(" -") != vocab.token_to_id.end()) {
-                logits[vocab.token_to_id.at(" -")] = -INFINITY;
-            }
-            if (vocab.token_to_id.find(" '") != vocab.token_to_id.end()) {
-                logits[vocab.token_to_id.at(" '")] = -INFINITY;
+            for (const char * suppress_token : { " -", " '" }) {
+                const whisper_token id = vocab.find(suppress_token, 2);
+                if (id >= 0) {
+                    logits[id] = -INFINITY;
+                }
             }
         }
 
@@ -4759,7 +5694,7 @@ static void whisper_process_logits(
         });
 
         for (int i = 0; i < 10; i++) {
-            const auto token   = vocab.id_to_token.at(pairs[i].second);
+            const std::string token = vocab.token_text(pairs[i].second);
             const auto prob    = pairs[i].first;
             const auto logit   = logits[pairs[i].second];
             const auto logprob = logprobs[pairs[i].second];
@@ -4795,7 +5730,7 @@ static whisper_token_data whisper_sample_token(
       const whisper_decoder & decoder,
                        bool   best) {
     whisper_token_data result = {
-        0, 0, 0.0f, 0.0f, 0.0f, 0.0f, -1, -1, 0.0f,
+        0, 0, 0.0f, 0.0f, 0.0f, 0.0f, -1, -1, 0.0f, -1,
     };
 
     const auto & vocab = ctx.vocab;
@@ -4913,7 +5848,7 @@ static std::vector<whisper_token_data> whisper_sample_token_topk(
         const auto id = dist(decoder.rng);
         //printf("XXX %d %d %f %f %f %f\n", id, tid, probs[id], logprobs[id], pt, ptsum);
 
-        result.push_back({ id, tid, probs[id], logprobs[id], pt, ptsum, -1, -1, 0.0f, });
+        result.push_back({ id, tid, probs[id], logprobs[id], pt, ptsum, -1, -1, 0.0f, -1, });
 
         if (result[i].id >= vocab.token_beg) {
             result[i].tid = result[i].id;
@@ -4973,11 +5908,13 @@ static void whisper_sequence_score(
     }
 }
 
-int whisper_full_with_state(
+// the input is either float (samples) or int16 (samples_s16) PCM
+static int whisper_full_with_state_impl(
         struct whisper_context * ctx,
           struct whisper_state * state,
     struct whisper_full_params   params,
                    const float * samples,
+                 const int16_t * samples_s16,
                            int   n_samples) {
     // clear old results
     auto & result_all = state->result_all;
@@ -4987,22 +5924,46 @@ int whisper_full_with_state(
     if (n_samples > 0) {
         // compute log mel spectrogram
         if (params.speed_up) {
-            // TODO: Replace PV with more advanced algorithm
-            WHISPER_LOG_ERROR("%s: failed to compute log mel spectrogram\n", __func__);
-            return -1;
+            const int ret = samples_s16 ?
+                whisper_pcm_to_mel_speed_up(*ctx, *state, samples_s16, n_samples, params.n_threads) :
+                whisper_pcm_to_mel_speed_up(*ctx, *state, samples, n_samples, params.n_threads);
+            if (ret != 0) {
+                WHISPER_LOG_ERROR("%s: failed to compute log mel spectrogram\n", __func__);
+                return -1;
+            }
         } else {
-            if (whisper_pcm_to_mel_with_state(ctx, state, samples, n_samples, params.n_threads) != 0) {
+            const int ret = samples_s16 ?
+                whisper_pcm_to_mel_s16_with_state(ctx, state, samples_s16, n_samples, params.n_threads) :
+                whisper_pcm_to_mel_with_state(ctx, state, samples, n_samples, params.n_threads);
+            if (ret != 0) {
                 WHISPER_LOG_ERROR("%s: failed to compute log mel spectrogram\n", __func__);
                 return -2;
             }
         }
     }
 
+    // overwrite audio_ctx, max allowed is hparams.n_audio_ctx
+    if (params.audio_ctx > whisper_n_audio_ctx(ctx)) {
+        WHISPER_LOG_ERROR("%s: audio_ctx is larger than the maximum allowed (%d > %d)\n", __func__, params.audio_ctx, whisper_n_audio_ctx(ctx));
+        return -5;
+    }
+    state->exp_n_audio_ctx = params.audio_ctx;
+
     // auto-detect language if not specified
     if (params.language == nullptr || strlen(params.language) == 0 || strcmp(params.language, "auto") == 0 || params.detect_language) {
         std::vector<float> probs(whisper_lang_max_id() + 1, 0.0f);
 
+        // encode only the first lang_detect_ms of the audio (1 audio ctx = 20 ms, 40 ms with speed_up)
+        // otherwise the encoder output is reused by the first window of the transcription
+        if (params.lang_detect_ms > 0) {
+            const int n_ctx = params.lang_detect_ms/(params.speed_up ? 40 : 20);
+            state->exp_n_audio_ctx = std::min(std::max(1, n_ctx), whisper_n_audio_ctx(ctx));
+        }
+
         const auto lang_id = whisper_lang_auto_detect_with_state(ctx, state, 0, params.n_threads, probs.data());
+
+        state->exp_n_audio_ctx = params.audio_ctx;
+
         if (lang_id < 0) {
             WHISPER_LOG_ERROR("%s: failed to auto-detect language\n", __func__);
             return -3;
@@ -5021,12 +5982,17 @@ int whisper_full_with_state(
         state->t_last   = 0;
         state->tid_last = 0;
         if (n_samples > 0) {
-            state->energy = get_signal_energy(samples, n_samples, 32);
+            state->energy = samples_s16 ?
+                get_signal_energy(samples_s16, n_samples, 32) :
+                get_signal_energy(samples, n_samples, 32);
         }
     }
 
-    const int seek_start = params.offset_ms/10;
-    const int seek_end = params.duration_ms == 0 ? whisper_n_len_from_state(state) : seek_start + params.duration_ms/10;
+    // a mel frame is 10 ms of the audio, 20 ms with speed_up
+    const int frame_ms = params.speed_up ? 20 : 10;
+
+    const int seek_start = params.offset_ms/frame_ms;
+    const int seek_end = params.duration_ms == 0 ? whisper_n_len_from_state(state) : seek_start + params.duration_ms/frame_ms;
 
     // if length of spectrogram is less than 1.0s (100 frames), then return
     // basically don't process anything that is less than 1.0s
@@ -5088,6 +6054,11 @@ int whisper_full_with_state(
         prompt_past.clear();
     }
 
+    // build the hotword trie, kept in the state for the next calls with the same phrases
+    if (params.n_hotwords > 0 && params.hotword_boost != 0.0f) {
+        whisper_hotwords_init(ctx->vocab, state->hotwords, params.hotwords, params.n_hotwords);
+    }
+
     // prepare prompt
     {
         std::vector<whisper_token> prompt_tokens;
@@ -5110,13 +6081,6 @@ int whisper_full_with_state(
         }
     }
 
-    // overwrite audio_ctx, max allowed is hparams.n_audio_ctx
-    if (params.audio_ctx > whisper_n_audio_ctx(ctx)) {
-        WHISPER_LOG_ERROR("%s: audio_ctx is larger than the maximum allowed (%d > %d)\n", __func__, params.audio_ctx, whisper_n_audio_ctx(ctx));
-        return -5;
-    }
-    state->exp_n_audio_ctx = params.audio_ctx;
-
     // these tokens determine the task that will be performed
     std::vector<whisper_token> prompt_init = { whisper_token_sot(ctx), };
 
@@ -5162,8 +6126,30 @@ int whisper_full_with_state(
     std::vector<std::vector<beam_candidate>> bc_per_dec(n_decoders);
     std::vector<beam_candidate> beam_candidates;
 
+    // the grammar is compiled once, the decoders start each segment from its initial stacks
+    std::shared_ptr<whisper_grammar_compiled> grammar;
+    if (params.grammar_rules != nullptr) {
+        grammar = whisper_grammar_compile(params.grammar_rules, params.n_grammar_rules, params.i_start_rule);
+    }
+
     // main loop
     while (true) {
+        if (params.skip_silence && n_samples > 0) {
+            const int hop = params.speed_up ? 2*WHISPER_HOP_LENGTH : WHISPER_HOP_LENGTH;
+            const int seek_speech = samples_s16 ?
+                whisper_find_non_silent_frame(samples_s16, n_samples, hop, seek, seek_end, params.silence_thold) :
+                whisper_find_non_silent_frame(samples, n_samples, hop, seek, seek_end, params.silence_thold);
+
+            if (seek_speech - seek >= params.silence_min_ms/frame_ms) {
+                // keep 200 ms of silence before the speech
+                const int seek_new = std::max(seek, seek_speech - 200/frame_ms);
+
+                WHISPER_PRINT_DEBUG("%s: skipping silence %d - %d ms\n", __func__, seek*frame_ms, seek_new*frame_ms);
+
+                seek = seek_new;
+            }
+        }
+
         if (params.progress_callback) {
             const int progress_cur = (100*(seek - seek_start))/(seek_end - seek_start);
 
@@ -5241,8 +6227,8 @@ int whisper_full_with_state(
                 decoder.completed = false;
                 decoder.has_ts    = false;
 
-                if (params.grammar_rules != nullptr) {
-                    decoder.grammar = whisper_grammar_init(params.grammar_rules, params.n_grammar_rules, params.i_start_rule);
+                if (grammar != nullptr) {
+                    decoder.grammar = whisper_grammar_init(grammar);
                 } else {
                     decoder.grammar = {};
                 }
@@ -5267,7 +6253,7 @@ int whisper_full_with_state(
                 // print the prompt
                 WHISPER_PRINT_DEBUG("\n\n");
                 for (int i = 0; i < (int) prompt.size(); i++) {
-                    WHISPER_PRINT_DEBUG("%s: prompt[%d] = %s\n", __func__, i, ctx->vocab.id_to_token.at(prompt[i]).c_str());
+                    WHISPER_PRINT_DEBUG("%s: prompt[%d] = %s\n", __func__, i, ctx->vocab.token_text(prompt[i]));
                 }
                 WHISPER_PRINT_DEBUG("\n\n");
 
@@ -5275,7 +6261,7 @@ int whisper_full_with_state(
 
                 whisper_batch_prep_legacy(state->batch, prompt.data(), prompt.size(), 0, 0);
 
-                if (!whisper_decode_internal(*ctx, *state, state->batch, params.n_threads, params.abort_callback, params.abort_callback_user_data)) {
+                if (!whisper_decode_internal(*ctx, *state, state->batch, params.n_threads, false, params.abort_callback, params.abort_callback_user_data)) {
                     WHISPER_LOG_ERROR("%s: failed to decode\n", __func__);
                     return -7;
                 }
@@ -5418,7 +6404,7 @@ int whisper_full_with_state(
                         whisper_kv_cache_seq_cp(state->kv_self, cur.decoder_idx, WHISPER_MAX_DECODERS + j, -1, -1);
 
                         WHISPER_PRINT_DEBUG("%s: beam search: decoder %d: from decoder %d: token = %10s, plog = %8.5f, sum_logprobs = %8.5f\n",
-                                __func__, j, cur.decoder_idx, ctx->vocab.id_to_token.at(decoder.sequence.tokens.back().id).c_str(), decoder.sequence.tokens.back().plog, decoder.sequence.sum_logprobs_all);
+                                __func__, j, cur.decoder_idx, ctx->vocab.token_text(decoder.sequence.tokens.back().id), decoder.sequence.tokens.back().plog, decoder.sequence.sum_logprobs_all);
                     }
 
                     for (int j = 0; j < n_decoders_cur; ++j) {
@@ -5474,9 +6460,9 @@ int whisper_full_with_state(
 
 #ifdef WHISPER_DEBUG
                         {
-                            const auto tt = token.pt > 0.10 ? ctx->vocab.id_to_token.at(token.tid) : "[?]";
+                            const char * tt = token.pt > 0.10 ? ctx->vocab.token_text(token.tid) : "[?]";
                             WHISPER_PRINT_DEBUG("%s: id = %3d, decoder = %d, token = %6d, p = %6.3f, ts = %10s, %6.3f, result_len = %4d '%s'\n",
-                                    __func__, i, j, token.id, token.p, tt.c_str(), token.pt, result_len, ctx->vocab.id_to_token.at(token.id).c_str());
+                                    __func__, i, j, token.id, token.p, tt, token.pt, result_len, ctx->vocab.token_text(token.id));
                         }
 #endif
 
@@ -5572,7 +6558,7 @@ int whisper_full_with_state(
 
                     assert(batch.n_tokens > 0);
 
-                    if (!whisper_decode_internal(*ctx, *state, state->batch, params.n_threads, params.abort_callback, params.abort_callback_user_data)) {
+                    if (!whisper_decode_internal(*ctx, *state, state->batch, params.n_threads, false, params.abort_callback, params.abort_callback_user_data)) {
                         WHISPER_LOG_ERROR("%s: failed to decode\n", __func__);
                         return -8;
                     }
@@ -5686,6 +6672,13 @@ int whisper_full_with_state(
             WHISPER_PRINT_DEBUG("\n%s: failed to decode with temperature = %.2f\n", __func__, t_cur);
         }
 
+        // [EXPERIMENTAL] DTW token timestamps of the best decoder
+        if (ctx->params.dtw_token_timestamps && ctx->model.n_loaded > 0) {
+            whisper_exp_compute_token_level_timestamps_dtw(
+                    *ctx, *state, state->decoders[best_decoder_id].sequence.tokens, prompt_init,
+                    seek, (seek_end - seek)/2, params.n_threads, params.speed_up);
+        }
+
         // output results through a user-provided callback
         {
             const auto & best_decoder = state->decoders[best_decoder_id];
@@ -5755,7 +6748,7 @@ int whisper_full_with_state(
 
                             if (params.token_timestamps) {
                                 whisper_exp_compute_token_level_timestamps(
-                                        *ctx, *state, result_all.size() - 1, params.thold_pt, params.thold_ptsum);
+                                        *ctx, *state, result_all.size() - 1, params.thold_pt, params.thold_ptsum, params.speed_up);
 
                                 if (params.max_len > 0) {
                                     n_new = whisper_wrap_segment(*ctx, *state, params.max_len, params.split_on_word);
@@ -5800,7 +6793,7 @@ int whisper_full_with_state(
 
                     if (params.token_timestamps) {
                         whisper_exp_compute_token_level_timestamps(
-                                *ctx, *state, result_all.size() - 1, params.thold_pt, params.thold_ptsum);
+                                *ctx, *state, result_all.size() - 1, params.thold_pt, params.thold_ptsum, params.speed_up);
 
                         if (params.max_len > 0) {
                             n_new = whisper_wrap_segment(*ctx, *state, params.max_len, params.split_on_word);
@@ -5822,6 +6815,24 @@ int whisper_full_with_state(
     return 0;
 }
 
+int whisper_full_with_state(
+        struct whisper_context * ctx,
+          struct whisper_state * state,
+    struct whisper_full_params   params,
+                   const float * samples,
+                           int   n_samples) {
+    return whisper_full_with_state_impl(ctx, state, params, samples, nullptr, n_samples);
+}
+
+int whisper_full_s16_with_state(
+        struct whisper_context * ctx,
+          struct whisper_state * state,
+    struct whisper_full_params   params,
+                 const int16_t * samples,
+                           int   n_samples) {
+    return whisper_full_with_state_impl(ctx, state, params, nullptr, samples, n_samples);
+}
+
 int whisper_full(
         struct whisper_context * ctx,
     struct whisper_full_params   params,
@@ -5830,14 +6841,96 @@ int whisper_full(
     return whisper_full_with_state(ctx, ctx->state, params, samples, n_samples);
 }
 
-int whisper_full_parallel(
+int whisper_full_s16(
+        struct whisper_context * ctx,
+    struct whisper_full_params   params,
+                 const int16_t * samples,
+                           int   n_samples) {
+    return whisper_full_s16_with_state(ctx, ctx->state, params, samples, n_samples);
+}
+
+// overloads used by the templated whisper_full_parallel_impl()
+static int whisper_full_with_state_any(struct whisper_context * ctx, struct whisper_state * state, struct whisper_full_params params, const float * samples, int n_samples) {
+    return whisper_full_with_state(ctx, state, params, samples, n_samples);
+}
+
+static int whisper_full_with_state_any(struct whisper_context * ctx, struct whisper_state * state, struct whisper_full_params params, const int16_t * samples, int n_samples) {
+    return whisper_full_s16_with_state(ctx, state, params, samples, n_samples);
+}
+
+// find the boundaries of the chunks processed by whisper_full_parallel()
+// each boundary is moved from the uniform split to the quietest 200 ms window nearby, so that the audio
+// is cut in a pause rather than in the middle of a word
+// returns n_processors + 1 sample offsets: [offset_samples, split_1, ..., split_n-1, n_samples]
+template <typename T>
+static std::vector<int> whisper_parallel_split_points(const T * samples, int n_samples, int offset_samples, int n_processors) {
+    const int n_frame  = WHISPER_SAMPLE_RATE/100; // 10 ms
+    const int n_window = 20;                      // frames averaged when looking for silence
+    const int n_min    = 100;                     // min chunk length in frames (whisper_full ignores < 1 s)
+
+    const int n_frames = (n_samples - offset_samples)/n_frame;
+    const int n_frames_per_processor = n_frames/n_processors;
+
+    // look for silence up to 1/4 of the chunk length away from the uniform split, but no more than 10 s
+    const int n_search = std::min(n_frames_per_processor/4, 1000);
+
+    std::vector<float> energy(n_frames, 0.0f);
+    for (int i = 0; i < n_frames; ++i) {
+        const T * frame = samples + offset_samples + i*n_frame;
+        float sum = 0.0f;
+        for (int j = 0; j < n_frame; ++j) {
+            sum += fabsf(whisper_sample_to_f32(frame[j]));
+        }
+        energy[i] = sum;
+    }
+
+    std::vector<int> splits;
+    splits.push_back(offset_samples);
+
+    int f_prev = 0;
+    for (int i = 1; i < n_processors; ++i) {
+        const int f_mid = i*n_frames_per_processor;
+
+        const int f0 = std::max(f_mid - n_search, f_prev + n_min);
+        const int f1 = std::min(f_mid + n_search, n_frames - n_window);
+
+        int f_best = f_mid;
+        if (f0 < f1) {
+            float sum = 0.0f;
+            for (int j = f0; j < f0 + n_window; ++j) {
+                sum += energy[j];
+            }
+
+            float sum_best = sum;
+            f_best = f0 + n_window/2;
+
+            for (int f = f0 + 1; f <= f1; ++f) {
+                sum += energy[f + n_window - 1] - energy[f - 1];
+                if (sum < sum_best) {
+                    sum_best = sum;
+                    f_best = f + n_window/2;
+                }
+            }
+        }
+
+        f_prev = f_best;
+        splits.push_back(offset_samples + f_best*n_frame);
+    }
+
+    splits.push_back(n_samples);
+
+    return splits;
+}
+
+template <typename T>
+static int whisper_full_parallel_impl(
         struct whisper_context * ctx,
         struct whisper_full_params params,
-        const float * samples,
+        const T * samples,
         int n_samples,
         int n_processors) {
     if (n_processors == 1) {
-        return whisper_full(ctx, params, samples, n_samples);
+        return whisper_full_with_state_any(ctx, ctx->state, params, samples, n_samples);
     }
     int ret = 0;
 
@@ -5845,18 +6938,20 @@ int whisper_full_parallel(
     std::vector<whisper_state*> states;
 
     const int offset_samples = (WHISPER_SAMPLE_RATE*params.offset_ms)/1000;
-    const int n_samples_per_processor = (n_samples - offset_samples)/n_processors;
+
+    const std::vector<int> splits = whisper_parallel_split_points(samples, n_samples, offset_samples, n_processors);
 
     // the calling thread will process the first chunk
     // while the other threads will process the remaining chunks
 
+    std::vector<int> rets(n_processors - 1, 0);
     std::vector<std::thread> workers(n_processors - 1);
     for (int i = 0; i < n_processors - 1; ++i) {
         // create a new state for each thread
         states.push_back(whisper_init_state(ctx));
 
-        const int start_samples = offset_samples + (i + 1)*n_samples_per_processor;
-        const int n_samples_cur = (i == n_processors - 2) ? n_samples - start_samples : n_samples_per_processor;
+        const int start_samples = splits[i + 1];
+        const int n_samples_cur = splits[i + 2] - start_samples;
 
         auto params_cur = params;
 
@@ -5870,7 +6965,11 @@ int whisper_full_parallel(
         params_cur.progress_callback = nullptr;
         params_cur.progress_callback_user_data = nullptr;
 
-        workers[i] = std::thread(whisper_full_with_state, ctx, states[i], std::move(params_cur), samples + start_samples, n_samples_cur);
+        whisper_state * state_cur = states[i];
+
+        workers[i] = std::thread([&rets, i, ctx, state_cur, params_cur, samples, start_samples, n_samples_cur]() {
+            rets[i] = whisper_full_with_state_any(ctx, state_cur, params_cur, samples + start_samples, n_samples_cur);
+        });
     }
 
     {
@@ -5880,23 +6979,40 @@ int whisper_full_parallel(
         params_cur.print_realtime = false;
 
         // Run the first transformation using default state but only for the first chunk.
-        ret = whisper_full_with_state(ctx, ctx->state, std::move(params_cur), samples, offset_samples + n_samples_per_processor);
+        ret = whisper_full_with_state_any(ctx, ctx->state, std::move(params_cur), samples, splits[1]);
     }
 
     for (int i = 0; i < n_processors - 1; ++i) {
         workers[i].join();
-    }
 
-    const int64_t offset_t = (int64_t) params.offset_ms/10.0;
+        if (ret == 0) {
+            ret = rets[i];
+        }
+    }
 
     // combine results into result_state->result_all from all other states
     for (int i = 0; i < n_processors - 1; ++i) {
         auto& results_i = states[i]->result_all;
 
+        // the chunks start in silence, so the segments only need to be shifted by the chunk start
+        const int64_t offset_t = (100LL*splits[i + 1])/WHISPER_SAMPLE_RATE;
+
         for (auto& result : results_i) {
             // correct the segment timestamp taking into account the offset
-            result.t0 += 100 * ((i + 1) * n_samples_per_processor) / WHISPER_SAMPLE_RATE + offset_t;
-            result.t1 += 100 * ((i + 1) * n_samples_per_processor) / WHISPER_SAMPLE_RATE + offset_t;
+            result.t0 += offset_t;
+            result.t1 += offset_t;
+
+            for (auto & token : result.tokens) {
+                if (token.t0 >= 0) {
+                    token.t0 += offset_t;
+                }
+                if (token.t1 >= 0) {
+                    token.t1 += offset_t;
+                }
+                if (token.t_dtw >= 0) {
+                    token.t_dtw += offset_t;
+                }
+            }
 
             // make sure that segments are not overlapping
             if (!ctx->state->result_all.empty()) {
@@ -5935,16 +7051,33 @@ int whisper_full_parallel(
     ctx->state->t_decode_us /= n_processors;
 
     // print information about the audio boundaries
-    WHISPER_LOG_WARN("\n");
-    WHISPER_LOG_WARN("%s: the audio has been split into %d chunks at the following times:\n", __func__, n_processors);
+    WHISPER_LOG_INFO("\n");
+    WHISPER_LOG_INFO("%s: the audio has been split into %d chunks at the following times:\n", __func__, n_processors);
     for (int i = 0; i < n_processors - 1; ++i) {
-        WHISPER_LOG_WARN("%s: split %d - %s\n", __func__, (i + 1), to_timestamp(100*((i + 1)*n_samples_per_processor)/WHISPER_SAMPLE_RATE + offset_t).c_str());
+        WHISPER_LOG_INFO("%s: split %d - %s\n", __func__, (i + 1), to_timestamp((100LL*splits[i + 1])/WHISPER_SAMPLE_RATE).c_str());
     }
-    WHISPER_LOG_WARN("%s: the transcription quality may be degraded near these boundaries\n", __func__);
 
     return ret;
 }
 
+int whisper_full_parallel(
+        struct whisper_context * ctx,
+        struct whisper_full_params params,
+        const float * samples,
+        int n_samples,
+        int n_processors) {
+    return whisper_full_parallel_impl(ctx, params, samples, n_samples, n_processors);
+}
+
+int whisper_full_parallel_s16(
+        struct whisper_context * ctx,
+        struct whisper_full_params params,
+        const int16_t * samples,
+        int n_samples,
+        int n_processors) {
+    return whisper_full_parallel_impl(ctx, params, samples, n_samples, n_processors);
+}
+
 int whisper_full_n_segments_from_state(struct whisper_state * state) {
     return state->result_all.size();
 }
@@ -6002,11 +7135,11 @@ int whisper_full_n_tokens(struct whisper_context * ctx, int i_segment) {
 }
 
 const char * whisper_full_get_token_text_from_state(struct whisper_context * ctx, struct whisper_state * state, int i_segment, int i_token) {
-    return ctx->vocab.id_to_token[state->result_all[i_segment].tokens[i_token].id].c_str();
+    return ctx->vocab.token_text(state->result_all[i_segment].tokens[i_token].id);
 }
 
 const char* whisper_full_get_token_text(struct whisper_context * ctx, int i_segment, int i_token) {
-    return ctx->vocab.id_to_token[ctx->state->result_all[i_segment].tokens[i_token].id].c_str();
+    return ctx->vocab.token_text(ctx->state->result_all[i_segment].tokens[i_token].id);
 }
 
 whisper_token whisper_full_get_token_id_from_state(struct whisper_state * state, int i_segment, int i_token) {
@@ -6362,8 +7495,33 @@ static float voice_length(const std::string & text) {
     return res;
 }
 
+// first 10 ms frame in [seek, seek_end) with a mean absolute amplitude above thold (seek_end if none)
+template <typename T>
+static int whisper_find_non_silent_frame(const T * samples, int n_samples, int hop, int seek, int seek_end, float thold) {
+    for (int f = seek; f < seek_end; ++f) {
+        const int i0 = f*hop;
+        const int i1 = std::min(i0 + hop, n_samples);
+
+        if (i0 >= n_samples) {
+            break;
+        }
+
+        float sum = 0.0f;
+        for (int i = i0; i < i1; ++i) {
+            sum += fabsf(whisper_sample_to_f32(samples[i]));
+        }
+
+        if (sum > thold*(i1 - i0)) {
+            return f;
+        }
+    }
+
+    return seek_end;
+}
+
 // average the fabs of the signal
-static std::vector<float> get_signal_energy(const float * signal, int n_samples, int n_samples_per_half_window) {
+template <typename T>
+static std::vector<float> get_signal_energy(const T * signal, int n_samples, int n_samples_per_half_window) {
     const int hw = n_samples_per_half_window;
 
     std::vector<float> result(n_samples);
@@ -6372,7 +7530,7 @@ static std::vector<float> get_signal_energy(const float * signal, int n_samples,
         float sum = 0;
         for (int j = -hw; j <= hw; j++) {
             if (i + j >= 0 && i + j < n_samples) {
-                sum += fabs(signal[i + j]);
+                sum += fabs(whisper_sample_to_f32(signal[i + j]));
             }
         }
         result[i] = sum/(2*hw + 1);
@@ -6386,7 +7544,8 @@ static void whisper_exp_compute_token_level_timestamps(
           struct whisper_state & state,
                            int   i_segment,
                          float   thold_pt,
-                         float   thold_ptsum) {
+                         float   thold_ptsum,
+                          bool   speed_up) {
     auto & segment = state.result_all[i_segment];
     auto & tokens  = segment.tokens;
 
@@ -6434,7 +7593,8 @@ static void whisper_exp_compute_token_level_timestamps(
             }
         }
 
-        const int64_t tt = t_beg + 2*(token.tid - whisper_token_beg(&ctx));
+        // a timestamp token is 20 ms of the encoder input, 40 ms of the audio with speed_up
+        const int64_t tt = t_beg + (speed_up ? 4 : 2)*(token.tid - whisper_token_beg(&ctx));
 
         tokens[j].id    = token.id;
         tokens[j].tid   = token.tid;
@@ -6614,6 +7774,219 @@ static void whisper_exp_compute_token_level_timestamps(
     //}
 }
 
+//
+// token-level timestamps with DTW
+//
+// the text tokens are aligned with the audio frames through the cross-attention weights of the
+// alignment heads, following the find_alignment() of openai/whisper
+//
+
+// median filter along the rows of a [n_rows][n] matrix, reflect padding
+static void whisper_median_filter(std::vector<float> & data, int n_rows, int n, int width) {
+    const int hw = width/2;
+    if (n <= hw) {
+        return;
+    }
+
+    std::vector<float> row(n);
+    std::vector<float> win(width);
+
+    for (int r = 0; r < n_rows; ++r) {
+        float * x = data.data() + (size_t) r*n;
+        std::copy(x, x + n, row.begin());
+
+        for (int i = 0; i < n; ++i) {
+            for (int k = -hw; k <= hw; ++k) {
+                int j = i + k;
+                if (j < 0) {
+                    j = -j;
+                } else if (j >= n) {
+                    j = 2*(n - 1) - j;
+                }
+                win[k + hw] = row[j];
+            }
+            std::nth_element(win.begin(), win.begin() + hw, win.end());
+            x[i] = win[hw];
+        }
+    }
+}
+
+// dynamic time warping over a [n_rows][n_cols] cost matrix
+// returns the first column reached by each row of the optimal path
+static std::vector<int> whisper_dtw_jumps(const std::vector<float> & cost_in, int n_rows, int n_cols) {
+    const int N = n_rows;
+    const int M = n_cols;
+
+    std::vector<float>  cost((size_t) (N + 1)*(M + 1), INFINITY);
+    std::vector<int8_t> trace((size_t) (N + 1)*(M + 1), -1);
+
+    cost[0] = 0.0f;
+
+    for (int j = 1; j <= M; ++j) {
+        for (int i = 1; i <= N; ++i) {
+            const float c0 = cost[(size_t) (i - 1)*(M + 1) + j - 1];
+            const float c1 = cost[(size_t) (i - 1)*(M + 1) + j];
+            const float c2 = cost[(size_t) i*(M + 1) + j - 1];
+
+            float c;
+            int8_t t;
+            if (c0 < c1 && c0 < c2) {
+                c = c0; t = 0;
+            } else if (c1 < c0 && c1 < c2) {
+                c = c1; t = 1;
+            } else {
+                c = c2; t = 2;
+            }
+
+            cost [(size_t) i*(M + 1) + j] = cost_in[(size_t) (i - 1)*M + j - 1] + c;
+            trace[(size_t) i*(M + 1) + j] = t;
+        }
+    }
+
+    for (int j = 0; j <= M; ++j) {
+        trace[j] = 2;
+    }
+    for (int i = 0; i <= N; ++i) {
+        trace[(size_t) i*(M + 1)] = 1;
+    }
+
+    // backtrace, the path is visited in reverse so the last write of a row is its first column
+    std::vector<int> jumps(N, 0);
+
+    int i = N;
+    int j = M;
+    while (i > 0 || j > 0) {
+        if (i > 0) {
+            jumps[i - 1] = std::max(0, j - 1);
+        }
+        switch (trace[(size_t) i*(M + 1) + j]) {
+            case 0:  --i; --j; break;
+            case 1:  --i;      break;
+            default:      --j; break;
+        }
+    }
+
+    return jumps;
+}
+
+static void whisper_exp_compute_token_level_timestamps_dtw(
+             struct whisper_context & ctx,
+               struct whisper_state & state,
+    std::vector<whisper_token_data> & tokens,
+   const std::vector<whisper_token> & prompt_init,
+                                int   seek,
+                                int   n_frames,
+                                int   n_threads,
+                               bool   speed_up) {
+    const int n_aheads = state.aheads.size();
+    if (n_aheads == 0) {
+        return;
+    }
+
+    const whisper_token token_eot = whisper_token_eot(&ctx);
+    const whisper_token token_not = whisper_token_not(&ctx);
+
+    // sot sequence + no_timestamps + text tokens + eot
+    std::vector<whisper_token> seq = prompt_init;
+    if (seq.back() != token_not) {
+        seq.push_back(token_not);
+    }
+    const int i_not = seq.size() - 1;
+
+    std::vector<int> idx_text;
+    for (int i = 0; i < (int) tokens.size(); ++i) {
+        if (tokens[i].id < token_eot) {
+            idx_text.push_back(i);
+            seq.push_back(tokens[i].id);
+        }
+    }
+    seq.push_back(token_eot);
+
+    const int n_text   = idx_text.size();
+    const int n_tokens = seq.size();
+
+    if (n_text == 0 || n_tokens > ctx.model.hparams.n_text_ctx) {
+        return;
+    }
+
+    whisper_kv_cache_clear(state.kv_self);
+    whisper_batch_prep_legacy(state.batch, seq.data(), n_tokens, 0, 0);
+
+    if (!whisper_decode_internal(ctx, state, state.batch, n_threads, true, nullptr, nullptr) || !state.aheads_cross_QKs) {
+        WHISPER_LOG_ERROR("%s: failed to decode the alignment heads\n", __func__);
+        return;
+    }
+
+    const int n_audio_ctx = state.aheads_cross_QKs->ne[0];
+    const int M = std::min(n_audio_ctx, n_frames);
+
+    if (M <= 0) {
+        return;
+    }
+
+    std::vector<float> qks(wsp_ggml_nelements(state.aheads_cross_QKs));
+    wsp_ggml_backend_tensor_get(state.aheads_cross_QKs, qks.data(), 0, wsp_ggml_nbytes(state.aheads_cross_QKs));
+
+    // the rows from the no_timestamps token to the last text token predict the text tokens
+    const int n_rows = n_text + 1;
+
+    std::vector<float> matrix((size_t) n_rows*M, 0.0f);
+    std::vector<float> w((size_t) n_tokens*M);
+
+    for (int h = 0; h < n_aheads; ++h) {
+        const float * src = qks.data() + (size_t) h*n_tokens*n_audio_ctx;
+
+        // the audio past the end of the window is padding, renormalize the weights over the window
+        for (int t = 0; t < n_tokens; ++t) {
+            float sum = 0.0f;
+            for (int f = 0; f < M; ++f) {
+                sum += src[(size_t) t*n_audio_ctx + f];
+            }
+            const float scale = sum > 0.0f ? 1.0f/sum : 0.0f;
+            for (int f = 0; f < M; ++f) {
+                w[(size_t) t*M + f] = src[(size_t) t*n_audio_ctx + f]*scale;
+            }
+        }
+
+        // standardize each frame over the tokens
+        for (int f = 0; f < M; ++f) {
+            double mean = 0.0;
+            for (int t = 0; t < n_tokens; ++t) {
+                mean += w[(size_t) t*M + f];
+            }
+            mean /= n_tokens;
+
+            double var = 0.0;
+            for (int t = 0; t < n_tokens; ++t) {
+                const double d = w[(size_t) t*M + f] - mean;
+                var += d*d;
+            }
+            const float inv_std = var > 0.0 ? 1.0f/sqrt(var/n_tokens) : 0.0f;
+
+            for (int t = 0; t < n_tokens; ++t) {
+                w[(size_t) t*M + f] = (w[(size_t) t*M + f] - mean)*inv_std;
+            }
+        }
+
+        whisper_median_filter(w, n_tokens, M, 7);
+
+        for (int r = 0; r < n_rows; ++r) {
+            const float * row = w.data() + (size_t) (i_not + r)*M;
+            for (int f = 0; f < M; ++f) {
+                matrix[(size_t) r*M + f] -= row[f]/n_aheads;
+            }
+        }
+    }
+
+    const std::vector<int> jumps = whisper_dtw_jumps(matrix, n_rows, M);
+
+    // one audio frame is 20 ms
+    for (int k = 0; k < n_text; ++k) {
+        const int64_t t = seek + 2*jumps[k];
+        tokens[idx_text[k]].t_dtw = speed_up ? 2*t : t;
+    }
+}
+
 void whisper_log_set(wsp_ggml_log_callback log_callback, void * user_data) {
     g_state.log_callback = log_callback ? log_callback : whisper_log_callback_default;
     g_state.log_callback_user_data = user_data;
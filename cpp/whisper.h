@@ -34,6 +34,10 @@
 #define WHISPER_HOP_LENGTH  160
 #define WHISPER_CHUNK_SIZE  30
 
+// flag of the ftype of mixed precision model files: the hparams are followed by a table of
+// (tensor name, wsp_ggml_type) for the tensors stored in another type than the one of the ftype
+#define WHISPER_FTYPE_MIXED 0x100
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -84,9 +88,36 @@ extern "C" {
     typedef int32_t whisper_token;
     typedef int32_t whisper_seq_id;
 
+    // cross-attention heads aligned with the audio, used for the DTW token timestamps
+    typedef struct whisper_ahead {
+        int n_text_layer;
+        int n_head;
+    } whisper_ahead;
+
+    enum whisper_alignment_heads_preset {
+        WHISPER_AHEADS_NONE,
+        WHISPER_AHEADS_N_TOP_MOST,  // all heads of the dtw_n_top top-most text layers
+        WHISPER_AHEADS_TINY_EN,
+        WHISPER_AHEADS_TINY,
+        WHISPER_AHEADS_BASE_EN,
+        WHISPER_AHEADS_BASE,
+        WHISPER_AHEADS_SMALL_EN,
+        WHISPER_AHEADS_SMALL,
+        WHISPER_AHEADS_MEDIUM_EN,
+        WHISPER_AHEADS_MEDIUM,
+        WHISPER_AHEADS_LARGE_V1,
+        WHISPER_AHEADS_LARGE_V2,
+        WHISPER_AHEADS_LARGE_V3,
+    };
+
     struct whisper_context_params {
         bool  use_gpu;
         bool  use_coreml;
+
+        // [EXPERIMENTAL] token-level timestamps with DTW over the cross-attention of the alignment heads
+        bool  dtw_token_timestamps;
+        enum whisper_alignment_heads_preset dtw_aheads_preset;
+        int   dtw_n_top; // number of top-most text layers used by WHISPER_AHEADS_N_TOP_MOST (<= 0 - all)
     };
 
     typedef struct whisper_token_data {
@@ -104,6 +135,9 @@ extern "C" {
         int64_t t1;        //   end time of the token
 
         float vlen;        // voice length of the token
+
+        // [EXPERIMENTAL] token time from the DTW alignment, -1 if not computed
+        int64_t t_dtw;
     } whisper_token_data;
 
     typedef struct whisper_model_loader {
@@ -224,7 +258,22 @@ extern "C" {
                                int   n_samples,
                                int   n_threads);
 
-    // Convert RAW PCM audio to log mel spectrogram but applies a Phase Vocoder to speed up the audio x2.
+    // Same as whisper_pcm_to_mel(), but with 16-bit PCM audio.
+    // The samples are converted to float while padding, without an intermediate float buffer.
+    WHISPER_API int whisper_pcm_to_mel_s16(
+            struct whisper_context * ctx,
+                     const int16_t * samples,
+                               int   n_samples,
+                               int   n_threads);
+
+    WHISPER_API int whisper_pcm_to_mel_s16_with_state(
+            struct whisper_context * ctx,
+              struct whisper_state * state,
+                     const int16_t * samples,
+                               int   n_samples,
+                               int   n_threads);
+
+    // Convert RAW PCM audio to log mel spectrogram but speeds up the audio x2 first (WSOLA, the name is kept for compatibility).
     // The resulting spectrogram is stored inside the default state of the provided whisper context.
     // Returns 0 on success
     WHISPER_API int whisper_pcm_to_mel_phase_vocoder(
@@ -458,10 +507,15 @@ extern "C" {
 
         // [EXPERIMENTAL] speed-up techniques
         // note: these can significantly reduce the quality of the output
-        bool speed_up;          // speed-up the audio by 2x using Phase Vocoder
+        bool speed_up;          // speed-up the audio by 2x using WSOLA (the timestamps are in the original time)
         bool debug_mode;        // enable debug_mode provides extra info (eg. Dump log_mel)
         int  audio_ctx;         // overwrite the audio context size (0 = use default)
 
+        // skip silent audio without running the encoder/decoder (needs the PCM samples)
+        bool  skip_silence;     // advance past silent parts of the audio
+        float silence_thold;    // mean absolute amplitude below which a 10 ms frame is silent (~0.005)
+        int   silence_min_ms;   // minimum length of the silent parts to skip in ms
+
         // [EXPERIMENTAL] [TDRZ] tinydiarize
         bool tdrz_enable;       // enable tinydiarize speaker turn detection
 
@@ -474,6 +528,7 @@ extern "C" {
         // for auto-detection, set to nullptr, "" or "auto"
         const char * language;
         bool detect_language;
+        int  lang_detect_ms;    // audio used to auto-detect the language in ms (0 = the first 30 s window, reused by the transcription)
 
         // common decoding parameters:
         bool suppress_blank;    // ref: https://github.com/openai/whisper/blob/f82bc59f5ea234d4b97fb2860842ed38519f7e65/whisper/decoding.py#L89
@@ -524,6 +579,12 @@ extern "C" {
         size_t                           n_grammar_rules;
         size_t                           i_start_rule;
         float                            grammar_penalty;
+
+        // contextual biasing: the tokens continuing one of the phrases get hotword_boost added to their logits
+        // the phrases are words or short phrases likely to be spoken (names, commands, ...)
+        const char ** hotwords;
+        int           n_hotwords;
+        float         hotword_boost;
     };
 
     // NOTE: this function allocates memory, and it is the responsibility of the caller to free the pointer - see whisper_free_context_params & whisper_free_params()
@@ -549,10 +610,11 @@ extern "C" {
                                    int   n_samples);
 
     // Split the input audio in chunks and process each chunk separately using whisper_full_with_state()
+    // The chunk boundaries are placed in the quietest part of the audio near the uniform split points,
+    // so words are not cut in half and the segment timestamps are shifted by the actual chunk start.
     // Result is stored in the default state of the context
     // Not thread safe if executed in parallel on the same context.
-    // It seems this approach can offer some speedup in some cases.
-    // However, the transcription accuracy can be worse at the beginning and end of each chunk.
+    // Each chunk uses its own whisper_state (sharing the model), so memory usage grows with n_processors.
     WHISPER_API int whisper_full_parallel(
                 struct whisper_context * ctx,
             struct whisper_full_params   params,
@@ -560,6 +622,27 @@ extern "C" {
                                    int   n_samples,
                                    int   n_processors);
 
+    // Same as whisper_full(), whisper_full_with_state() and whisper_full_parallel(), but with 16-bit PCM audio
+    WHISPER_API int whisper_full_s16(
+                struct whisper_context * ctx,
+            struct whisper_full_params   params,
+                         const int16_t * samples,
+                                   int   n_samples);
+
+    WHISPER_API int whisper_full_s16_with_state(
+                struct whisper_context * ctx,
+                  struct whisper_state * state,
+            struct whisper_full_params   params,
+                         const int16_t * samples,
+                                   int   n_samples);
+
+    WHISPER_API int whisper_full_parallel_s16(
+                struct whisper_context * ctx,
+            struct whisper_full_params   params,
+                         const int16_t * samples,
+                                   int   n_samples,
+                                   int   n_processors);
+
     // Number of generated text segments
     // A segment can be a few words, a sentence, or even a paragraph.
     WHISPER_API int whisper_full_n_segments           (struct whisper_context * ctx);
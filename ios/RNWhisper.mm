@@ -50,6 +50,8 @@ RCT_REMAP_METHOD(initContext,
     BOOL isBundleAsset = [[modelOptions objectForKey:@"isBundleAsset"] boolValue];
     BOOL useGpu = [[modelOptions objectForKey:@"useGpu"] boolValue];
     BOOL useCoreMLIos = [[modelOptions objectForKey:@"useCoreMLIos"] boolValue];
+    NSString *dtwPreset = [modelOptions objectForKey:@"dtwPreset"];
+    int dtwNTop = [modelOptions objectForKey:@"dtwNTop"] != nil ? [[modelOptions objectForKey:@"dtwNTop"] intValue] : -1;
 
     // For support debug assets in development mode
     BOOL downloadCoreMLAssets = [[modelOptions objectForKey:@"downloadCoreMLAssets"] boolValue];
@@ -79,6 +81,8 @@ RCT_REMAP_METHOD(initContext,
         contextId:contextId
         noCoreML:!useCoreMLIos
         noMetal:!useGpu
+        dtwPreset:dtwPreset
+        dtwNTop:dtwNTop
     ];
     if ([context getContext] == NULL) {
         reject(@"whisper_cpp_error", @"Failed to load the model", nil);
@@ -132,7 +136,7 @@ RCT_REMAP_METHOD(transcribeFile,
     }
 
     int count = 0;
-    float *waveFile = [RNWhisperAudioUtils decodeWaveFile:path count:&count];
+    short *waveFile = [RNWhisperAudioUtils decodeWaveFile:path count:&count];
     if (waveFile == nil) {
         reject(@"whisper_error", @"Invalid file", nil);
         return;
@@ -176,7 +180,7 @@ RCT_REMAP_METHOD(transcribeFile,
                 return;
             }
             free(waveFile);
-            NSMutableDictionary *result = [context getTextSegments];
+            NSMutableDictionary *result = [context getTextSegments:[options[@"tokenTimestamps"] boolValue]];
             result[@"isAborted"] = @([context isStoppedByAction]);
             resolve(result);
         }
@@ -2,6 +2,6 @@
 
 @interface RNWhisperAudioUtils : NSObject
 
-+ (float *)decodeWaveFile:(NSString*)filePath count:(int *)count;
++ (short *)decodeWaveFile:(NSString*)filePath count:(int *)count;
 
 @end
@@ -42,7 +42,7 @@ typedef struct {
     bool isMetalEnabled;
 }
 
-+ (instancetype)initWithModelPath:(NSString *)modelPath contextId:(int)contextId noCoreML:(BOOL)noCoreML noMetal:(BOOL)noMetal;
++ (instancetype)initWithModelPath:(NSString *)modelPath contextId:(int)contextId noCoreML:(BOOL)noCoreML noMetal:(BOOL)noMetal dtwPreset:(NSString *)dtwPreset dtwNTop:(int)dtwNTop;
 - (bool)isMetalEnabled;
 - (NSString *)reasonNoMetal;
 - (struct whisper_context *)getContext;
@@ -51,7 +51,7 @@ typedef struct {
     options:(NSDictionary *)options
     onTranscribe:(void (^)(int, NSString *, NSDictionary *))onTranscribe;
 - (void)transcribeFile:(int)jobId
-    audioData:(float *)audioData
+    audioData:(short *)audioData
     audioDataCount:(int)audioDataCount
     options:(NSDictionary *)options
     onProgress:(void (^)(int))onProgress
@@ -62,7 +62,7 @@ typedef struct {
 - (bool)isCapturing;
 - (bool)isTranscribing;
 - (bool)isStoppedByAction;
-- (NSMutableDictionary *)getTextSegments;
+- (NSMutableDictionary *)getTextSegments:(bool)withTokens;
 - (void)invalidate;
 
 @end
@@ -10,10 +10,12 @@
     contextId:(int)contextId
     noCoreML:(BOOL)noCoreML
     noMetal:(BOOL)noMetal
+    dtwPreset:(NSString *)dtwPreset
+    dtwNTop:(int)dtwNTop
 {
     RNWhisperContext *context = [[RNWhisperContext alloc] init];
     context->contextId = contextId;
-    struct whisper_context_params cparams;
+    struct whisper_context_params cparams = whisper_context_default_params();
     NSString *reasonNoMetal = @"";
     cparams.use_gpu = !noMetal;
 
@@ -63,6 +65,10 @@
     }
 #endif // WSP_GGML_USE_METAL
 
+    if (dtwPreset != nil) {
+        rnwhisper::set_dtw_params(cparams, [dtwPreset UTF8String], dtwNTop);
+    }
+
     if (cparams.use_gpu && cparams.use_coreml) {
         NSLog(@"[RNWhisper] Both use_gpu and use_coreml are enabled, ignoring use_coreml option");
         cparams.use_coreml = false; // Skip CoreML if Metal is enabled
@@ -119,12 +125,15 @@
     self->recordState.sliceNSamples.push_back(0);
 
     self->recordState.job = rnwhisper::job_new(jobId, [self createParams:options jobId:jobId]);
+    [self setHotwords:self->recordState.job options:options];
+    self->recordState.job->use_agreement = options[@"realtimeLocalAgreement"] != nil ? [options[@"realtimeLocalAgreement"] boolValue] : false;
     self->recordState.job->set_realtime_params(
         {
             .use_vad = options[@"useVad"] != nil ? [options[@"useVad"] boolValue] : false,
             .vad_ms = options[@"vadMs"] != nil ? [options[@"vadMs"] intValue] : 2000,
             .vad_thold = options[@"vadThold"] != nil ? [options[@"vadThold"] floatValue] : 0.6f,
-            .freq_thold = options[@"vadFreqThold"] != nil ? [options[@"vadFreqThold"] floatValue] : 100.0f
+            .freq_thold = options[@"vadFreqThold"] != nil ? [options[@"vadFreqThold"] floatValue] : 100.0f,
+            .mode = [options[@"vadMode"] isEqualToString:@"spectral"] ? rnwhisper::VAD_MODE_SPECTRAL : rnwhisper::VAD_MODE_ENERGY
         },
         options[@"realtimeAudioSec"] != nil ? [options[@"realtimeAudioSec"] intValue] : 0,
         options[@"realtimeAudioSliceSec"] != nil ? [options[@"realtimeAudioSliceSec"] intValue] : 0,
@@ -139,7 +148,7 @@
 bool vad(RNWhisperContextRecordState *state, int sliceIndex, int nSamples, int n)
 {
     if (state->isTranscribing) return true;
-    return state->job->vad_simple(sliceIndex, nSamples, n);
+    return state->job->vad_detect(sliceIndex, nSamples, n);
 }
 
 void AudioInputCallback(void * inUserData,
@@ -236,16 +245,19 @@ void AudioInputCallback(void * inUserData,
     rnwhisper::job_remove(state->job->job_id);
 }
 
+static NSString *agreementText(const std::string &text) {
+    NSString *str = [[NSString alloc] initWithBytes:text.data() length:text.size() encoding:NSUTF8StringEncoding];
+    // nil if the text holds a part of a UTF-8 character, which would throw in stringByAppendingString
+    return str != nil ? str : @"";
+}
+
 - (void)fullTranscribeSamples:(RNWhisperContextRecordState*) state {
     int nSamplesOfIndex = state->sliceNSamples[state->transcribeSliceIndex];
     state->nSamplesTranscribing = nSamplesOfIndex;
     NSLog(@"[RNWhisper] Transcribing %d samples", state->nSamplesTranscribing);
 
-    float* pcmf32 = state->job->pcm_slice_to_f32(state->transcribeSliceIndex, state->nSamplesTranscribing);
-
     CFTimeInterval timeStart = CACurrentMediaTime();
-    int code = [state->mSelf fullTranscribe:state->job audioData:pcmf32 audioDataCount:state->nSamplesTranscribing];
-    free(pcmf32);
+    int code = [state->mSelf fullTranscribeRealtime:state->job sliceIndex:state->transcribeSliceIndex nSamples:state->nSamplesTranscribing];
     CFTimeInterval timeEnd = CACurrentMediaTime();
     const float timeRecording = (float) state->nSamplesTranscribing / (float) state->dataFormat.mSampleRate;
 
@@ -260,7 +272,27 @@ void AudioInputCallback(void * inUserData,
     NSMutableDictionary* result = [base mutableCopy];
 
     if (code == 0) {
-        result[@"data"] = [state->mSelf getTextSegments];
+        NSMutableDictionary *data = [state->mSelf getTextSegments:state->job->params.token_timestamps];
+        if (state->job->use_agreement) {
+            // segments only cover the audio after the committed segments
+            NSString *committed = agreementText(state->job->agreement.committed);
+            NSString *tentative = agreementText(state->job->agreement.tentative);
+            data[@"result"] = [committed stringByAppendingString:tentative];
+            data[@"committed"] = committed;
+            data[@"tentative"] = tentative;
+        }
+        result[@"data"] = data;
+        std::vector<rnwhisper::vad_segment> speechSegments = state->job->vad_segments(state->transcribeSliceIndex);
+        if (!speechSegments.empty()) {
+            NSMutableArray *segments = [[NSMutableArray alloc] init];
+            for (size_t i = 0; i < speechSegments.size(); i++) {
+                [segments addObject:@{
+                    @"start": @(speechSegments[i].start),
+                    @"end": @(speechSegments[i].end),
+                }];
+            }
+            result[@"speechSegments"] = segments;
+        }
     } else {
         result[@"error"] = [NSString stringWithFormat:@"Transcribe failed with code %d", code];
     }
@@ -352,10 +384,72 @@ void AudioInputCallback(void * inUserData,
 struct rnwhisper_segments_callback_data {
     void (^onNewSegments)(NSDictionary *);
     int total_n_new;
+    bool with_tokens;
 };
 
+template <typename T>
+static T readValue(const uint8_t *&ptr) {
+    T value;
+    memcpy(&value, ptr, sizeof(T));
+    ptr += sizeof(T);
+    return value;
+}
+
+static NSString *readText(const uint8_t *&ptr) {
+    const int32_t length = readValue<int32_t>(ptr);
+    NSString *text = [[NSString alloc] initWithBytes:ptr length:length encoding:NSUTF8StringEncoding];
+    ptr += length;
+    // a token may hold a part of a UTF-8 character
+    return text != nil ? text : @"";
+}
+
+// Segments [start, end) of the last transcription, fetched in one call (see rnwhisper::serialize_segments)
+static NSMutableDictionary *rnwhisper_get_text_segments(struct whisper_context *ctx, int start, int end, bool withTokens) {
+    std::vector<uint8_t> buffer;
+    rnwhisper::serialize_segments(ctx, start, end, withTokens, buffer);
+    const uint8_t *ptr = buffer.data();
+
+    NSString *text = @"";
+    NSMutableArray *segments = [[NSMutableArray alloc] init];
+    const int32_t n_segments = readValue<int32_t>(ptr);
+    for (int i = 0; i < n_segments; i++) {
+        const int64_t t0 = readValue<int64_t>(ptr);
+        const int64_t t1 = readValue<int64_t>(ptr);
+        NSString *text_cur = readText(ptr);
+        text = [text stringByAppendingString:text_cur];
+
+        NSMutableDictionary *segment = [@{
+            @"text": text_cur,
+            @"t0": [NSNumber numberWithLongLong:t0],
+            @"t1": [NSNumber numberWithLongLong:t1]
+        } mutableCopy];
+
+        const int32_t n_tokens = readValue<int32_t>(ptr);
+        if (withTokens) {
+            NSMutableArray *tokens = [[NSMutableArray alloc] init];
+            for (int j = 0; j < n_tokens; j++) {
+                NSMutableDictionary *token = [[NSMutableDictionary alloc] init];
+                token[@"id"] = [NSNumber numberWithInt:readValue<int32_t>(ptr)];
+                token[@"p"] = [NSNumber numberWithFloat:readValue<float>(ptr)];
+                token[@"t0"] = [NSNumber numberWithLongLong:readValue<int64_t>(ptr)];
+                token[@"t1"] = [NSNumber numberWithLongLong:readValue<int64_t>(ptr)];
+                const int64_t t_dtw = readValue<int64_t>(ptr);
+                if (t_dtw >= 0) token[@"tDtw"] = [NSNumber numberWithLongLong:t_dtw];
+                token[@"text"] = readText(ptr);
+                [tokens addObject:token];
+            }
+            segment[@"tokens"] = tokens;
+        }
+        [segments addObject:segment];
+    }
+    NSMutableDictionary *result = [[NSMutableDictionary alloc] init];
+    result[@"result"] = text;
+    result[@"segments"] = segments;
+    return result;
+}
+
 - (void)transcribeFile:(int)jobId
-    audioData:(float *)audioData
+    audioData:(short *)audioData
     audioDataCount:(int)audioDataCount
     options:(NSDictionary *)options
     onProgress:(void (^)(int))onProgress
@@ -381,39 +475,25 @@ struct rnwhisper_segments_callback_data {
                 struct rnwhisper_segments_callback_data *data = (struct rnwhisper_segments_callback_data *)user_data;
                 data->total_n_new += n_new;
 
-                NSString *text = @"";
-                NSMutableArray *segments = [[NSMutableArray alloc] init];
-                for (int i = data->total_n_new - n_new; i < data->total_n_new; i++) {
-                    const char * text_cur = whisper_full_get_segment_text(ctx, i);
-                    text = [text stringByAppendingString:[NSString stringWithUTF8String:text_cur]];
-
-                    const int64_t t0 = whisper_full_get_segment_t0(ctx, i);
-                    const int64_t t1 = whisper_full_get_segment_t1(ctx, i);
-                    NSDictionary *segment = @{
-                        @"text": [NSString stringWithUTF8String:text_cur],
-                        @"t0": [NSNumber numberWithLongLong:t0],
-                        @"t1": [NSNumber numberWithLongLong:t1]
-                    };
-                    [segments addObject:segment];
-                }
-
-                NSDictionary *result = @{
-                    @"nNew": [NSNumber numberWithInt:n_new],
-                    @"totalNNew": [NSNumber numberWithInt:data->total_n_new],
-                    @"result": text,
-                    @"segments": segments
-                };
+                NSMutableDictionary *result = rnwhisper_get_text_segments(ctx, data->total_n_new - n_new, data->total_n_new, data->with_tokens);
+                result[@"nNew"] = [NSNumber numberWithInt:n_new];
+                result[@"totalNNew"] = [NSNumber numberWithInt:data->total_n_new];
                 void (^onNewSegments)(NSDictionary *) = (void (^)(NSDictionary *))data->onNewSegments;
                 onNewSegments(result);
             };
             struct rnwhisper_segments_callback_data user_data = {
                 .onNewSegments = onNewSegments,
-                .total_n_new = 0
+                .total_n_new = 0,
+                .with_tokens = params.token_timestamps
             };
             params.new_segment_callback_user_data = &user_data;
         }
 
-        rnwhisper::job* job = rnwhisper::job_new(jobId, params);;
+        rnwhisper::job* job = rnwhisper::job_new(jobId, params);
+        if (options[@"nProcessors"] != nil) {
+            job->n_processors = [options[@"nProcessors"] intValue];
+        }
+        [self setHotwords:job options:options];
         int code = [self fullTranscribe:job audioData:audioData audioDataCount:audioDataCount];
         rnwhisper::job_remove(jobId);
         self->recordState.isTranscribing = false;
@@ -468,6 +548,10 @@ struct rnwhisper_segments_callback_data {
     params.print_timestamps = false;
     params.print_special    = false;
     params.speed_up         = options[@"speedUp"] != nil ? [options[@"speedUp"] boolValue] : false;
+    params.skip_silence     = options[@"skipSilence"] != nil ? [options[@"skipSilence"] boolValue] : false;
+    if (options[@"silenceThold"] != nil) {
+        params.silence_thold = [options[@"silenceThold"] floatValue];
+    }
     params.translate        = options[@"translate"] != nil ? [options[@"translate"] boolValue] : false;
     params.language         = options[@"language"] != nil ? strdup([options[@"language"] UTF8String]) : "auto";
     params.n_threads        = n_threads > 0 ? n_threads : default_n_threads;
@@ -492,6 +576,9 @@ struct rnwhisper_segments_callback_data {
     if (options[@"duration"] != nil) {
         params.duration_ms = [options[@"duration"] intValue];
     }
+    if (options[@"langDetectMs"] != nil) {
+        params.lang_detect_ms = [options[@"langDetectMs"] intValue];
+    }
     if (options[@"wordThold"] != nil) {
         params.thold_pt = [options[@"wordThold"] intValue];
     }
@@ -508,12 +595,28 @@ struct rnwhisper_segments_callback_data {
     return params;
 }
 
+- (void)setHotwords:(rnwhisper::job *)job options:(NSDictionary *)options {
+    NSArray *hotwords = options[@"hotwords"];
+    if (hotwords == nil) return;
+
+    std::vector<std::string> words;
+    for (NSString *word in hotwords) {
+        words.push_back([word UTF8String]);
+    }
+    job->set_hotwords(
+        words,
+        options[@"hotwordBoost"] != nil ? [options[@"hotwordBoost"] floatValue] : job->params.hotword_boost
+    );
+}
+
 - (int)fullTranscribe:(rnwhisper::job *)job
-  audioData:(float *)audioData
+  audioData:(short *)audioData
   audioDataCount:(int)audioDataCount
 {
     whisper_reset_timings(self->ctx);
-    int code = whisper_full(self->ctx, job->params, audioData, audioDataCount);
+    int code = job->n_processors > 1 ?
+        whisper_full_parallel_s16(self->ctx, job->params, audioData, audioDataCount, job->n_processors) :
+        whisper_full_s16(self->ctx, job->params, audioData, audioDataCount);
     if (job && job->is_aborted()) code = -999;
     // if (code == 0) {
     //     whisper_print_timings(self->ctx);
@@ -521,28 +624,18 @@ struct rnwhisper_segments_callback_data {
     return code;
 }
 
-- (NSMutableDictionary *)getTextSegments {
-    NSString *text = @"";
-    int n_segments = whisper_full_n_segments(self->ctx);
-
-    NSMutableArray *segments = [[NSMutableArray alloc] init];
-    for (int i = 0; i < n_segments; i++) {
-        const char * text_cur = whisper_full_get_segment_text(self->ctx, i);
-        text = [text stringByAppendingString:[NSString stringWithUTF8String:text_cur]];
+- (int)fullTranscribeRealtime:(rnwhisper::job *)job
+  sliceIndex:(int)sliceIndex
+  nSamples:(int)nSamples
+{
+    whisper_reset_timings(self->ctx);
+    int code = job->full_realtime(self->ctx, sliceIndex, nSamples);
+    if (job->is_aborted()) code = -999;
+    return code;
+}
 
-        const int64_t t0 = whisper_full_get_segment_t0(self->ctx, i);
-        const int64_t t1 = whisper_full_get_segment_t1(self->ctx, i);
-        NSDictionary *segment = @{
-            @"text": [NSString stringWithUTF8String:text_cur],
-            @"t0": [NSNumber numberWithLongLong:t0],
-            @"t1": [NSNumber numberWithLongLong:t1]
-        };
-        [segments addObject:segment];
-    }
-    NSMutableDictionary *result = [[NSMutableDictionary alloc] init];
-    result[@"result"] = text;
-    result[@"segments"] = segments;
-    return result;
+- (NSMutableDictionary *)getTextSegments:(bool)withTokens {
+    return rnwhisper_get_text_segments(self->ctx, 0, whisper_full_n_segments(self->ctx), withTokens);
 }
 
 - (void)invalidate {
@@ -73,6 +73,11 @@ cd ../../../
 yarn example
 
 # Apply patch
+patch -p0 -d ./cpp < ./scripts/ggml.h.patch
+patch -p0 -d ./cpp < ./scripts/ggml.c.patch
+patch -p0 -d ./cpp < ./scripts/ggml-impl.h.patch
+patch -p0 -d ./cpp < ./scripts/ggml-quants.h.patch
+patch -p0 -d ./cpp < ./scripts/ggml-quants.c.patch
 patch -p0 -d ./cpp < ./scripts/ggml-metal.m.patch
 patch -p0 -d ./cpp < ./scripts/whisper.h.patch
 patch -p0 -d ./cpp < ./scripts/whisper.cpp.patch
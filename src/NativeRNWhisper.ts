@@ -5,6 +5,8 @@ import { TurboModuleRegistry } from 'react-native'
 export type TranscribeOptions = {
   /** Spoken language (Default: 'auto' for auto-detect) */
   language?: string,
+  /** Audio used to auto-detect the language in milliseconds, e.g. 5000 for a faster detection (Default: 0 for the first 30s) */
+  langDetectMs?: number,
   /** Translate from source language to english (Default: false) */
   translate?: boolean,
   /** Number of threads to use during computation (Default: 2 for 4-core devices, 4 for more cores) */
@@ -13,7 +15,7 @@ export type TranscribeOptions = {
   maxContext?: number,
   /** Maximum segment length in characters */
   maxLen?: number,
-  /** Enable token-level timestamps */
+  /** Enable token-level timestamps, the segments of the result get `tokens` */
   tokenTimestamps?: boolean,
   /** Word timestamp probability threshold */
   wordThold?: number,
@@ -30,8 +32,16 @@ export type TranscribeOptions = {
   bestOf?: number,
   /** Speed up audio by x2 (reduced accuracy) */
   speedUp?: boolean,
+  /** Skip silent parts of the audio (at least 1s) without running the model (Default: false) */
+  skipSilence?: boolean,
+  /** Mean absolute amplitude (0 - 1) below which the audio is silent, used with skipSilence (Default: 0.005) */
+  silenceThold?: number,
   /** Initial Prompt */
   prompt?: string,
+  /** Words or short phrases likely to be spoken (names, commands, ...), boosted while decoding */
+  hotwords?: string[],
+  /** Logit boost of the tokens continuing a hotword (Default: 2.0) */
+  hotwordBoost?: number,
 }
 
 export type TranscribeResult = {
@@ -40,7 +50,22 @@ export type TranscribeResult = {
     text: string,
     t0: number,
     t1: number,
+    /** Text tokens of the segment, with `tokenTimestamps` */
+    tokens?: Array<{
+      id: number,
+      text: string,
+      /** Probability of the token */
+      p: number,
+      t0: number,
+      t1: number,
+      /** Time from the DTW alignment, with `dtwPreset` in `initWhisper` */
+      tDtw?: number,
+    }>,
   }>,
+  /** Realtime with `realtimeLocalAgreement`: text of the slice that will not change anymore */
+  committed?: string,
+  /** Realtime with `realtimeLocalAgreement`: text after `committed`, may change on the next event */
+  tentative?: string,
   isAborted: boolean,
 }
 
@@ -54,6 +79,8 @@ type NativeContextOptions = {
   isBundleAsset: boolean,
   useGpu?: boolean,
   useCoreMLIos?: boolean,
+  dtwPreset?: string,
+  dtwNTop?: number,
   downloadCoreMLAssets?: boolean,
   coreMLAssets?: CoreMLAsset[],
 }
@@ -57,6 +57,12 @@ export type TranscribeNewSegmentsNativeEvent = {
 
 // Fn -> Boolean in TranscribeFileNativeOptions
 export type TranscribeFileOptions = TranscribeOptions & {
+  /**
+   * Split the audio file into chunks at silences and transcribe them concurrently,
+   * each chunk uses its own whisper state and `maxThreads` threads.
+   * Useful for long recordings, the memory usage grows with the number of processors. (Default: 1)
+   */
+  nProcessors?: number
   /**
    * Progress callback, the progress is between 0 and 100
    */
@@ -99,6 +105,13 @@ export type TranscribeRealtimeOptions = TranscribeOptions & {
    * The minimum value is 0.5 ms and maximum value is realtimeAudioSliceSec (Default: 1)
    */
   realtimeAudioMinSec?: number
+  /**
+   * Commit the text that two consecutive transcriptions of the slice agree on (local agreement),
+   * `data.committed` never changes and `data.tentative` may change on the next event.
+   * Only the audio after the committed segments is transcribed again, with the committed text as prompt,
+   * so `data.segments` only covers that audio. (Default: false)
+   */
+  realtimeLocalAgreement?: boolean
   /**
    * Output path for audio file. If not set, the audio file will not be saved
    * (Default: Undefined)
@@ -122,6 +135,14 @@ export type TranscribeRealtimeOptions = TranscribeOptions & {
    * Frequency to apply High-pass filter in VAD. (Default: 100.0)
    */
   vadFreqThold?: number
+  /**
+   * VAD detector. (Default: 'energy')
+   * - `energy`: Transcribe when the volume of the last second drops below `vadThold` of the `vadMs` window.
+   * - `spectral`: Detect speech segments from the speech band energy over the noise floor and the zero-crossing rate,
+   *   and transcribe once each time a segment ends (1s without speech). Fewer false triggers on noise.
+   *   `vadMs`, `vadThold` and `vadFreqThold` are not used.
+   */
+  vadMode?: 'energy' | 'spectral'
   /**
    * iOS: Audio session settings when start transcribe
    * Keep empty to use current audio session state
@@ -146,6 +167,11 @@ export type TranscribeRealtimeEvent = {
   error?: string
   processTime: number
   recordingTime: number
+  /**
+   * VAD with `vadMode: 'spectral'`: speech segments detected in the transcribed slice,
+   * in samples (16 kHz) from the start of the slice (the last 64 of the slice)
+   */
+  speechSegments?: Array<{ start: number, end: number }>
   slices?: Array<{
     code: number
     error?: string
@@ -166,6 +192,7 @@ export type TranscribeRealtimeNativePayload = {
   sliceIndex: number
   data?: TranscribeResult
   error?: string
+  speechSegments?: Array<{ start: number, end: number }>
 }
 
 export type TranscribeRealtimeNativeEvent = {
@@ -455,6 +482,26 @@ export type ContextOptions = {
   useCoreMLIos?: boolean
   /** Use GPU if available. Currently iOS only, if it's enabled, Core ML option will be ignored. */
   useGpu?: boolean
+  /**
+   * [Experimental] Token timestamps from DTW over the cross-attention of the alignment heads of the model,
+   * returned as `tDtw` of the tokens with `tokenTimestamps`. Use the preset of the loaded model,
+   * or `top-most` for all heads of the `dtwNTop` top-most text layers. (Default: disabled)
+   */
+  dtwPreset?:
+    | 'tiny.en'
+    | 'tiny'
+    | 'base.en'
+    | 'base'
+    | 'small.en'
+    | 'small'
+    | 'medium.en'
+    | 'medium'
+    | 'large-v1'
+    | 'large-v2'
+    | 'large-v3'
+    | 'top-most'
+  /** Number of text layers used by the `top-most` DTW preset (Default: all) */
+  dtwNTop?: number
 }
 
 const coreMLModelAssetPaths = [
@@ -470,6 +517,8 @@ export async function initWhisper({
   isBundleAsset,
   useGpu = true,
   useCoreMLIos = true,
+  dtwPreset,
+  dtwNTop,
 }: ContextOptions): Promise<WhisperContext> {
   let path = ''
   let coreMLAssets: CoreMLAsset[] | undefined
@@ -520,6 +569,8 @@ export async function initWhisper({
     isBundleAsset: !!isBundleAsset,
     useGpu,
     useCoreMLIos,
+    dtwPreset,
+    dtwNTop,
     // Only development mode need download Core ML model assets (from packager server)
     downloadCoreMLAssets: __DEV__ && !!coreMLAssets,
     coreMLAssets,
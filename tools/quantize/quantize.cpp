@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "rn-quantize.h"
+
+static void print_usage(const char * argv0) {
+    fprintf(stderr, "usage: %s [options] model-f16.bin model-out.bin\n\n", argv0);
+    fprintf(stderr, "options:\n");
+    fprintf(stderr, "  -p, --preset NAME        start from a preset policy: mixed (default), mobile\n");
+    fprintf(stderr, "  -t, --type TYPE          type of the 2D weights matching no rule (q4_0, q5_0, q8_0, q4_K, f16, ...)\n");
+    fprintf(stderr, "  -r, --rule REGEX=TYPE[@ERR]\n");
+    fprintf(stderr, "                           type of the tensors whose name matches REGEX, checked before the preset rules;\n");
+    fprintf(stderr, "                           with @ERR the type is promoted while the relative RMS error is above ERR\n");
+    fprintf(stderr, "  -e, --max-err ERR        promotion threshold of the --type tensors (0 = off)\n");
+    fprintf(stderr, "  -v, --verbose            print the type and error of every tensor\n");
+    fprintf(stderr, "  -h, --help               show this help\n\n");
+    fprintf(stderr, "example: %s -p mixed -r 'decoder\\.blocks\\.[0-9]+\\.mlp\\..*=q4_K@0.05' ggml-base.bin ggml-base-mixed.bin\n", argv0);
+}
+
+int main(int argc, char ** argv) {
+    rnwhisper::quantize_policy policy;
+    rnwhisper::quantize_policy_preset("mixed", policy);
+
+    std::vector<rnwhisper::quantize_rule> rules;
+    std::vector<std::string> files;
+    bool verbose = false;
+    bool has_type = false;
+    wsp_ggml_type type = WSP_GGML_TYPE_COUNT;
+    float max_rel_err = -1.0f;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if ((arg == "-p" || arg == "--preset") && has_value) {
+            if (!rnwhisper::quantize_policy_preset(argv[++i], policy)) {
+                fprintf(stderr, "error: unknown preset '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if ((arg == "-t" || arg == "--type") && has_value) {
+            if (!rnwhisper::quantize_type_from_name(argv[++i], type)) {
+                fprintf(stderr, "error: unknown type '%s'\n", argv[i]);
+                return 1;
+            }
+            has_type = true;
+        } else if ((arg == "-r" || arg == "--rule") && has_value) {
+            rnwhisper::quantize_rule rule;
+            if (!rnwhisper::quantize_rule_parse(argv[++i], rule)) {
+                fprintf(stderr, "error: bad rule '%s', expected REGEX=TYPE[@ERR]\n", argv[i]);
+                return 1;
+            }
+            rules.push_back(rule);
+        } else if ((arg == "-e" || arg == "--max-err") && has_value) {
+            max_rel_err = (float) atof(argv[++i]);
+        } else if (arg == "-v" || arg == "--verbose") {
+            verbose = true;
+        } else if (arg[0] == '-') {
+            fprintf(stderr, "error: unknown argument '%s'\n", arg.c_str());
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size() != 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (has_type) {
+        policy.default_type = type;
+    }
+    if (max_rel_err >= 0.0f) {
+        policy.max_rel_err = max_rel_err;
+    }
+    policy.rules.insert(policy.rules.begin(), rules.begin(), rules.end());
+
+    std::vector<rnwhisper::quantize_tensor_info> info;
+    if (!rnwhisper::quantize_model(files[0], files[1], policy, &info)) {
+        fprintf(stderr, "error: failed to quantize '%s'\n", files[0].c_str());
+        return 1;
+    }
+
+    size_t size_in  = 0;
+    size_t size_out = 0;
+    for (const auto & t : info) {
+        if (verbose) {
+            printf("%-48s %5s -> %-5s %8.2f MB -> %8.2f MB  err %.4f\n", t.name.c_str(),
+                wsp_ggml_type_name(t.type_in), wsp_ggml_type_name(t.type_out), t.size_in/1e6, t.size_out/1e6, t.rel_err);
+        }
+        size_in  += t.size_in;
+        size_out += t.size_out;
+    }
+    printf("%s: %.2f MB -> %.2f MB\n", files[1].c_str(), size_in/1e6, size_out/1e6);
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+// whisper_time_compress (speed_up) on odd lengths around the last frames, run it with -fsanitize=address
+// to catch the reads past the end of the input
+#include "whisper.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+int main() {
+    whisper_state state;
+
+    srand(42);
+
+    int n_failed = 0;
+    for (int n = 6401; n <= 10401; n += 2) {
+        // exactly n samples, so any read past the end lands outside the allocation
+        std::vector<float> x(n);
+        for (int i = 0; i < n; i++) {
+            x[i] = 0.5f*sinf(2.0f*M_PI*180.0f*i/WHISPER_SAMPLE_RATE) + 0.1f*((float)rand()/RAND_MAX - 0.5f);
+        }
+
+        const int n_out = whisper_time_compress(state, x.data(), n);
+
+        bool ok = n_out == (n + 1)/2 && (int) state.tsm_out.size() >= n_out;
+        for (int i = 0; ok && i < n_out; i++) {
+            ok = std::isfinite(state.tsm_out[i]);
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: n = %d, n_out = %d: FAILED\n", __func__, n, n_out);
+            n_failed++;
+        }
+    }
+
+    if (n_failed > 0) {
+        return 1;
+    }
+
+    printf("%s: OK\n", __func__);
+    return 0;
+}